@@ -0,0 +1,723 @@
+// headless microbenchmarks for the cpu kernels of both demos.
+//
+// every kernel runs on fixed seeds and sizes. the op count is calibrated so a
+// sample takes at least SAMPLE_TIME, then SAMPLES samples are taken and the
+// median is reported (min and spread too, so noisy runs are easy to spot).
+// output is csv on stdout, one row per kernel:
+//
+//   kernel,size,ops,ns_per_op,min_ns_per_op,spread,throughput,unit,allocs_per_op,bytes_per_op
+//
+// usage: microbench [filter], only kernels whose name contains filter run
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "block_mesh.h"
+#include "blocks.h"
+#include "cdlod.h"
+#include "chunks.h"
+#include "custom_draw.h"
+#include "entities.h"
+#include "frustum.h"
+#include "height_pyramid.h"
+#include "heightfield.h"
+#include "map.h"
+#include "map_mesh.h"
+#include "noise.h"
+#include "packed_mesh.h"
+#include "parallel.h"
+#include "perlin.h"
+#include "render_queue.h"
+#include "rtin.h"
+#include "sculpt.h"
+#include "terrain_mesh.h"
+
+#define SAMPLES 7
+#define SAMPLE_TIME 0.1 // seconds
+#define SEED 1337
+
+//---Allocation counting---
+
+// malloc & co are interposed so allocations made inside raylib count too.
+// glibc only, elsewhere the columns read -1
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static size_t alloc_count, alloc_bytes;
+
+static void count_alloc(size_t size) {
+  __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&alloc_bytes, size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size) {
+  count_alloc(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  count_alloc(count * size);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  count_alloc(size);
+  return __libc_realloc(ptr, size);
+}
+#define ALLOC_COUNTING 1
+#else
+static size_t alloc_count, alloc_bytes;
+#define ALLOC_COUNTING 0
+#endif
+
+//---Helpers---
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// splitmix32, so inputs don't depend on the libc or raylib rng
+static uint32_t rng_state = SEED;
+static uint32_t rng_next(void) {
+  uint32_t z = (rng_state += 0x9e3779b9);
+  z = (z ^ (z >> 16)) * 0x85ebca6b;
+  z = (z ^ (z >> 13)) * 0xc2b2ae35;
+  return z ^ (z >> 16);
+}
+static float rng_range(float lo, float hi) { return lo + (hi - lo) * (rng_next() >> 8) * (1.0f / (1 << 24)); }
+
+// keeps results alive so the kernels aren't optimized away
+static volatile float sink;
+
+static void free_cpu_mesh(Mesh *mesh) {
+  RL_FREE(mesh->vertices);
+  RL_FREE(mesh->normals);
+  RL_FREE(mesh->texcoords);
+  RL_FREE(mesh->indices);
+  *mesh = (Mesh){0};
+}
+
+//---Kernels---
+
+#define PERLIN_SIZE 512
+#define HF_SAMPLES 360
+#define HF_SPACING (1200.0f / (HF_SAMPLES - 1))
+#define QUERY_COUNT 4096
+#define RAY_COUNT 64
+#define BLOCK_COUNT 1024
+#define MANY_BLOCKS (1 << 20) // same density over 32x the extent
+#define MAP_SIZE 64
+#define PLANE_RES 64
+#define LOD_CELLS 256
+#define LOD_GRID 16 // chunks per side for one selection
+#define RTIN_SAMPLES 4097
+#define RTIN_ERROR 1.0f
+#define SCULPT_RADIUS 50 // world units, about 30x30 samples
+#define NPC_COUNT 100000
+#define NPC_SPREAD 400.0f // world units around the origin, the blocks are in the middle
+#define RENDER_COMMANDS 4096 // 8 shaders, 64 textures, 512 vaos
+
+static Heightfield hf, hf_slopes;
+static Vector2 points[QUERY_COUNT];
+static float point_xs[QUERY_COUNT], point_zs[QUERY_COUNT];
+static float sample_heights[QUERY_COUNT];
+static Vector3 sample_normals[QUERY_COUNT];
+static Vector2 triangles[QUERY_COUNT][3];
+static Ray rays[RAY_COUNT];
+static HeightPyramid pyramid;
+static Ray sight_rays[QUERY_COUNT];
+static float sight_distances[QUERY_COUNT];
+static RayCollision sight_hits[QUERY_COUNT];
+static VoxelWorld blocks, many_blocks;
+static BoundingBox block_boxes[BLOCK_COUNT];
+static Camera camera;
+static Frustum frustum;
+static Block visible_blocks[BLOCK_COUNT];
+static Image map_image;
+static Heightfield lod_hf;
+static Cdlod lod;
+static CdlodChunk lod_chunk;
+static Heightfield rtin_hf;
+static Rtin rtin;
+static Voxel block_chunk[BLOCK_MESH_PAD * BLOCK_MESH_PAD * BLOCK_MESH_PAD];
+static BlockMeshData block_chunk_mesh;
+static ChunkManager npc_chunks;
+static Entities npcs;
+static RenderQueue render_queue;
+
+// count blocks in distinct voxels, boxes gets their bounds if not NULL
+static void scatter_blocks(VoxelWorld *world, int count, float extent, BoundingBox *boxes) {
+  voxels_init(world, 5);
+  for (int i = 0; i < count;) {
+    Vector3 pos;
+    do {
+      pos = (Vector3){rng_range(-extent, extent), rng_range(-20, 40), rng_range(-extent, extent)};
+    } while (Vector3Length(pos) < 30);
+    int v[3];
+    voxels_cell(world, pos, v);
+    if (!voxels_set(world, v[0], v[1], v[2], 1 + (i & 1)))
+      continue;
+    if (boxes)
+      boxes[i] = voxels_bounds(world, v[0], v[1], v[2]);
+    i++;
+  }
+}
+
+static void setup(void) {
+  hf = heightfield_alloc(HF_SAMPLES, HF_SAMPLES, HF_SPACING, 300);
+  perlin_heightfield(&hf, 100, 200, 2.0f, 2, 0.4f, 6, 1);
+  hf_slopes = heightfield_alloc(HF_SAMPLES, HF_SAMPLES, HF_SPACING, 300);
+  heightfield_alloc_slopes(&hf_slopes);
+  perlin_heightfield(&hf_slopes, 100, 200, 2.0f, 2, 0.4f, 6, 1);
+
+  float size = heightfield_size_x(&hf);
+  for (int i = 0; i < QUERY_COUNT; i++) {
+    points[i] = (Vector2){rng_range(0, size), rng_range(0, size)};
+    point_xs[i] = points[i].x;
+    point_zs[i] = points[i].y;
+    for (int k = 0; k < 3; k++)
+      triangles[i][k] = (Vector2){rng_range(0, 10), rng_range(0, 10)};
+  }
+
+  // from above the terrain looking down at 30 degrees, all of them hit
+  for (int i = 0; i < RAY_COUNT; i++) {
+    float angle = rng_range(0, 2 * PI);
+    rays[i].position = (Vector3){rng_range(size * 0.25f, size * 0.75f), hf.max_height + 10,
+                                 rng_range(size * 0.25f, size * 0.75f)};
+    rays[i].direction = Vector3Normalize((Vector3){cosf(angle), -0.5f, sinf(angle)});
+  }
+  pyramid = height_pyramid_build(&hf);
+
+  // line of sight between points 2 units over the ground, up to 200 apart
+  for (int i = 0; i < QUERY_COUNT; i++) {
+    Vector2 to = {Clamp(points[i].x + rng_range(-200, 200), 0, size), Clamp(points[i].y + rng_range(-200, 200), 0, size)};
+    Vector3 eye = {points[i].x, get_terrain_height(points[i].x, points[i].y, &hf) + 2, points[i].y};
+    Vector3 target = {to.x, get_terrain_height(to.x, to.y, &hf) + 2, to.y};
+    sight_rays[i] = (Ray){eye, Vector3Subtract(target, eye)};
+    sight_distances[i] = Vector3Distance(eye, target);
+  }
+
+  // blocks scattered around a player standing at the origin,
+  // none of them close enough to stop the move so the loop runs to the end
+  camera = (Camera){.position = {0, 8, 0}, .target = {0, 8, 1}, .up = {0, 1, 0}, .fovy = 60};
+  scatter_blocks(&blocks, BLOCK_COUNT, 200, block_boxes);
+  scatter_blocks(&many_blocks, MANY_BLOCKS, 200 * 32, NULL);
+  frustum = frustum_from_camera(camera, 16.0f / 9.0f);
+
+  // a maze like map image, about a third walls
+  Color *pixels = RL_MALLOC(MAP_SIZE * MAP_SIZE * sizeof(Color));
+  for (int i = 0; i < MAP_SIZE * MAP_SIZE; i++) {
+    uint32_t r = rng_next() % 3;
+    unsigned char b = r == 0 ? 255 : r == 1 ? 100 : 0;
+    pixels[i] = (Color){0, 0, b, 255};
+  }
+  map_image = (Image){pixels, MAP_SIZE, MAP_SIZE, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+
+  // one chunk's quadtree reused for a whole grid of chunks
+  lod_hf = heightfield_alloc(LOD_CELLS + 1, LOD_CELLS + 1, HF_SPACING, 300);
+  perlin_heightfield(&lod_hf, 100, 200, 2.0f * (LOD_CELLS + 1) / HF_SAMPLES, 2, 0.4f, 6, 1);
+  lod = cdlod_init((CdlodConfig){.patch_cells = 16, .levels = 5, .lod0_range = 150, .morph_start = 0.66f},
+                   LOD_CELLS, HF_SPACING);
+  cdlod_chunk_build(&lod, &lod_hf, &lod_chunk);
+
+  // a 4k heightfield with the old map's feature size, generated on every cpu
+  rtin_hf = heightfield_alloc(RTIN_SAMPLES, RTIN_SAMPLES, HF_SPACING, 300);
+  perlin_heightfield(&rtin_hf, 100, 200, 2.0f * RTIN_SAMPLES / HF_SAMPLES, 2, 0.4f, 6, 0);
+  rtin_init(&rtin, &rtin_hf);
+
+  // a chunk of built up ground, two textures in layers with a ragged top
+  for (int y = 0; y < BLOCK_MESH_PAD; y++) {
+    for (int z = 0; z < BLOCK_MESH_PAD; z++) {
+      for (int x = 0; x < BLOCK_MESH_PAD; x++) {
+        int top = 6 + (int)(rng_next() % 4);
+        block_chunk[(y * BLOCK_MESH_PAD + z) * BLOCK_MESH_PAD + x] = y < top ? (y < 4 ? 2 : 1) : VOXEL_EMPTY;
+      }
+    }
+  }
+
+  // the game's terrain streamed around the origin, without a gpu, and npcs
+  // walking over it and the blocks. the first ticks drop them onto the ground
+  chunks_init(&npc_chunks, (ChunkConfig){.cells = 64, .spacing = HF_SPACING, .max_height = 300, .seed_x = 100,
+                                         .seed_z = 200, .noise_step = 2.0f / HF_SAMPLES, .lacunarity = 2,
+                                         .gain = 0.4f, .octaves = 6, .radius = 2, .memory_budget = 1 << 28,
+                                         .threads = 0, .headless = true});
+  chunks_wait(&npc_chunks, (Vector3){0, 0, 0});
+  entities_init(&npcs, NPC_COUNT, 0);
+  for (int i = 0; i < NPC_COUNT; i++) {
+    float angle = rng_range(0, 2 * PI), speed = rng_range(0, 20);
+    entities_add(&npcs, (Vector3){rng_range(-NPC_SPREAD, NPC_SPREAD), 310, rng_range(-NPC_SPREAD, NPC_SPREAD)},
+                 (Vector3){cosf(angle) * speed, 0, sinf(angle) * speed}, rng_range(1, 3), 30,
+                 (rng_next() & 3) == 0 ? ENTITY_JUMPS : 0);
+  }
+  for (int i = 0; i < 240; i++)
+    entities_tick(&npcs, &npc_chunks, &blocks, 1 / 120.0f);
+
+  // a frame's worth of draws in submission order, state scattered through it
+  render_queue_init(&render_queue);
+  for (int i = 0; i < RENDER_COMMANDS; i++) {
+    Shader shader = {.id = 1 + rng_next() % 8};
+    RenderCommand *command =
+        render_queue_push(&render_queue, shader, 1 + rng_next() % 512, 0, 6, RENDER_INDEX_16, rng_range(0, 1000));
+    command->textures[0] = 1 + rng_next() % 64;
+  }
+}
+
+static void teardown(void) {
+  heightfield_unload(&hf);
+  heightfield_unload(&hf_slopes);
+  height_pyramid_unload(&pyramid);
+  voxels_unload(&blocks);
+  voxels_unload(&many_blocks);
+  UnloadImage(map_image);
+  heightfield_unload(&lod_hf);
+  RL_FREE(lod_chunk.bounds);
+  RL_FREE(lod.nodes);
+  heightfield_unload(&rtin_hf);
+  rtin_unload(&rtin);
+  block_mesh_free(&block_chunk_mesh);
+  entities_unload(&npcs);
+  chunks_unload(&npc_chunks);
+  render_queue_unload(&render_queue);
+}
+
+static void bench_perlin_image(int ops) {
+  for (int i = 0; i < ops; i++) {
+    Image image = my_perlin_image(PERLIN_SIZE, PERLIN_SIZE, 100, 200, 2.0f, 2, 0.4f, 6);
+    sink = ((unsigned char *)image.data)[i & 1023];
+    UnloadImage(image);
+  }
+}
+
+static void bench_perlin_image_mt(int ops) {
+  for (int i = 0; i < ops; i++) {
+    Image image = my_perlin_image_mt(PERLIN_SIZE, PERLIN_SIZE, 100, 200, 2.0f, 2, 0.4f, 6, 0);
+    sink = ((unsigned char *)image.data)[i & 1023];
+    UnloadImage(image);
+  }
+}
+
+static void bench_perlin_heightfield(int ops) {
+  for (int i = 0; i < ops; i++)
+    perlin_heightfield(&hf, 100, 200, 2.0f, 2, 0.4f, 6, 1);
+  sink = hf.heights[7];
+}
+
+static void bench_perlin_heightfield_slopes(int ops) {
+  for (int i = 0; i < ops; i++)
+    perlin_heightfield(&hf_slopes, 100, 200, 2.0f, 2, 0.4f, 6, 1);
+  sink = hf_slopes.slopes[7];
+}
+
+static void bench_barycentric(int ops) {
+  float acc = 0;
+  for (int i = 0; i < ops; i++) {
+    int k = i & (QUERY_COUNT - 1);
+    float l1, l2, l3;
+    barycentric_coordinates(points[k], triangles[k][0], triangles[k][1], triangles[k][2], &l1, &l2, &l3);
+    acc += l1 + l2 * l3;
+  }
+  sink = acc;
+}
+
+static void bench_terrain_height(int ops) {
+  float acc = 0;
+  for (int i = 0; i < ops; i++) {
+    Vector2 p = points[i & (QUERY_COUNT - 1)];
+    acc += get_terrain_height(p.x, p.y, &hf);
+  }
+  sink = acc;
+}
+
+static void bench_heightfield_sample(int ops) {
+  for (int i = 0; i < ops; i++) {
+    heightfield_sample(&hf, point_xs, point_zs, QUERY_COUNT, sample_heights, sample_normals, NULL);
+    sink = sample_heights[i & (QUERY_COUNT - 1)];
+  }
+}
+
+static void bench_height_pyramid_build(int ops) {
+  for (int i = 0; i < ops; i++) {
+    HeightPyramid p = height_pyramid_build(&hf);
+    sink = p.bounds[0];
+    height_pyramid_unload(&p);
+  }
+}
+
+static void bench_raycast(int ops) {
+  float acc = 0;
+  for (int i = 0; i < ops; i++) {
+    RayCollision hit;
+    if (height_pyramid_raycast(&pyramid, &hf, rays[i & (RAY_COUNT - 1)], INFINITY, &hit))
+      acc += hit.point.y;
+  }
+  sink = acc;
+}
+
+static void bench_line_of_sight(int ops) {
+  int blocked = 0;
+  for (int i = 0; i < ops; i++)
+    blocked += height_pyramid_raycast_batch(&pyramid, &hf, sight_rays, sight_distances, QUERY_COUNT, sight_hits);
+  sink = blocked;
+}
+
+static void collide_blocks(const VoxelWorld *world, int ops) {
+  int floor = 0;
+  for (int i = 0; i < ops; i++) {
+    Vector3 dr = {0.5f, 0.3f, 0};
+    floor += blocks_collide(world, &camera, 8, -1, 1 / 144.0f, &dr);
+  }
+  sink = floor;
+}
+
+// the crosshair's reach in terrain/main.c
+static void raycast_blocks(const VoxelWorld *world, int ops) {
+  int hits = 0;
+  for (int i = 0; i < ops; i++) {
+    RayCollision hit;
+    int voxel[3];
+    Ray ray = {camera.position, rays[i & (RAY_COUNT - 1)].direction};
+    hits += blocks_raycast(world, ray, 2 * HF_SAMPLES, &hit, voxel);
+  }
+  sink = hits;
+}
+
+static void bench_blocks_collide(int ops) { collide_blocks(&blocks, ops); }
+static void bench_blocks_collide_many(int ops) { collide_blocks(&many_blocks, ops); }
+static void bench_blocks_raycast(int ops) { raycast_blocks(&blocks, ops); }
+static void bench_blocks_raycast_many(int ops) { raycast_blocks(&many_blocks, ops); }
+
+// place and remove again in the million block world, palettes stay put
+static void bench_voxels_set(int ops) {
+  int changed = 0;
+  for (int i = 0; i < ops; i++) {
+    int x = (int)(rng_next() % 2560) - 1280, y = (int)(rng_next() % 12) - 4, z = (int)(rng_next() % 2560) - 1280;
+    Voxel old = voxels_get(&many_blocks, x, y, z);
+    changed += voxels_set(&many_blocks, x, y, z, 1 + (i & 1));
+    voxels_set(&many_blocks, x, y, z, old);
+  }
+  voxels_clear_dirty(&many_blocks);
+  sink = changed;
+}
+
+static void bench_init_map(int ops) {
+  for (int i = 0; i < ops; i++) {
+    Map map;
+    init_map(&map, map_image, (Vector2){0, 0});
+    sink = map.wall_count;
+    unload_map(&map);
+  }
+}
+
+static void bench_bake_map_mesh(int ops) {
+  Map map;
+  init_map(&map, map_image, (Vector2){0, 0});
+  for (int i = 0; i < ops; i++) {
+    MapMesh mesh = bake_map_mesh(&map);
+    sink = mesh.faces;
+    unload_map_mesh(&mesh);
+  }
+  unload_map(&map);
+}
+
+static void bench_plane_mesh(int ops) {
+  for (int i = 0; i < ops; i++) {
+    Mesh mesh = build_mesh_plane_tiled(PLANE_RES * 10, PLANE_RES * 10, PLANE_RES, PLANE_RES);
+    sink = mesh.vertices[3];
+    free_cpu_mesh(&mesh);
+  }
+}
+
+static void bench_heightfield_mesh(int ops) {
+  for (int i = 0; i < ops; i++) {
+    Mesh mesh = heightfield_build_mesh(&hf);
+    sink = mesh.vertices[3];
+    free_cpu_mesh(&mesh);
+  }
+}
+
+static void bench_heightfield_mesh_slopes(int ops) {
+  for (int i = 0; i < ops; i++) {
+    Mesh mesh = heightfield_build_mesh(&hf_slopes);
+    sink = mesh.normals[3];
+    free_cpu_mesh(&mesh);
+  }
+}
+
+static void bench_terrain_mesh(int ops) {
+  for (int i = 0; i < ops; i++) {
+    TerrainMesh mesh = terrain_mesh_build(&hf_slopes);
+    sink = mesh.normals[3];
+    terrain_mesh_free_cpu(&mesh);
+  }
+}
+
+static void bench_packed_mesh(int ops) {
+  TerrainMesh mesh = terrain_mesh_build(&hf_slopes);
+  for (int i = 0; i < ops; i++) {
+    PackedMesh packed = packed_mesh_from_terrain(&mesh, &hf_slopes, 0);
+    sink = packed.vertices[1].normal;
+    packed_mesh_free_cpu(&packed);
+  }
+  terrain_mesh_free_cpu(&mesh);
+}
+
+static void bench_cdlod_select(int ops) {
+  float size = LOD_CELLS * HF_SPACING;
+  Vector3 eye = {10, 200, 10};
+  for (int i = 0; i < ops; i++) {
+    cdlod_begin(&lod);
+    for (int z = 0; z < LOD_GRID; z++) {
+      for (int x = 0; x < LOD_GRID; x++) {
+        Vector3 origin = {(x - LOD_GRID / 2) * size, 0, (z - LOD_GRID / 2) * size};
+        cdlod_select(&lod, &lod_chunk, origin, eye, NULL);
+      }
+    }
+    sink = lod.stats.triangles;
+  }
+}
+
+// same grid, chunks culled first and partly visible ones per node
+static void bench_cdlod_select_culled(int ops) {
+  float size = LOD_CELLS * HF_SPACING;
+  Vector3 eye = {10, 200, 10};
+  Frustum view = frustum_from_camera((Camera){.position = eye, .target = {10, 150, 100}, .up = {0, 1, 0}, .fovy = 60},
+                                     16.0f / 9.0f);
+  for (int i = 0; i < ops; i++) {
+    cdlod_begin(&lod);
+    for (int z = 0; z < LOD_GRID; z++) {
+      for (int x = 0; x < LOD_GRID; x++) {
+        Vector3 origin = {(x - LOD_GRID / 2) * size, 0, (z - LOD_GRID / 2) * size};
+        BoundingBox box = {origin, {origin.x + size, 300, origin.z + size}};
+        FrustumResult result = frustum_test_box(&view, box);
+        if (result != FRUSTUM_OUTSIDE)
+          cdlod_select(&lod, &lod_chunk, origin, eye, result == FRUSTUM_INSIDE ? NULL : &view);
+      }
+    }
+    sink = lod.stats.triangles;
+  }
+}
+
+static void bench_rtin_init(int ops) {
+  for (int i = 0; i < ops; i++) {
+    Rtin r;
+    rtin_init(&r, &rtin_hf);
+    sink = r.errors[RTIN_SAMPLES + 1];
+    rtin_unload(&r);
+  }
+}
+
+static void bench_rtin_mesh(int ops) {
+  for (int i = 0; i < ops; i++) {
+    TerrainIndices indices;
+    TerrainMesh mesh = rtin_build_mesh(&rtin, &rtin_hf, NULL, RTIN_ERROR, 0, &indices);
+    sink = indices.count;
+    terrain_mesh_free_cpu(&mesh);
+    terrain_indices_unload(&indices);
+  }
+}
+
+static void bench_rtin_height(int ops) {
+  float acc = 0, scale = (float)(RTIN_SAMPLES - 1) / (HF_SAMPLES - 1);
+  for (int i = 0; i < ops; i++) {
+    Vector2 p = points[i & (QUERY_COUNT - 1)];
+    float height;
+    if (rtin_height(&rtin, &rtin_hf, RTIN_ERROR, p.x * scale, p.y * scale, &height, NULL))
+      acc += height;
+  }
+  sink = acc;
+}
+
+// raise and lower in turn so the field stays put, with the normals a mesh
+// update would need. the same stroke on both sizes should cost the same
+static void sculpt_strokes(Heightfield *field, int ops) {
+  static float normals[64 * 64 * 3];
+  float size = heightfield_size_x(field);
+  for (int i = 0; i < ops; i++) {
+    Vector2 p = points[(i / 2) & (QUERY_COUNT - 1)];
+    SculptBrush brush = {i & 1 ? SCULPT_LOWER : SCULPT_RAISE, SCULPT_RADIUS, 10, 0};
+    HeightfieldRect dirty;
+    float scale = size / heightfield_size_x(&hf);
+    if (sculpt_heightfield(field, &brush, p.x * scale, p.y * scale, 0.1f, &dirty))
+      heightfield_rect_normals(field, dirty, normals);
+    sink = normals[0];
+  }
+}
+
+static void bench_sculpt(int ops) { sculpt_strokes(&hf_slopes, ops); }
+static void bench_sculpt_4k(int ops) { sculpt_strokes(&rtin_hf, ops); }
+
+static void bench_frustum_box(int ops) {
+  for (int i = 0; i < ops; i++) {
+    int inside = 0;
+    for (int k = 0; k < BLOCK_COUNT; k++)
+      inside += frustum_test_box(&frustum, block_boxes[k]) != FRUSTUM_OUTSIDE;
+    sink = inside;
+  }
+}
+
+static void bench_blocks_cull(int ops) {
+  CullStats stats;
+  for (int i = 0; i < ops; i++)
+    sink = blocks_cull(&blocks, &frustum, visible_blocks, BLOCK_COUNT, &stats);
+}
+
+static void bench_block_mesh(int ops) {
+  int quads = 0;
+  for (int i = 0; i < ops; i++)
+    quads += block_mesh_build(block_chunk, 2, &block_chunk_mesh);
+  sink = quads;
+}
+
+// one fixed tick of every npc, the walks wander off the loaded ground over
+// time and those npcs freeze, like in the game
+static void bench_entities_tick(int ops) {
+  for (int i = 0; i < ops; i++)
+    entities_tick(&npcs, &npc_chunks, &blocks, 1 / 120.0f);
+  sink = npcs.awake;
+}
+
+static void bench_entities_nearest(int ops) {
+  static int nearest[1024];
+  static float distances[1024];
+  for (int i = 0; i < ops; i++)
+    sink = entities_nearest(&npcs, (Vector3){0, 150, 0}, 150, 1024, nearest, distances);
+}
+
+static void bench_render_queue_sort(int ops) {
+  for (int i = 0; i < ops; i++)
+    render_queue_sort(&render_queue);
+  sink = render_queue.order[0];
+}
+
+typedef struct Bench {
+  const char *name;
+  const char *size;
+  void (*run)(int ops);
+  double items; // work items per op, for the throughput column
+  const char *unit;
+} Bench;
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+static const Bench benches[] = {
+    {"my_perlin_image", STR(PERLIN_SIZE) "x" STR(PERLIN_SIZE) " oct6", bench_perlin_image,
+     PERLIN_SIZE * PERLIN_SIZE, "px/s"},
+    {"my_perlin_image_mt", STR(PERLIN_SIZE) "x" STR(PERLIN_SIZE) " oct6", bench_perlin_image_mt,
+     PERLIN_SIZE * PERLIN_SIZE, "px/s"},
+    {"perlin_heightfield", STR(HF_SAMPLES) "x" STR(HF_SAMPLES) " oct6", bench_perlin_heightfield,
+     HF_SAMPLES * HF_SAMPLES, "samples/s"},
+    {"perlin_heightfield_slopes", STR(HF_SAMPLES) "x" STR(HF_SAMPLES) " oct6", bench_perlin_heightfield_slopes,
+     HF_SAMPLES * HF_SAMPLES, "samples/s"},
+    {"barycentric_coordinates", "1 point", bench_barycentric, 1, "queries/s"},
+    {"get_terrain_height", STR(HF_SAMPLES) "x" STR(HF_SAMPLES), bench_terrain_height, 1, "queries/s"},
+    {"heightfield_sample", STR(HF_SAMPLES) "x" STR(HF_SAMPLES) " " STR(QUERY_COUNT) " points + normals",
+     bench_heightfield_sample, QUERY_COUNT, "queries/s"},
+    {"height_pyramid_build", STR(HF_SAMPLES) "x" STR(HF_SAMPLES), bench_height_pyramid_build,
+     (HF_SAMPLES - 1) * (HF_SAMPLES - 1), "cells/s"},
+    {"height_pyramid_raycast", STR(HF_SAMPLES) "x" STR(HF_SAMPLES), bench_raycast, 1, "rays/s"},
+    {"line_of_sight_batch", STR(HF_SAMPLES) "x" STR(HF_SAMPLES) " " STR(QUERY_COUNT) " rays", bench_line_of_sight,
+     QUERY_COUNT, "rays/s"},
+    {"blocks_collide", STR(BLOCK_COUNT) " blocks", bench_blocks_collide, 1, "queries/s"},
+    {"blocks_collide_many", "1048576 blocks", bench_blocks_collide_many, 1, "queries/s"},
+    {"blocks_raycast", STR(BLOCK_COUNT) " blocks", bench_blocks_raycast, 1, "rays/s"},
+    {"blocks_raycast_many", "1048576 blocks", bench_blocks_raycast_many, 1, "rays/s"},
+    {"voxels_set", "place + remove", bench_voxels_set, 1, "edits/s"},
+    {"init_map", STR(MAP_SIZE) "x" STR(MAP_SIZE), bench_init_map, MAP_SIZE * MAP_SIZE, "tiles/s"},
+    {"bake_map_mesh", STR(MAP_SIZE) "x" STR(MAP_SIZE), bench_bake_map_mesh, MAP_SIZE * MAP_SIZE, "tiles/s"},
+    {"gen_mesh_plane_tiled", STR(PLANE_RES) "x" STR(PLANE_RES) " cpu", bench_plane_mesh,
+     PLANE_RES * PLANE_RES, "cells/s"},
+    {"heightfield_build_mesh", STR(HF_SAMPLES) "x" STR(HF_SAMPLES), bench_heightfield_mesh,
+     (HF_SAMPLES - 1) * (HF_SAMPLES - 1), "cells/s"},
+    {"heightfield_build_mesh_slopes", STR(HF_SAMPLES) "x" STR(HF_SAMPLES), bench_heightfield_mesh_slopes,
+     (HF_SAMPLES - 1) * (HF_SAMPLES - 1), "cells/s"},
+    {"terrain_mesh_build", STR(HF_SAMPLES) "x" STR(HF_SAMPLES), bench_terrain_mesh, (HF_SAMPLES - 1) * (HF_SAMPLES - 1),
+     "cells/s"},
+    {"packed_mesh_from_terrain", STR(HF_SAMPLES) "x" STR(HF_SAMPLES), bench_packed_mesh, HF_SAMPLES * HF_SAMPLES,
+     "vertices/s"},
+    {"cdlod_select", STR(LOD_GRID) "x" STR(LOD_GRID) " chunks of " STR(LOD_CELLS), bench_cdlod_select,
+     LOD_GRID * LOD_GRID, "chunks/s"},
+    {"cdlod_select_culled", STR(LOD_GRID) "x" STR(LOD_GRID) " chunks of " STR(LOD_CELLS), bench_cdlod_select_culled,
+     LOD_GRID * LOD_GRID, "chunks/s"},
+    {"rtin_init", STR(RTIN_SAMPLES) "x" STR(RTIN_SAMPLES), bench_rtin_init, (double)RTIN_SAMPLES * RTIN_SAMPLES,
+     "samples/s"},
+    {"rtin_build_mesh", STR(RTIN_SAMPLES) "x" STR(RTIN_SAMPLES) " error " STR(RTIN_ERROR), bench_rtin_mesh,
+     (double)RTIN_SAMPLES * RTIN_SAMPLES, "samples/s"},
+    {"rtin_height", STR(RTIN_SAMPLES) "x" STR(RTIN_SAMPLES) " error " STR(RTIN_ERROR), bench_rtin_height, 1,
+     "queries/s"},
+    {"sculpt_heightfield", STR(HF_SAMPLES) "x" STR(HF_SAMPLES) " radius " STR(SCULPT_RADIUS), bench_sculpt, 1,
+     "strokes/s"},
+    {"sculpt_heightfield_4k", STR(RTIN_SAMPLES) "x" STR(RTIN_SAMPLES) " radius " STR(SCULPT_RADIUS), bench_sculpt_4k,
+     1, "strokes/s"},
+    {"frustum_test_box", STR(BLOCK_COUNT) " boxes", bench_frustum_box, BLOCK_COUNT, "boxes/s"},
+    {"blocks_cull", STR(BLOCK_COUNT) " blocks", bench_blocks_cull, BLOCK_COUNT, "blocks/s"},
+    {"block_mesh_build", "16^3 voxels ragged ground", bench_block_mesh, 1, "chunks/s"},
+    {"entities_tick", STR(NPC_COUNT) " npcs", bench_entities_tick, NPC_COUNT, "entities/s"},
+    {"entities_nearest", STR(NPC_COUNT) " npcs, 1024 within 150", bench_entities_nearest, NPC_COUNT, "entities/s"},
+    {"render_queue_sort", STR(RENDER_COMMANDS) " commands", bench_render_queue_sort, RENDER_COMMANDS, "commands/s"},
+};
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void run_bench(const Bench *b) {
+  // warm up and find an op count that fills a sample
+  int ops = 1;
+  for (;;) {
+    double start = now();
+    b->run(ops);
+    double t = now() - start;
+    if (t >= SAMPLE_TIME || ops >= 1 << 30)
+      break;
+    ops = t > 0 ? (int)fmin(ops * fmax(2, 1.2 * SAMPLE_TIME / t), 1 << 30) : ops * 16;
+  }
+
+  double ns[SAMPLES];
+  size_t allocs = 0, bytes = 0;
+  for (int s = 0; s < SAMPLES; s++) {
+    size_t a0 = alloc_count, b0 = alloc_bytes;
+    double start = now();
+    b->run(ops);
+    ns[s] = (now() - start) * 1e9 / ops;
+    allocs = alloc_count - a0;
+    bytes = alloc_bytes - b0;
+  }
+  qsort(ns, SAMPLES, sizeof(double), compare_double);
+  double median = ns[SAMPLES / 2];
+
+  printf("%s,%s,%d,%.2f,%.2f,%.3f,%.4g,%s,", b->name, b->size, ops, median, ns[0],
+         (ns[SAMPLES - 1] - ns[0]) / median, b->items * 1e9 / median, b->unit);
+  if (ALLOC_COUNTING)
+    printf("%.2f,%.1f\n", (double)allocs / ops, (double)bytes / ops);
+  else
+    printf("-1,-1\n");
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  const char *filter = argc > 1 ? argv[1] : "";
+  SetTraceLogLevel(LOG_WARNING);
+
+  fprintf(stderr, "# noise isa %s, %d cpus, %d samples of >= %.0f ms\n", noise_isa_name(noise_best_isa()),
+          parallel_cpu_count(), SAMPLES, SAMPLE_TIME * 1000);
+  setup();
+  printf("kernel,size,ops,ns_per_op,min_ns_per_op,spread,throughput,unit,allocs_per_op,bytes_per_op\n");
+  for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    if (strstr(benches[i].name, filter))
+      run_bench(&benches[i]);
+  teardown();
+  return 0;
+}
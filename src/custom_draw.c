@@ -1,8 +1,6 @@
 #include "custom_draw.h"
 
 
-#define TILE_WIDTH 4
-
 // Draw cube with texture piece applied to all faces (tiled)
 // center at pos
 void draw_textured_cube(Texture2D texture, Vector3 position, float width, float height, float length, Color color)
@@ -88,7 +86,7 @@ void draw_textured_cube(Texture2D texture, Vector3 position, float width, float
     rlSetTexture(0);
 }
 
-Mesh gen_mesh_plane_tiled(float width, float length, int resX, int resZ) {
+Mesh build_mesh_plane_tiled(float width, float length, int resX, int resZ) {
   Mesh mesh = {0};
 
   resX++;
@@ -176,7 +174,37 @@ Mesh gen_mesh_plane_tiled(float width, float length, int resX, int resZ) {
   RL_FREE(texcoords);
   RL_FREE(triangles);
 
+  return mesh;
+}
+
+Mesh gen_mesh_plane_tiled(float width, float length, int resX, int resZ) {
+  Mesh mesh = build_mesh_plane_tiled(width, length, resX, resZ);
+
   // Upload vertex data to GPU (static mesh)
   UploadMesh(&mesh, false);
   return mesh;
-}
\ No newline at end of file
+}
+
+Mesh gen_mesh_box_lines(BoundingBox box) {
+  Mesh mesh = {0};
+  mesh.vertexCount = 24;
+  mesh.vertices = (float *)RL_MALLOC(mesh.vertexCount * 3 * sizeof(float));
+
+  // corner c has bit 0 for max x, 1 for max y, 2 for max z. an edge joins
+  // two corners one bit apart
+  int v = 0;
+  for (int c = 0; c < 8; c++) {
+    for (int bit = 1; bit < 8; bit <<= 1) {
+      if (c & bit) continue;
+      int ends[2] = {c, c | bit};
+      for (int e = 0; e < 2; e++, v++) {
+        mesh.vertices[3 * v] = ends[e] & 1 ? box.max.x : box.min.x;
+        mesh.vertices[3 * v + 1] = ends[e] & 2 ? box.max.y : box.min.y;
+        mesh.vertices[3 * v + 2] = ends[e] & 4 ? box.max.z : box.min.z;
+      }
+    }
+  }
+
+  UploadMesh(&mesh, false);
+  return mesh;
+}
@@ -5,8 +5,14 @@
 #include <rlgl.h>
 #include <stdlib.h>
 
+#define TILE_WIDTH 4 // world units per texture repeat on cube faces
+
 void draw_textured_cube(Texture2D texture, Vector3 position, float width, float height, float length, Color color);
 // Generate a plane with tiled uv coordinated
 Mesh gen_mesh_plane_tiled(float width, float length, int resX, int resZ);
+// Same plane without the upload, cpu arrays only
+Mesh build_mesh_plane_tiled(float width, float length, int resX, int resZ);
+// The 12 edges of a box as 24 line vertices, uploaded, for RENDER_LINES
+Mesh gen_mesh_box_lines(BoundingBox box);
 
 #endif
\ No newline at end of file
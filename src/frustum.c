@@ -0,0 +1,93 @@
+#include "frustum.h"
+
+#include <math.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+Frustum frustum_from_matrix(Matrix m) {
+    // rows of the matrix as raylib applies it, clip = row . (x, y, z, 1)
+    float rows[4][4] = {
+        {m.m0, m.m4, m.m8, m.m12},
+        {m.m1, m.m5, m.m9, m.m13},
+        {m.m2, m.m6, m.m10, m.m14},
+        {m.m3, m.m7, m.m11, m.m15},
+    };
+
+    // -w <= x, y, z <= w gives left, right, bottom, top, near, far
+    Frustum frustum;
+    for (int i = 0; i < 8; i++) {
+        float plane[4] = {0, 0, 0, 1};
+        if (i < 6) {
+            float sign = i % 2 ? -1.0f : 1.0f;
+            const float *row = rows[i / 2];
+            for (int k = 0; k < 4; k++) plane[k] = rows[3][k] + sign*row[k];
+            float length = sqrtf(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+            if (length > 0) for (int k = 0; k < 4; k++) plane[k] /= length;
+        }
+        frustum.a[i] = plane[0];
+        frustum.b[i] = plane[1];
+        frustum.c[i] = plane[2];
+        frustum.d[i] = plane[3];
+    }
+    return frustum;
+}
+
+Frustum frustum_from_camera(Camera3D camera, float aspect) {
+    double near = rlGetCullDistanceNear(), far = rlGetCullDistanceFar();
+    Matrix projection;
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        projection = MatrixPerspective(camera.fovy*DEG2RAD, aspect, near, far);
+    } else {
+        double top = camera.fovy/2.0, right = top*aspect;
+        projection = MatrixOrtho(-right, right, -top, top, near, far);
+    }
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    return frustum_from_matrix(MatrixMultiply(view, projection));
+}
+
+// a box is outside when its corner furthest along some plane's normal is
+// behind it, and fully inside when even the nearest corner of every plane
+// is in front. per axis the furthest corner is just the larger product
+FrustumResult frustum_test_box(const Frustum *f, BoundingBox box) {
+#ifdef __SSE2__
+    __m128 min_x = _mm_set1_ps(box.min.x), max_x = _mm_set1_ps(box.max.x);
+    __m128 min_y = _mm_set1_ps(box.min.y), max_y = _mm_set1_ps(box.max.y);
+    __m128 min_z = _mm_set1_ps(box.min.z), max_z = _mm_set1_ps(box.max.z);
+    __m128 zero = _mm_setzero_ps();
+    __m128 outside = zero, intersect = zero;
+
+    for (int i = 0; i < 8; i += 4) {
+        __m128 a = _mm_load_ps(&f->a[i]), b = _mm_load_ps(&f->b[i]);
+        __m128 c = _mm_load_ps(&f->c[i]), d = _mm_load_ps(&f->d[i]);
+        __m128 x0 = _mm_mul_ps(a, min_x), x1 = _mm_mul_ps(a, max_x);
+        __m128 y0 = _mm_mul_ps(b, min_y), y1 = _mm_mul_ps(b, max_y);
+        __m128 z0 = _mm_mul_ps(c, min_z), z1 = _mm_mul_ps(c, max_z);
+
+        __m128 furthest = _mm_add_ps(_mm_add_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)),
+                                     _mm_add_ps(_mm_max_ps(z0, z1), d));
+        __m128 nearest = _mm_add_ps(_mm_add_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)),
+                                    _mm_add_ps(_mm_min_ps(z0, z1), d));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(furthest, zero));
+        intersect = _mm_or_ps(intersect, _mm_cmplt_ps(nearest, zero));
+    }
+
+    if (_mm_movemask_ps(outside)) return FRUSTUM_OUTSIDE;
+    return _mm_movemask_ps(intersect) ? FRUSTUM_INTERSECT : FRUSTUM_INSIDE;
+#else
+    FrustumResult result = FRUSTUM_INSIDE;
+    for (int i = 0; i < 6; i++) {
+        float x0 = f->a[i]*box.min.x, x1 = f->a[i]*box.max.x;
+        float y0 = f->b[i]*box.min.y, y1 = f->b[i]*box.max.y;
+        float z0 = f->c[i]*box.min.z, z1 = f->c[i]*box.max.z;
+        float furthest = (fmaxf(x0, x1) + fmaxf(y0, y1)) + (fmaxf(z0, z1) + f->d[i]);
+        float nearest = (fminf(x0, x1) + fminf(y0, y1)) + (fminf(z0, z1) + f->d[i]);
+        if (furthest < 0) return FRUSTUM_OUTSIDE;
+        if (nearest < 0) result = FRUSTUM_INTERSECT;
+    }
+    return result;
+#endif
+}
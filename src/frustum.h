@@ -0,0 +1,40 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <raylib.h>
+
+// view frustum culling. planes come from the camera's view-projection and
+// point inwards. a box is tested against all six planes at once (four lanes
+// of SSE at a time), hierarchies skip the tests for children of a node that
+// is fully inside.
+
+typedef enum FrustumResult {
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECT,
+    FRUSTUM_INSIDE
+} FrustumResult;
+
+// plane i is a[i]*x + b[i]*y + c[i]*z + d[i] >= 0 inside, padded to 8 with
+// planes everything is inside of
+typedef struct Frustum {
+    _Alignas(16) float a[8];
+    _Alignas(16) float b[8];
+    _Alignas(16) float c[8];
+    _Alignas(16) float d[8];
+} Frustum;
+
+// objects that passed or failed the test, counted at the level they were
+// decided at
+typedef struct CullStats {
+    int visible;
+    int culled;
+} CullStats;
+
+// planes of a combined view * projection matrix (raylib order, view first)
+Frustum frustum_from_matrix(Matrix view_projection);
+// same view and projection BeginMode3D uses for this camera
+Frustum frustum_from_camera(Camera3D camera, float aspect);
+
+FrustumResult frustum_test_box(const Frustum *frustum, BoundingBox box);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+// the gl calls rlgl has no wrapper for (texture arrays, offset and instanced
+// draws), made through the function pointers raylib's bundled glad
+// (external/glad.h) loads in InitWindow rather than the system gl's
+// prototypes. like any rlgl call they need the window's context
+
+#if defined(_WIN32) && !defined(_WIN64)
+#define GL_EXT_API __stdcall
+#else
+#define GL_EXT_API
+#endif
+
+#define GL_LINES 0x0001
+#define GL_TRIANGLES 0x0004
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_UNSIGNED_SHORT 0x1403
+#define GL_UNSIGNED_INT 0x1405
+#define GL_TEXTURE_2D 0x0DE1
+#define GL_TEXTURE_2D_ARRAY 0x8C1A
+#define GL_TEXTURE_MIN_FILTER 0x2801
+#define GL_TEXTURE_MAG_FILTER 0x2800
+#define GL_TEXTURE_WRAP_S 0x2802
+#define GL_TEXTURE_WRAP_T 0x2803
+#define GL_LINEAR 0x2601
+#define GL_LINEAR_MIPMAP_LINEAR 0x2703
+#define GL_REPEAT 0x2901
+#define GL_RGBA 0x1908
+#define GL_RGBA8 0x8058
+
+extern void (GL_EXT_API *glad_glGenTextures)(int n, unsigned int *textures);
+extern void (GL_EXT_API *glad_glDeleteTextures)(int n, const unsigned int *textures);
+extern void (GL_EXT_API *glad_glBindTexture)(unsigned int target, unsigned int texture);
+extern void (GL_EXT_API *glad_glTexParameteri)(unsigned int target, unsigned int pname, int param);
+extern void (GL_EXT_API *glad_glTexImage3D)(unsigned int target, int level, int internalformat, int width, int height,
+                                            int depth, int border, unsigned int format, unsigned int type,
+                                            const void *pixels);
+extern void (GL_EXT_API *glad_glTexSubImage3D)(unsigned int target, int level, int xoffset, int yoffset, int zoffset,
+                                               int width, int height, int depth, unsigned int format,
+                                               unsigned int type, const void *pixels);
+extern void (GL_EXT_API *glad_glGenerateMipmap)(unsigned int target);
+extern void (GL_EXT_API *glad_glDrawArrays)(unsigned int mode, int first, int count);
+extern void (GL_EXT_API *glad_glDrawArraysInstanced)(unsigned int mode, int first, int count, int instances);
+extern void (GL_EXT_API *glad_glDrawElements)(unsigned int mode, int count, unsigned int type, const void *indices);
+extern void (GL_EXT_API *glad_glDrawElementsInstanced)(unsigned int mode, int count, unsigned int type,
+                                                       const void *indices, int instances);
+
+// glad's names, so calls read like plain gl
+#define glGenTextures glad_glGenTextures
+#define glDeleteTextures glad_glDeleteTextures
+#define glBindTexture glad_glBindTexture
+#define glTexParameteri glad_glTexParameteri
+#define glTexImage3D glad_glTexImage3D
+#define glTexSubImage3D glad_glTexSubImage3D
+#define glGenerateMipmap glad_glGenerateMipmap
+#define glDrawArrays glad_glDrawArrays
+#define glDrawArraysInstanced glad_glDrawArraysInstanced
+#define glDrawElements glad_glDrawElements
+#define glDrawElementsInstanced glad_glDrawElementsInstanced
+
+#endif
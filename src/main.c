@@ -7,75 +7,20 @@
 #include <stdint.h>
 
 #include "custom_draw.h"
+#include "frustum.h"
+#include "map.h"
+#include "map_mesh.h"
+#include "render_queue.h"
 
 #define MAX(X, Y) (X) > (Y) ? (X) : (Y)
 
 #define MOVE_SPEED 20
 #define TURN_SPEED 250
 #define MOUSE_SENS 0.1
-#define TILE_SIZE 10
 #define PLAYER_RADIUS 2
 
-typedef struct Map {
-    int **walls;
-    int wall_count;
-    Rectangle *colliders;
-    
-    Vector2 origin; // TOP LEFT!!!!!!! in x,z plane!!!!!
-    int width;
-    int height;
-} Map;
-
-enum TextureIndex {
-    EMPTY,
-    BRICK,
-    OTHER
-};
-
-int texture_from_blue(int b) {
-    switch (b){
-        case 0: return EMPTY;
-        case 255: return BRICK;
-        case 100: return OTHER;
-    }
-}
-
 char *debug_msg = "Chill";
 
-void init_map(Map *map, Image image, Vector2 origin) {
-    map->width = image.width;
-    map->height = image.height;
-    map->origin = origin;
-
-    // Walls array
-    map->walls = calloc(sizeof(int*), image.height);
-    for (int i=0; i < image.width; i++){
-        map->walls[i] = calloc(sizeof(int), image.width);
-    }
-    
-    Color *colors= LoadImageColors(image);
-    int wall_count = 0;
-    for (int i=0; i < image.height; i++){
-        for (int j=0; j < image.width; j++){
-            int value = texture_from_blue(colors[i*image.height + j].b);
-            if (value != EMPTY) {
-                map->walls[i][j] = texture_from_blue(colors[i*image.height + j].b);
-                wall_count++;
-            }
-        }
-    }
-    map->wall_count = wall_count;
-    map->colliders = calloc(wall_count, sizeof(Rectangle));
-    int collider_index = 0;
-    for (int i=0; i < image.height; i++){
-        for (int j=0; j < image.width; j++){
-            if (map->walls[i][j] != 0) {
-                map->colliders[collider_index++] = (Rectangle){j*TILE_SIZE, i*TILE_SIZE, TILE_SIZE, TILE_SIZE};
-            }
-        }
-    }
-}
-
 void player_movement(Camera *camera, Map map, float dt) {
 
     // Vector3 looking = Vector3Normalize(Vector3Subtract(camera->target, camera->position));
@@ -110,27 +55,20 @@ void player_movement(Camera *camera, Map map, float dt) {
     UpdateCameraPro(camera, (Vector3){ry, rx, 0}, (Vector3){rotation, 0, 0}, 0);
 }
 
-void draw_map(Model floor, Map map, Texture *wall_textures) {
+void draw_map(Model floor, Map map, const MapMesh *walls, RenderQueue *queue, Vector3 eye, const Frustum *frustum,
+              CullStats *stats) {
     // floor/ceiling
     int width = map.width, length = map.height;
     Vector2 top_left_pos = map.origin;
+    Vector3 center = {top_left_pos.x+TILE_SIZE*width/2, 0, top_left_pos.y+TILE_SIZE*length/2};
 
-    DrawModel(floor, (Vector3){top_left_pos.x+TILE_SIZE*width/2, 0, top_left_pos.y+TILE_SIZE*length/2}, 1, WHITE);
-    DrawModelEx(floor, (Vector3){top_left_pos.x+TILE_SIZE*width/2, 4, top_left_pos.y+TILE_SIZE*length/2}, (Vector3){0, 0, 1},
-                180, Vector3One(), WHITE);
-
-    // Walls
-    for (int i = 1; i <= length; i++){
-        for (int j = 1; j <= width; j++){
-            if (map.walls[i-1][j-1] > 0){
-                int wall_tex = map.walls[i-1][j-1] - 1;
-
-                Vector2 pos = Vector2Add(top_left_pos, (Vector2){j*TILE_SIZE - TILE_SIZE/2, i*TILE_SIZE - TILE_SIZE/2});
-                draw_textured_cube(wall_textures[wall_tex], (Vector3){pos.x, 2, pos.y}, TILE_SIZE, 4, TILE_SIZE, WHITE);
-            }
-        }
-    }
+    render_queue_mesh(queue, floor.meshes[0], floor.materials[0], MatrixTranslate(center.x, 0, center.z), 0);
+    Matrix ceiling = MatrixMultiply(MatrixRotate((Vector3){0, 0, 1}, 180*DEG2RAD),
+                                    MatrixTranslate(center.x, WALL_HEIGHT, center.z));
+    render_queue_mesh(queue, floor.meshes[0], floor.materials[0], ceiling, 0);
 
+    // Walls, baked once, a draw call per texture per region in view
+    draw_map_mesh(walls, queue, frustum, eye, stats);
 }
 
 int main() {
@@ -161,14 +99,21 @@ int main() {
     Texture wall_textures[2] = {wall1_texture, mario};
     Image map_image = LoadImage("res/map.png");
     Map map;
-    init_map(&map, map_image, (Vector2){-map.width*TILE_SIZE/2,-map.height*TILE_SIZE/2});
+    init_map(&map, map_image, (Vector2){-map_image.width*TILE_SIZE/2,-map_image.height*TILE_SIZE/2});
+    MapMesh map_mesh = bake_map_mesh(&map);
+    upload_map_mesh(&map_mesh, wall_textures);
 
     BoundingBox box = {(Vector3){0,0,0},{2, 2, 2}};
+    Mesh box_lines = gen_mesh_box_lines(box);
 
     Mesh plane_mesh = gen_mesh_plane_tiled(map.width*TILE_SIZE, map.height*TILE_SIZE, map.width, map.height);
     Model plane_model = LoadModelFromMesh(plane_mesh);
     plane_model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = floor_texture;
 
+    CullStats wall_stats = {0};
+    RenderQueue queue;
+    render_queue_init(&queue);
+
     DisableCursor();
     while (!WindowShouldClose()) {
         SetWindowTitle(TextFormat("%dfps",GetFPS()));
@@ -183,18 +128,34 @@ int main() {
 
 
             // Objects
-            DrawBoundingBox(box, BLUE);
+            Vector3 box_center = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+            RenderCommand *box_draw = render_queue_push(&queue, plane_model.materials[0].shader, box_lines.vaoId, 0,
+                                                        box_lines.vertexCount, RENDER_LINES,
+                                                        Vector3Distance(camera.position, box_center));
+            box_draw->textures[0] = rlGetTextureIdDefault();
+            box_draw->color = BLUE;
 
             // Map
-            draw_map(plane_model, map, wall_textures);
+            Frustum frustum = frustum_from_camera(camera, (float)GetScreenWidth()/GetScreenHeight());
+            draw_map(plane_model, map, &map_mesh, &queue, camera.position, &frustum, &wall_stats);
+            render_queue_flush(&queue);
 
             EndMode3D();
             DrawText(debug_msg, 10, 10, 32, RAYWHITE);
+            DrawText(TextFormat("Walls: %d faces (%d shared dropped), %d draw calls, %d culled",
+                                map_mesh.faces, map_mesh.dropped, wall_stats.visible, wall_stats.culled), 10, 50, 20, RAYWHITE);
+            RenderStats *draws = &queue.stats;
+            DrawText(TextFormat("Draws: %d, binds %d shader %d texture %d vao, %d uniforms, %d skipped",
+                                draws->commands, draws->shader_binds, draws->texture_binds, draws->vao_binds,
+                                draws->uniform_sets, draws->skipped), 10, 75, 20, RAYWHITE);
 
         }
         EndDrawing();
     }
 
+    render_queue_unload(&queue);
+    UnloadMesh(box_lines);
+    unload_map_mesh(&map_mesh);
     UnloadModel(plane_model);
     UnloadTexture(floor_texture);
     CloseWindow();
@@ -0,0 +1,56 @@
+#include "map.h"
+
+#include <stdlib.h>
+
+int texture_from_blue(int b) {
+    switch (b){
+        case 255: return BRICK;
+        case 100: return OTHER;
+        default: return EMPTY;
+    }
+}
+
+void init_map(Map *map, Image image, Vector2 origin) {
+    map->width = image.width;
+    map->height = image.height;
+    map->origin = origin;
+
+    // Walls array
+    map->walls = calloc(sizeof(int*), image.height);
+    for (int i=0; i < image.height; i++){
+        map->walls[i] = calloc(sizeof(int), image.width);
+    }
+    
+    Color *colors= LoadImageColors(image);
+    int wall_count = 0;
+    for (int i=0; i < image.height; i++){
+        for (int j=0; j < image.width; j++){
+            int value = texture_from_blue(colors[i*image.width + j].b);
+            if (value != EMPTY) {
+                map->walls[i][j] = value;
+                wall_count++;
+            }
+        }
+    }
+    UnloadImageColors(colors);
+    map->wall_count = wall_count;
+    map->colliders = calloc(wall_count, sizeof(Rectangle));
+    int collider_index = 0;
+    for (int i=0; i < image.height; i++){
+        for (int j=0; j < image.width; j++){
+            if (map->walls[i][j] != 0) {
+                map->colliders[collider_index++] = (Rectangle){j*TILE_SIZE, i*TILE_SIZE, TILE_SIZE, TILE_SIZE};
+            }
+        }
+    }
+}
+
+void unload_map(Map *map) {
+    for (int i=0; i < map->height; i++){
+        free(map->walls[i]);
+    }
+    free(map->walls);
+    free(map->colliders);
+    map->walls = NULL;
+    map->colliders = NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include <raylib.h>
+
+#define TILE_SIZE 10
+#define WALL_HEIGHT 4
+
+typedef struct Map {
+    int **walls;
+    int wall_count;
+    Rectangle *colliders;
+
+    Vector2 origin; // TOP LEFT!!!!!!! in x,z plane!!!!!
+    int width;
+    int height;
+} Map;
+
+enum TextureIndex {
+    EMPTY,
+    BRICK,
+    OTHER
+};
+
+int texture_from_blue(int b);
+// One wall per non empty pixel, texture picked from the blue channel
+void init_map(Map *map, Image image, Vector2 origin);
+void unload_map(Map *map);
+
+#endif
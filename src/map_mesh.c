@@ -0,0 +1,169 @@
+#include "map_mesh.h"
+
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdlib.h>
+
+#include "custom_draw.h"
+
+// Corners of a wall side in draw_textured_cube's order and texture tiling
+typedef struct WallSide {
+    int di, dj; // the neighbouring tile
+    Vector3 normal;
+    Vector3 corners[4]; // 0 or 1 per axis, scaled to the tile
+    Vector2 uvs[4]; // in texture repeats across the side
+} WallSide;
+
+#define U ((float)TILE_SIZE/TILE_WIDTH)
+#define V ((float)WALL_HEIGHT/TILE_WIDTH)
+
+static const WallSide sides[4] = {
+    {1, 0, {0, 0, 1}, {{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}}, {{0, V}, {U, V}, {U, 0}, {0, 0}}}, // front
+    {-1, 0, {0, 0, -1}, {{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}}, {{U, V}, {U, 0}, {0, 0}, {0, V}}}, // back
+    {0, 1, {1, 0, 0}, {{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}}, {{U, V}, {U, 0}, {0, 0}, {0, V}}}, // right
+    {0, -1, {-1, 0, 0}, {{0, 0, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 0}}, {{0, V}, {U, V}, {U, 0}, {0, 0}}}, // left
+};
+
+static bool is_wall(const Map *map, int i, int j) {
+    return i >= 0 && j >= 0 && i < map->height && j < map->width && map->walls[i][j] != EMPTY;
+}
+
+static Mesh alloc_quads(int quads) {
+    Mesh mesh = {0};
+    mesh.vertexCount = quads*4;
+    mesh.triangleCount = quads*2;
+    mesh.vertices = RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+    mesh.texcoords = RL_MALLOC(mesh.vertexCount*2*sizeof(float));
+    mesh.normals = RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+    mesh.indices = RL_MALLOC(mesh.triangleCount*3*sizeof(unsigned short));
+    return mesh;
+}
+
+// Appends the visible sides of tile (i, j) to mesh from quad on, returns the next quad
+static int add_sides(const Map *map, int i, int j, Mesh *mesh, BoundingBox *box, int quad) {
+    Vector3 min = {map->origin.x + j*TILE_SIZE, 0, map->origin.y + i*TILE_SIZE};
+    for (int s = 0; s < 4; s++){
+        const WallSide *side = &sides[s];
+        if (is_wall(map, i + side->di, j + side->dj)) continue;
+
+        int v = quad*4;
+        for (int k = 0; k < 4; k++){
+            Vector3 c = side->corners[k];
+            Vector3 p = {min.x + c.x*TILE_SIZE, c.y*WALL_HEIGHT, min.z + c.z*TILE_SIZE};
+            mesh->vertices[3*(v + k)] = p.x;
+            mesh->vertices[3*(v + k) + 1] = p.y;
+            mesh->vertices[3*(v + k) + 2] = p.z;
+            mesh->normals[3*(v + k)] = side->normal.x;
+            mesh->normals[3*(v + k) + 1] = side->normal.y;
+            mesh->normals[3*(v + k) + 2] = side->normal.z;
+            mesh->texcoords[2*(v + k)] = side->uvs[k].x;
+            mesh->texcoords[2*(v + k) + 1] = side->uvs[k].y;
+            if (quad == 0 && k == 0) *box = (BoundingBox){p, p};
+            box->min = Vector3Min(box->min, p);
+            box->max = Vector3Max(box->max, p);
+        }
+        // Same split as RL_QUADS
+        unsigned short *tri = &mesh->indices[quad*6];
+        tri[0] = v; tri[1] = v + 1; tri[2] = v + 2;
+        tri[3] = v; tri[4] = v + 2; tri[5] = v + 3;
+        quad++;
+    }
+    return quad;
+}
+
+MapMesh bake_map_mesh(const Map *map) {
+    MapMesh baked = {0};
+    int regions_x = (map->width + MAP_MESH_REGION - 1)/MAP_MESH_REGION;
+    int regions_z = (map->height + MAP_MESH_REGION - 1)/MAP_MESH_REGION;
+
+    // Visible sides per region and texture first, to size the meshes
+    int *faces = RL_CALLOC(regions_x*regions_z*MAP_TEXTURES, sizeof(int));
+    for (int i = 0; i < map->height; i++){
+        for (int j = 0; j < map->width; j++){
+            if (map->walls[i][j] == EMPTY) continue;
+            int region = (i/MAP_MESH_REGION)*regions_x + j/MAP_MESH_REGION;
+            for (int s = 0; s < 4; s++){
+                if (is_wall(map, i + sides[s].di, j + sides[s].dj)) baked.dropped++;
+                else faces[region*MAP_TEXTURES + map->walls[i][j] - 1]++;
+            }
+        }
+    }
+
+    int mesh_count = 0;
+    for (int k = 0; k < regions_x*regions_z*MAP_TEXTURES; k++){
+        mesh_count += faces[k] > 0;
+        baked.faces += faces[k];
+    }
+    baked.meshes = RL_CALLOC(mesh_count, sizeof(Mesh));
+    baked.textures = RL_CALLOC(mesh_count, sizeof(int));
+    baked.boxes = RL_CALLOC(mesh_count, sizeof(BoundingBox));
+
+    // Then fill them, a region and a texture at a time
+    for (int rz = 0; rz < regions_z; rz++){
+        for (int rx = 0; rx < regions_x; rx++){
+            int i0 = rz*MAP_MESH_REGION, j0 = rx*MAP_MESH_REGION;
+            int i1 = i0 + MAP_MESH_REGION < map->height ? i0 + MAP_MESH_REGION : map->height;
+            int j1 = j0 + MAP_MESH_REGION < map->width ? j0 + MAP_MESH_REGION : map->width;
+            for (int t = 0; t < MAP_TEXTURES; t++){
+                int quads = faces[(rz*regions_x + rx)*MAP_TEXTURES + t];
+                if (quads == 0) continue;
+                int m = baked.mesh_count++;
+                Mesh *mesh = &baked.meshes[m];
+                *mesh = alloc_quads(quads);
+                baked.textures[m] = t;
+                int quad = 0;
+                for (int i = i0; i < i1; i++){
+                    for (int j = j0; j < j1; j++){
+                        if (map->walls[i][j] - 1 == t) quad = add_sides(map, i, j, mesh, &baked.boxes[m], quad);
+                    }
+                }
+            }
+        }
+    }
+    RL_FREE(faces);
+    return baked;
+}
+
+void upload_map_mesh(MapMesh *mesh, Texture *wall_textures) {
+    for (int m = 0; m < mesh->mesh_count; m++){
+        UploadMesh(&mesh->meshes[m], false);
+    }
+    mesh->material = LoadMaterialDefault();
+    mesh->wall_textures = wall_textures;
+}
+
+void draw_map_mesh(const MapMesh *mesh, RenderQueue *queue, const Frustum *frustum, Vector3 eye, CullStats *stats) {
+    *stats = (CullStats){0};
+    for (int m = 0; m < mesh->mesh_count; m++){
+        BoundingBox box = mesh->boxes[m];
+        if (frustum_test_box(frustum, box) == FRUSTUM_OUTSIDE){
+            stats->culled++;
+            continue;
+        }
+        Vector3 center = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+        RenderCommand *command = render_queue_mesh(queue, mesh->meshes[m], mesh->material, MatrixIdentity(),
+                                                   Vector3Distance(center, eye));
+        command->textures[0] = mesh->wall_textures[mesh->textures[m]].id;
+        stats->visible++;
+    }
+}
+
+void unload_map_mesh(MapMesh *mesh) {
+    bool uploaded = mesh->material.maps != NULL;
+    for (int m = 0; m < mesh->mesh_count; m++){
+        if (uploaded){
+            UnloadMesh(mesh->meshes[m]);
+        } else {
+            RL_FREE(mesh->meshes[m].vertices);
+            RL_FREE(mesh->meshes[m].texcoords);
+            RL_FREE(mesh->meshes[m].normals);
+            RL_FREE(mesh->meshes[m].indices);
+        }
+    }
+    // Not UnloadMaterial, the textures belong to the caller
+    if (uploaded) RL_FREE(mesh->material.maps);
+    RL_FREE(mesh->meshes);
+    RL_FREE(mesh->textures);
+    RL_FREE(mesh->boxes);
+    *mesh = (MapMesh){0};
+}
@@ -0,0 +1,39 @@
+#ifndef MAP_MESH_H
+#define MAP_MESH_H
+
+#include <raylib.h>
+
+#include "frustum.h"
+#include "map.h"
+#include "render_queue.h"
+
+#define MAP_TEXTURES 2 // wall textures, walls[i][j] - 1 indexes them
+// tiles per side of a baked block, at most 64 so the 4 sides per tile keep
+// indices 16 bit
+#define MAP_MESH_REGION 8
+
+// The walls baked once into static meshes, one per wall texture in each
+// MAP_MESH_REGION square of tiles, so whole blocks are frustum culled. Sides
+// two walls share are dropped, so are tops and bottoms, the floor and ceiling
+// cover those
+typedef struct MapMesh {
+    Mesh *meshes;
+    int *textures; // per mesh, index into the wall textures
+    BoundingBox *boxes; // per mesh, around its walls
+    int mesh_count;
+    int faces; // kept
+    int dropped; // sides against another wall
+    Material material; // default shader, the diffuse map comes from wall_textures
+    Texture *wall_textures; // not owned
+} MapMesh;
+
+// Cpu arrays only
+MapMesh bake_map_mesh(const Map *map);
+// Uploads the meshes, wall_textures has MAP_TEXTURES entries
+void upload_map_mesh(MapMesh *mesh, Texture *wall_textures);
+// Queues a draw per mesh in view, eye orders them front to back. stats
+// counts meshes
+void draw_map_mesh(const MapMesh *mesh, RenderQueue *queue, const Frustum *frustum, Vector3 eye, CullStats *stats);
+void unload_map_mesh(MapMesh *mesh);
+
+#endif
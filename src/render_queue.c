@@ -0,0 +1,293 @@
+#include "render_queue.h"
+
+#include <raymath.h>
+#include <rlgl.h>
+#include <string.h>
+
+#include "gl_ext.h"
+
+void render_queue_init(RenderQueue *queue) {
+    *queue = (RenderQueue){0};
+}
+
+void render_queue_unload(RenderQueue *queue) {
+    RL_FREE(queue->commands);
+    RL_FREE(queue->uniforms);
+    RL_FREE(queue->keys);
+    RL_FREE(queue->order);
+    *queue = (RenderQueue){0};
+}
+
+//---Submission---
+
+RenderCommand *render_queue_push(RenderQueue *queue, Shader shader, unsigned int vao, int first, int count, int flags, float depth) {
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity*2 : 256;
+        queue->commands = RL_REALLOC(queue->commands, queue->capacity*sizeof(RenderCommand));
+        queue->keys = RL_REALLOC(queue->keys, queue->capacity*2*sizeof(uint64_t));
+        queue->order = RL_REALLOC(queue->order, queue->capacity*2*sizeof(uint32_t));
+    }
+    RenderCommand *command = &queue->commands[queue->count++];
+    *command = (RenderCommand){
+        .shader = shader, .vao = vao, .first = first, .count = count, .flags = flags,
+        .color = WHITE, .depth = depth, .transform = MatrixIdentity(),
+        .uniform_first = queue->uniform_count,
+    };
+    return command;
+}
+
+static int components(int type) {
+    return type < SHADER_UNIFORM_INT ? type - SHADER_UNIFORM_FLOAT + 1 : type - SHADER_UNIFORM_INT + 1;
+}
+
+void render_queue_uniform(RenderQueue *queue, int loc, int type, const void *value) {
+    if (queue->uniform_count == queue->uniform_capacity) {
+        queue->uniform_capacity = queue->uniform_capacity ? queue->uniform_capacity*2 : 256;
+        queue->uniforms = RL_REALLOC(queue->uniforms, queue->uniform_capacity*sizeof(RenderUniform));
+    }
+    RenderUniform *uniform = &queue->uniforms[queue->uniform_count++];
+    *uniform = (RenderUniform){.loc = loc, .type = type};
+    memcpy(uniform->value.f, value, components(type)*sizeof(float));
+    queue->commands[queue->count - 1].uniform_count++;
+}
+
+RenderCommand *render_queue_mesh(RenderQueue *queue, Mesh mesh, Material material, Matrix transform, float depth) {
+    bool indexed = mesh.indices != NULL;
+    int count = indexed ? mesh.triangleCount*3 : mesh.vertexCount;
+    RenderCommand *command = render_queue_push(queue, material.shader, mesh.vaoId, 0, count,
+                                               indexed ? RENDER_INDEX_16 : 0, depth);
+    command->textures[0] = material.maps[MATERIAL_MAP_DIFFUSE].texture.id;
+    command->color = material.maps[MATERIAL_MAP_DIFFUSE].color;
+    command->transform = transform;
+    return command;
+}
+
+//---Sorting---
+
+// shader 12 bits, textures 16 (a hash of all the slots, so draws with the
+// same set end up together), vao 16, depth 20. a positive float's bits sort
+// like its value, the top 20 keep the exponent and 11 bits of mantissa
+static uint64_t command_key(const RenderCommand *command) {
+    uint32_t textures = 0;
+    for (int i = 0; i < RENDER_TEXTURE_SLOTS; i++) textures = textures*31 + command->textures[i];
+    uint32_t depth = 0;
+    if (command->depth > 0) memcpy(&depth, &command->depth, sizeof(depth));
+    return (uint64_t)(command->shader.id & 0xfff) << 52 | (uint64_t)(textures & 0xffff) << 36 |
+           (uint64_t)(command->vao & 0xffff) << 20 | depth >> 11;
+}
+
+void render_queue_sort(RenderQueue *queue) {
+    int n = queue->count;
+    uint64_t *keys = queue->keys, *keys_tmp = queue->keys + queue->capacity;
+    uint32_t *order = queue->order, *order_tmp = queue->order + queue->capacity;
+    for (int i = 0; i < n; i++) {
+        keys[i] = command_key(&queue->commands[i]);
+        order[i] = i;
+    }
+
+    // lsd, a byte per pass. bytes every key shares skip their pass
+    for (int shift = 0; shift < 64; shift += 8) {
+        int counts[256] = {0};
+        for (int i = 0; i < n; i++) counts[keys[i] >> shift & 0xff]++;
+        if (n == 0 || counts[keys[0] >> shift & 0xff] == n) continue;
+
+        int offset = 0;
+        for (int b = 0; b < 256; b++) {
+            int c = counts[b];
+            counts[b] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++) {
+            int dst = counts[keys[i] >> shift & 0xff]++;
+            keys_tmp[dst] = keys[i];
+            order_tmp[dst] = order[i];
+        }
+        uint64_t *k = keys;
+        keys = keys_tmp;
+        keys_tmp = k;
+        uint32_t *o = order;
+        order = order_tmp;
+        order_tmp = o;
+    }
+
+    // odd passes leave the result in the scratch half
+    if (order != queue->order) {
+        memcpy(queue->keys, keys, n*sizeof(uint64_t));
+        memcpy(queue->order, order, n*sizeof(uint32_t));
+    }
+}
+
+//---Replay---
+
+// what the gl state is, as far as the queue knows
+typedef struct ReplayState {
+    unsigned int shader;
+    unsigned int textures[RENDER_TEXTURE_SLOTS];
+    bool texture_array; // slot 0 had one bound
+    unsigned int vao;
+    bool vao_bound;
+    // per shader, reset when it changes
+    bool has_transform, has_color;
+    Matrix transform;
+    Color color;
+    bool cached[RENDER_UNIFORM_CACHE];
+    RenderUniform uniforms[RENDER_UNIFORM_CACHE];
+} ReplayState;
+
+static void bind_shader(ReplayState *state, Shader shader, Matrix view, Matrix projection, RenderStats *stats) {
+    rlEnableShader(shader.id);
+    state->shader = shader.id;
+    state->has_transform = state->has_color = false;
+    memset(state->cached, 0, sizeof(state->cached));
+    stats->shader_binds++;
+
+    const int *locs = shader.locs;
+    if (locs[SHADER_LOC_MATRIX_VIEW] != -1) {
+        rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_VIEW], view);
+        stats->uniform_sets++;
+    }
+    if (locs[SHADER_LOC_MATRIX_PROJECTION] != -1) {
+        rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_PROJECTION], projection);
+        stats->uniform_sets++;
+    }
+    if (locs[SHADER_LOC_MAP_DIFFUSE] != -1) {
+        int slot = 0;
+        rlSetUniform(locs[SHADER_LOC_MAP_DIFFUSE], &slot, SHADER_UNIFORM_INT, 1);
+        stats->uniform_sets++;
+    }
+}
+
+static void set_uniform(ReplayState *state, const RenderUniform *uniform, RenderStats *stats) {
+    if (uniform->loc < 0) return;
+    size_t size = components(uniform->type)*sizeof(float);
+    if (uniform->loc < RENDER_UNIFORM_CACHE) {
+        RenderUniform *cached = &state->uniforms[uniform->loc];
+        if (state->cached[uniform->loc] && cached->type == uniform->type &&
+            memcmp(cached->value.f, uniform->value.f, size) == 0) {
+            stats->skipped++;
+            return;
+        }
+        *cached = *uniform;
+        state->cached[uniform->loc] = true;
+    }
+    rlSetUniform(uniform->loc, uniform->value.f, uniform->type, 1);
+    stats->uniform_sets++;
+}
+
+void render_queue_flush(RenderQueue *queue) {
+    render_queue_sort(queue);
+
+    RenderStats *stats = &queue->stats;
+    *stats = (RenderStats){.commands = queue->count};
+    Matrix view = rlGetMatrixModelview();
+    Matrix projection = rlGetMatrixProjection();
+    Matrix world = rlGetMatrixTransform();
+    ReplayState state = {0};
+
+    // meshes without a colour buffer read the attribute's current value,
+    // white like DrawMesh sets it
+    float white[4] = {1, 1, 1, 1};
+    rlSetVertexAttributeDefault(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, white, SHADER_ATTRIB_VEC4, 4);
+
+    for (int k = 0; k < queue->count; k++) {
+        const RenderCommand *command = &queue->commands[queue->order[k]];
+        const int *locs = command->shader.locs;
+
+        if (command->shader.id != state.shader) bind_shader(&state, command->shader, view, projection, stats);
+        else stats->skipped++;
+
+        for (int i = 0; i < RENDER_TEXTURE_SLOTS; i++) {
+            unsigned int id = command->textures[i];
+            if (id == 0) continue;
+            if (id == state.textures[i]) {
+                stats->skipped++;
+                continue;
+            }
+            bool array = i == 0 && (command->flags & RENDER_TEXTURE_ARRAY);
+            rlActiveTextureSlot(i);
+            glBindTexture(array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, id);
+            state.textures[i] = id;
+            state.texture_array = state.texture_array || array;
+            stats->texture_binds++;
+        }
+
+        Color c = command->color;
+        if (!state.has_color || memcmp(&c, &state.color, sizeof(c)) != 0) {
+            if (locs[SHADER_LOC_COLOR_DIFFUSE] != -1) {
+                float values[4] = {c.r/255.0f, c.g/255.0f, c.b/255.0f, c.a/255.0f};
+                rlSetUniform(locs[SHADER_LOC_COLOR_DIFFUSE], values, SHADER_UNIFORM_VEC4, 1);
+                stats->uniform_sets++;
+            }
+            state.color = c;
+            state.has_color = true;
+        } else {
+            stats->skipped++;
+        }
+
+        if (!state.has_transform || memcmp(&command->transform, &state.transform, sizeof(Matrix)) != 0) {
+            // the same model matrix for all three, like DrawMesh
+            Matrix model = MatrixMultiply(command->transform, world);
+            if (locs[SHADER_LOC_MATRIX_MODEL] != -1) {
+                rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_MODEL], model);
+                stats->uniform_sets++;
+            }
+            if (locs[SHADER_LOC_MATRIX_NORMAL] != -1) {
+                rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_NORMAL], MatrixTranspose(MatrixInvert(model)));
+                stats->uniform_sets++;
+            }
+            rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_MVP], MatrixMultiply(MatrixMultiply(model, view), projection));
+            stats->uniform_sets++;
+            state.transform = command->transform;
+            state.has_transform = true;
+        } else {
+            stats->skipped++;
+        }
+
+        for (int u = 0; u < command->uniform_count; u++) {
+            set_uniform(&state, &queue->uniforms[command->uniform_first + u], stats);
+        }
+
+        // a disabled attribute reads the current value, which isn't vao state
+        if (command->flags & RENDER_ZERO_TEXCOORDS) {
+            float zero[2] = {0};
+            rlSetVertexAttributeDefault(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, zero, SHADER_ATTRIB_VEC2, 2);
+        }
+
+        if (!state.vao_bound || command->vao != state.vao) {
+            rlEnableVertexArray(command->vao);
+            state.vao = command->vao;
+            state.vao_bound = true;
+            stats->vao_binds++;
+        } else {
+            stats->skipped++;
+        }
+
+        // rlgl only draws 16 bit indices from the start, so these go to gl
+        int instances = command->instances;
+        unsigned int mode = command->flags & RENDER_LINES ? GL_LINES : GL_TRIANGLES;
+        if (command->flags & (RENDER_INDEX_16 | RENDER_INDEX_32)) {
+            bool wide = command->flags & RENDER_INDEX_32;
+            unsigned int type = wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+            void *offset = (void *)(command->first*(wide ? sizeof(unsigned int) : sizeof(unsigned short)));
+            if (instances) glDrawElementsInstanced(mode, command->count, type, offset, instances);
+            else glDrawElements(mode, command->count, type, offset);
+        } else if (instances) {
+            glDrawArraysInstanced(mode, command->first, command->count, instances);
+        } else {
+            glDrawArrays(mode, command->first, command->count);
+        }
+    }
+
+    if (state.vao_bound) rlDisableVertexArray();
+    for (int i = RENDER_TEXTURE_SLOTS - 1; i >= 0; i--) {
+        if (state.textures[i] == 0) continue;
+        rlActiveTextureSlot(i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (i == 0 && state.texture_array) glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+    rlActiveTextureSlot(0);
+    if (state.shader) rlDisableShader();
+
+    queue->count = 0;
+    queue->uniform_count = 0;
+}
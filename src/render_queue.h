@@ -0,0 +1,89 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <raylib.h>
+#include <stdint.h>
+
+// draws are submitted as commands, radix sorted by a 64 bit key (shader,
+// textures, vertex array, then depth front to back) and replayed in
+// that order. a shader, texture, vertex array or uniform that is already
+// current isn't bound or set again. only the keys and command indices move
+// in the sort. gl ids are folded into the key, two ids sharing key bits
+// only cost a bind, the replay compares the real ids
+//
+// every 3d draw of both demos goes through here. 2d (text, the hud, the post
+// process quad) stays on rlgl's batch, which keeps its own state
+
+#define RENDER_TEXTURE_SLOTS 3
+#define RENDER_UNIFORM_CACHE 32 // uniform locations below this skip unchanged values
+
+enum RenderFlags {
+    RENDER_INDEX_16 = 1, // first and count are indices in the vao's element buffer
+    RENDER_INDEX_32 = 2,
+    RENDER_TEXTURE_ARRAY = 4, // slot 0 is a 2d array texture
+    RENDER_ZERO_TEXCOORDS = 8, // no texcoord buffer, the attribute reads 0
+    RENDER_LINES = 16, // pairs of vertices as lines instead of triangles
+};
+
+// one per draw uniform, SHADER_UNIFORM_FLOAT to SHADER_UNIFORM_IVEC4
+typedef struct RenderUniform {
+    int loc;
+    int type;
+    union {
+        float f[4];
+        int i[4];
+    } value;
+} RenderUniform;
+
+typedef struct RenderCommand {
+    Shader shader;
+    unsigned int textures[RENDER_TEXTURE_SLOTS]; // 0 leaves the slot alone
+    unsigned int vao;
+    int first, count; // indices, or vertices without an index flag
+    int instances; // 0 draws once, more draws the range that many times instanced
+    int flags;
+    Color color; // colDiffuse
+    float depth; // from the eye, sorts draws of the same state
+    Matrix transform;
+    int uniform_first, uniform_count; // in the queue's uniforms
+} RenderCommand;
+
+// last flush. binds and sets are the ones that reached gl, skipped the ones
+// that were already current
+typedef struct RenderStats {
+    int commands;
+    int shader_binds;
+    int texture_binds;
+    int vao_binds;
+    int uniform_sets;
+    int skipped;
+} RenderStats;
+
+typedef struct RenderQueue {
+    RenderCommand *commands;
+    int count, capacity;
+    RenderUniform *uniforms;
+    int uniform_count, uniform_capacity;
+    uint64_t *keys; // sort scratch, twice capacity
+    uint32_t *order; // replay order, twice capacity
+    RenderStats stats;
+} RenderQueue;
+
+void render_queue_init(RenderQueue *queue);
+void render_queue_unload(RenderQueue *queue);
+
+// a draw with identity transform, white, no textures, indexed by the flags.
+// the pointer is good until the next push
+RenderCommand *render_queue_push(RenderQueue *queue, Shader shader, unsigned int vao, int first, int count, int flags, float depth);
+// adds a uniform to the command pushed last, value has the type's size
+void render_queue_uniform(RenderQueue *queue, int loc, int type, const void *value);
+// an uploaded raylib mesh with the material's shader, diffuse texture and color
+RenderCommand *render_queue_mesh(RenderQueue *queue, Mesh mesh, Material material, Matrix transform, float depth);
+
+// fills order with the commands sorted by key
+void render_queue_sort(RenderQueue *queue);
+// sorts and draws every command with the current view and projection (inside
+// BeginMode3D), then empties the queue
+void render_queue_flush(RenderQueue *queue);
+
+#endif
@@ -0,0 +1,139 @@
+#include "block_mesh.h"
+
+#include <raylib.h>
+#include <string.h>
+
+static int padded_index(int x, int y, int z) {
+  return ((y + 1) * BLOCK_MESH_PAD + (z + 1)) * BLOCK_MESH_PAD + (x + 1);
+}
+
+//---Snapshot---
+
+void block_mesh_snapshot(const VoxelWorld *world, const VoxelChunk *chunk, Voxel *padded) {
+  memset(padded, 0, BLOCK_MESH_PAD * BLOCK_MESH_PAD * BLOCK_MESH_PAD * sizeof(Voxel));
+  uint16_t indices[VOXEL_CHUNK_VOLUME];
+  Voxel voxels[VOXEL_CHUNK_VOLUME];
+  int solid = voxel_chunk_solid(chunk, indices, voxels);
+  for (int k = 0; k < solid; k++) {
+    int v = indices[k];
+    int x = v & (VOXEL_CHUNK - 1), z = (v >> VOXEL_CHUNK_BITS) & (VOXEL_CHUNK - 1), y = v >> (2 * VOXEL_CHUNK_BITS);
+    padded[padded_index(x, y, z)] = voxels[k];
+  }
+
+  // one layer from each face neighbour, edges and corners never touch a face
+  const int last = VOXEL_CHUNK - 1;
+  for (int axis = 0; axis < 3; axis++) {
+    for (int side = -1; side <= 1; side += 2) {
+      int n[3] = {chunk->x, chunk->y, chunk->z};
+      n[axis] += side;
+      const VoxelChunk *neighbour = voxels_chunk(world, n[0], n[1], n[2]);
+      if (!neighbour || !neighbour->count)
+        continue;
+      int u = (axis + 1) % 3, v = (axis + 2) % 3;
+      for (int b = 0; b < VOXEL_CHUNK; b++) {
+        for (int a = 0; a < VOXEL_CHUNK; a++) {
+          int from[3], to[3];
+          from[axis] = side < 0 ? last : 0;
+          to[axis] = side < 0 ? -1 : VOXEL_CHUNK;
+          from[u] = to[u] = a;
+          from[v] = to[v] = b;
+          padded[padded_index(to[0], to[1], to[2])] = voxel_chunk_get(neighbour, from[0], from[1], from[2]);
+        }
+      }
+    }
+  }
+}
+
+//---Meshing---
+
+static void emit_quad(BlockMeshData *out, const int corner[3], int axis, int sign, int w, int h, int layer) {
+  if (out->quad_count == out->capacity) {
+    out->capacity = out->capacity ? out->capacity * 2 : 256;
+    out->vertices = RL_REALLOC(out->vertices, out->capacity * 4 * sizeof(BlockVertex));
+  }
+  int u = (axis + 1) % 3, v = (axis + 2) % 3;
+  int corners[4][3];
+  for (int k = 0; k < 4; k++) {
+    memcpy(corners[k], corner, sizeof(corners[k]));
+    corners[k][u] += k == 1 || k == 2 ? w : 0;
+    corners[k][v] += k >= 2 ? h : 0;
+  }
+  // e_u x e_v is e_axis, so 0 1 2 3 goes counter clockwise seen from the
+  // positive side. the negative side goes round the other way
+  static const int order[2][4] = {{0, 1, 2, 3}, {0, 3, 2, 1}};
+  uint16_t face = (uint16_t)(2 * axis + (sign < 0) + 8 * layer);
+  BlockVertex *q = &out->vertices[out->quad_count++ * 4];
+  for (int k = 0; k < 4; k++) {
+    const int *p = corners[order[sign < 0][k]];
+    q[k] = (BlockVertex){p[0], p[1], p[2], face};
+  }
+}
+
+int block_mesh_build(const Voxel *padded, int layers, BlockMeshData *out) {
+  out->quad_count = 0;
+  // layer + 1 of each visible face in a slice, 0 for none
+  uint16_t mask[VOXEL_CHUNK * VOXEL_CHUNK];
+  for (int axis = 0; axis < 3; axis++) {
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    int step[3] = {0};
+    step[axis] = 1;
+    int forward = padded_index(step[0], step[1], step[2]) - padded_index(0, 0, 0);
+    for (int sign = -1; sign <= 1; sign += 2) {
+      for (int slice = 0; slice < VOXEL_CHUNK; slice++) {
+        bool any = false;
+        for (int b = 0; b < VOXEL_CHUNK; b++) {
+          for (int a = 0; a < VOXEL_CHUNK; a++) {
+            int p[3];
+            p[axis] = slice;
+            p[u] = a;
+            p[v] = b;
+            int i = padded_index(p[0], p[1], p[2]);
+            Voxel voxel = padded[i];
+            bool visible = voxel != VOXEL_EMPTY && padded[i + sign * forward] == VOXEL_EMPTY;
+            int layer = voxel - 1 < layers ? voxel - 1 : layers - 1;
+            mask[b * VOXEL_CHUNK + a] = visible ? layer + 1 : 0;
+            any |= visible;
+          }
+        }
+        if (!any)
+          continue;
+
+        // widest run along u first, then as many rows of it along v as match
+        for (int b = 0; b < VOXEL_CHUNK; b++) {
+          for (int a = 0; a < VOXEL_CHUNK;) {
+            uint16_t m = mask[b * VOXEL_CHUNK + a];
+            if (!m) {
+              a++;
+              continue;
+            }
+            int w = 1, h = 1;
+            while (a + w < VOXEL_CHUNK && mask[b * VOXEL_CHUNK + a + w] == m)
+              w++;
+            for (; b + h < VOXEL_CHUNK; h++) {
+              int k = 0;
+              while (k < w && mask[(b + h) * VOXEL_CHUNK + a + k] == m)
+                k++;
+              if (k < w)
+                break;
+            }
+            for (int y = 0; y < h; y++)
+              memset(&mask[(b + y) * VOXEL_CHUNK + a], 0, w * sizeof(uint16_t));
+
+            int corner[3];
+            corner[axis] = slice + (sign > 0);
+            corner[u] = a;
+            corner[v] = b;
+            emit_quad(out, corner, axis, sign, w, h, m - 1);
+            a += w;
+          }
+        }
+      }
+    }
+  }
+  return out->quad_count;
+}
+
+void block_mesh_free(BlockMeshData *mesh) {
+  RL_FREE(mesh->vertices);
+  *mesh = (BlockMeshData){0};
+}
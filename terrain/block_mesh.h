@@ -0,0 +1,37 @@
+#ifndef BLOCK_MESH_H
+#define BLOCK_MESH_H
+
+#include <stdint.h>
+
+#include "voxels.h"
+
+// greedy meshing of one voxel chunk. faces between two solid voxels are
+// dropped and the rest are merged into the largest rectangles of the same
+// texture, a slice of the chunk at a time per face direction. it works on a
+// copy of the chunk with a voxel of each neighbour around it, so the mesher
+// can run on another thread while the world is edited
+
+#define BLOCK_MESH_PAD (VOXEL_CHUNK + 2) // snapshot side, the chunk and a border
+#define BLOCK_MESH_MAX_QUADS (VOXEL_CHUNK_VOLUME / 2 * 6) // a checkerboard, every face separate
+
+// 8 bytes, positions in voxels from the chunk's corner (0 to VOXEL_CHUNK)
+typedef struct BlockVertex {
+  uint16_t x, y, z;
+  uint16_t face; // 2 * axis + 1 if facing down the axis, plus 8 * the texture layer
+} BlockVertex;
+
+// quads of 4 vertices, drawn as triangles 0 1 2 and 0 2 3
+typedef struct BlockMeshData {
+  BlockVertex *vertices;
+  int quad_count, capacity; // quads
+} BlockMeshData;
+
+// the chunk's voxels and the ones touching its faces from the neighbouring
+// chunks, x fastest then z then y, BLOCK_MESH_PAD^3 of them
+void block_mesh_snapshot(const VoxelWorld *world, const VoxelChunk *chunk, Voxel *padded);
+// meshes the inside of a snapshot into out, reusing its storage. voxel
+// values past layers use the last layer. returns the quad count
+int block_mesh_build(const Voxel *padded, int layers, BlockMeshData *out);
+void block_mesh_free(BlockMeshData *mesh);
+
+#endif
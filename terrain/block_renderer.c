@@ -0,0 +1,260 @@
+#include "block_renderer.h"
+
+#include <raymath.h>
+#include <rlgl.h>
+#include <string.h>
+
+#include "gl_ext.h"
+
+#define FALLBACK_TEXTURE_SIZE 64 // when the first texture doesn't load
+
+//---Textures---
+
+static unsigned int load_texture_array(const char **paths, int count) {
+  Image first = LoadImage(paths[0]);
+  int w = first.data ? first.width : FALLBACK_TEXTURE_SIZE, h = first.data ? first.height : FALLBACK_TEXTURE_SIZE;
+  UnloadImage(first);
+
+  unsigned int id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, w, h, count, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  for (int i = 0; i < count; i++) {
+    Image image = LoadImage(paths[i]);
+    if (!image.data) {
+      TRACELOG(LOG_WARNING, "BLOCKS: [%s] Failed to load block texture", paths[i]);
+      image = GenImageColor(w, h, MAGENTA);
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    if (image.width != w || image.height != h)
+      ImageResize(&image, w, h);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+    UnloadImage(image);
+  }
+  glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  return id;
+}
+
+//---Worker---
+
+static void *mesh_worker(void *arg) {
+  BlockRenderer *r = arg;
+  pthread_mutex_lock(&r->lock);
+  for (;;) {
+    while (!r->quit && r->queue_count == 0)
+      pthread_cond_wait(&r->wake, &r->lock);
+    if (r->quit)
+      break;
+
+    BlockMeshJob *job = r->queue[--r->queue_count];
+    pthread_mutex_unlock(&r->lock);
+
+    block_mesh_build(job->padded, r->layers, &job->mesh);
+
+    pthread_mutex_lock(&r->lock);
+    if (r->done_count == r->done_capacity) {
+      r->done_capacity = r->done_capacity ? r->done_capacity * 2 : 64;
+      r->done = RL_REALLOC(r->done, r->done_capacity * sizeof(BlockMeshJob *));
+    }
+    r->done[r->done_count++] = job;
+  }
+  pthread_mutex_unlock(&r->lock);
+  return NULL;
+}
+
+// caller holds the lock. the order jobs run in doesn't matter, the
+// generations sort out a chunk queued twice
+static void queue_push(BlockRenderer *r, BlockMeshJob *job) {
+  if (r->queue_count == r->queue_capacity) {
+    r->queue_capacity = r->queue_capacity ? r->queue_capacity * 2 : 64;
+    r->queue = RL_REALLOC(r->queue, r->queue_capacity * sizeof(BlockMeshJob *));
+  }
+  r->queue[r->queue_count++] = job;
+}
+
+static void job_free(BlockMeshJob *job) {
+  block_mesh_free(&job->mesh);
+  RL_FREE(job);
+}
+
+//---Renderer---
+
+void block_renderer_init(BlockRenderer *r, float block_size, const char **texture_paths, int texture_count) {
+  *r = (BlockRenderer){0};
+  r->block_size = block_size;
+  r->shader = LoadShader("terrain/blocks.vert", "terrain/blocks.frag");
+  int unit = 0, tile = 1;
+  SetShaderValue(r->shader, GetShaderLocation(r->shader, "blockTextures"), &unit, SHADER_UNIFORM_INT);
+  SetShaderValue(r->shader, GetShaderLocation(r->shader, "voxelSize"), &block_size, SHADER_UNIFORM_FLOAT);
+  SetShaderValue(r->shader, GetShaderLocation(r->shader, "tile"), &tile, SHADER_UNIFORM_INT);
+  r->loc_origin = GetShaderLocation(r->shader, "chunkOrigin");
+
+  r->texture_array = load_texture_array(texture_paths, texture_count);
+  r->layers = texture_count;
+
+  unsigned short *indices = RL_MALLOC(BLOCK_MESH_MAX_QUADS * 6 * sizeof(unsigned short));
+  for (int q = 0; q < BLOCK_MESH_MAX_QUADS; q++) {
+    static const int corners[6] = {0, 1, 2, 0, 2, 3};
+    for (int k = 0; k < 6; k++)
+      indices[q * 6 + k] = (unsigned short)(q * 4 + corners[k]);
+  }
+  r->quad_ebo = rlLoadVertexBufferElement(indices, BLOCK_MESH_MAX_QUADS * 6 * sizeof(unsigned short), false);
+  RL_FREE(indices);
+
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_cond_init(&r->wake, NULL);
+  r->has_worker = pthread_create(&r->worker, NULL, mesh_worker, r) == 0;
+  if (!r->has_worker)
+    TRACELOG(LOG_WARNING, "BLOCKS: could not start the meshing thread, meshing on the main thread");
+}
+
+static void chunk_mesh_unload(BlockChunkMesh *m) {
+  if (m->vao) {
+    rlUnloadVertexArray(m->vao);
+    rlUnloadVertexBuffer(m->vbo);
+  }
+  m->vao = m->vbo = 0;
+  m->quad_count = 0;
+}
+
+void block_renderer_unload(BlockRenderer *r) {
+  if (r->has_worker) {
+    pthread_mutex_lock(&r->lock);
+    r->quit = true;
+    pthread_cond_broadcast(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->worker, NULL);
+  }
+  for (int i = 0; i < r->queue_count; i++)
+    job_free(r->queue[i]);
+  for (int i = 0; i < r->done_count; i++)
+    job_free(r->done[i]);
+  RL_FREE(r->queue);
+  RL_FREE(r->done);
+  pthread_mutex_destroy(&r->lock);
+  pthread_cond_destroy(&r->wake);
+
+  for (int i = 0; i < r->chunk_count; i++)
+    chunk_mesh_unload(&r->chunks[i]);
+  RL_FREE(r->chunks);
+  rlUnloadVertexBuffer(r->quad_ebo);
+  glDeleteTextures(1, &r->texture_array);
+  UnloadShader(r->shader);
+  *r = (BlockRenderer){0};
+}
+
+// replaces the chunk's gpu mesh, the quad indices are shared
+static void chunk_mesh_upload(BlockRenderer *r, BlockChunkMesh *m, const BlockMeshData *mesh) {
+  chunk_mesh_unload(m);
+  m->quad_count = mesh->quad_count;
+  if (!mesh->quad_count)
+    return;
+  m->vao = rlLoadVertexArray();
+  rlEnableVertexArray(m->vao);
+  m->vbo = rlLoadVertexBuffer(mesh->vertices, mesh->quad_count * 4 * sizeof(BlockVertex), false);
+  // integers as floats, exact at 16 bits
+  rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, 4, RL_UNSIGNED_SHORT, false, 0, 0);
+  rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION);
+  rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD);
+  rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL);
+  rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR);
+  rlEnableVertexBufferElement(r->quad_ebo);
+  rlDisableVertexArray();
+}
+
+static void request_mesh(BlockRenderer *r, const VoxelWorld *world, int index) {
+  BlockMeshJob *job = RL_MALLOC(sizeof(BlockMeshJob));
+  job->chunk = index;
+  job->generation = ++r->chunks[index].generation;
+  job->mesh = (BlockMeshData){0};
+  // the copy is what makes the worker safe from later edits
+  block_mesh_snapshot(world, world->chunks[index], job->padded);
+  r->queued++;
+  if (!r->has_worker) {
+    block_mesh_build(job->padded, r->layers, &job->mesh);
+    chunk_mesh_upload(r, &r->chunks[index], &job->mesh);
+    r->uploaded++;
+    job_free(job);
+    return;
+  }
+  pthread_mutex_lock(&r->lock);
+  queue_push(r, job);
+  pthread_cond_signal(&r->wake);
+  pthread_mutex_unlock(&r->lock);
+}
+
+void block_renderer_update(BlockRenderer *r, const VoxelWorld *world) {
+  r->queued = r->uploaded = 0;
+  if (world->count > r->chunk_capacity) {
+    int capacity = world->capacity;
+    r->chunks = RL_REALLOC(r->chunks, capacity * sizeof(BlockChunkMesh));
+    memset(&r->chunks[r->chunk_capacity], 0, (capacity - r->chunk_capacity) * sizeof(BlockChunkMesh));
+    r->chunk_capacity = capacity;
+  }
+  int known = r->chunk_count;
+  r->chunk_count = world->count;
+  for (int i = known; i < world->count; i++)
+    request_mesh(r, world, i);
+  for (int d = 0; d < world->dirty_count; d++) {
+    if (world->dirty[d]->index < known)
+      request_mesh(r, world, world->dirty[d]->index);
+  }
+
+  if (!r->has_worker)
+    return;
+  pthread_mutex_lock(&r->lock);
+  BlockMeshJob **done = r->done;
+  int done_count = r->done_count;
+  r->done = NULL;
+  r->done_count = r->done_capacity = 0;
+  r->pending = r->queue_count;
+  pthread_mutex_unlock(&r->lock);
+
+  for (int i = 0; i < done_count; i++) {
+    BlockMeshJob *job = done[i];
+    BlockChunkMesh *m = &r->chunks[job->chunk];
+    if (job->generation == m->generation) {
+      chunk_mesh_upload(r, m, &job->mesh);
+      r->uploaded++;
+    }
+    job_free(job);
+  }
+  RL_FREE(done);
+}
+
+//---Drawing---
+
+void block_renderer_draw(BlockRenderer *r, RenderQueue *queue, const VoxelWorld *world, const Frustum *frustum,
+                         Vector3 eye) {
+  r->draw_calls = r->triangles = 0;
+  float chunk_size = VOXEL_CHUNK * r->block_size;
+  for (int i = 0; i < r->chunk_count; i++) {
+    const BlockChunkMesh *m = &r->chunks[i];
+    if (!m->quad_count)
+      continue;
+    const VoxelChunk *c = world->chunks[i];
+    Vector3 origin = {c->x * chunk_size, c->y * chunk_size, c->z * chunk_size};
+    BoundingBox bounds = {origin, {origin.x + chunk_size, origin.y + chunk_size, origin.z + chunk_size}};
+    if (frustum_test_box(frustum, bounds) == FRUSTUM_OUTSIDE)
+      continue;
+    float depth = Vector3Distance(Vector3Add(origin, (Vector3){chunk_size / 2, chunk_size / 2, chunk_size / 2}), eye);
+    RenderCommand *command =
+        render_queue_push(queue, r->shader, m->vao, 0, m->quad_count * 6, RENDER_INDEX_16 | RENDER_TEXTURE_ARRAY, depth);
+    command->textures[0] = r->texture_array;
+    render_queue_uniform(queue, r->loc_origin, SHADER_UNIFORM_VEC3, &origin);
+    r->draw_calls++;
+    r->triangles += m->quad_count * 2;
+  }
+}
+
+size_t block_renderer_bytes(const BlockRenderer *r) {
+  size_t bytes = (size_t)r->chunk_capacity * sizeof(BlockChunkMesh);
+  for (int i = 0; i < r->chunk_count; i++)
+    bytes += (size_t)r->chunks[i].quad_count * 4 * sizeof(BlockVertex);
+  return bytes + BLOCK_MESH_MAX_QUADS * 6 * sizeof(unsigned short);
+}
@@ -0,0 +1,70 @@
+#ifndef BLOCK_RENDERER_H
+#define BLOCK_RENDERER_H
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stddef.h>
+
+#include "block_mesh.h"
+#include "frustum.h"
+#include "render_queue.h"
+#include "voxels.h"
+
+// the blocks as one greedy mesh per voxel chunk (block_mesh.h), every block
+// texture a layer of one texture array so a chunk is one draw call. chunks an
+// edit dirtied are copied and remeshed on a worker thread, the old mesh stays
+// drawn until the new one is uploaded, so an edit never stalls the frame
+
+typedef struct BlockChunkMesh {
+  unsigned int vao, vbo;
+  int quad_count;
+  int generation; // bumped per remesh request, older results are dropped
+} BlockChunkMesh;
+
+// a snapshot on its way through the worker
+typedef struct BlockMeshJob {
+  int chunk; // index in VoxelWorld.chunks
+  int generation;
+  Voxel padded[BLOCK_MESH_PAD * BLOCK_MESH_PAD * BLOCK_MESH_PAD];
+  BlockMeshData mesh;
+} BlockMeshJob;
+
+typedef struct BlockRenderer {
+  Shader shader; // blocks.vert and blocks.frag
+  int loc_origin;
+  float block_size;
+  unsigned int texture_array;
+  int layers;
+  unsigned int quad_ebo; // 0 1 2 0 2 3 for every quad of a chunk, shared
+  // parallel to VoxelWorld.chunks, chunk bounds come from there
+  BlockChunkMesh *chunks;
+  int chunk_count, chunk_capacity;
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_t worker;
+  bool has_worker, quit;
+  BlockMeshJob **queue, **done; // under the lock
+  int queue_count, done_count, queue_capacity, done_capacity;
+
+  // last frame
+  int draw_calls;
+  int triangles;
+  int queued;   // chunks sent to the worker
+  int uploaded; // meshes
+  int pending;  // at the worker
+} BlockRenderer;
+
+// the textures become the array's layers, resized to the first one's size
+void block_renderer_init(BlockRenderer *r, float block_size, const char **texture_paths, int texture_count);
+void block_renderer_unload(BlockRenderer *r);
+// queues the chunks on the world's dirty list and chunks new since the last
+// call, and uploads whatever the worker finished. call before
+// voxels_clear_dirty
+void block_renderer_update(BlockRenderer *r, const VoxelWorld *world);
+// queues a draw per chunk in view, eye orders them front to back
+void block_renderer_draw(BlockRenderer *r, RenderQueue *queue, const VoxelWorld *world, const Frustum *frustum,
+                         Vector3 eye);
+size_t block_renderer_bytes(const BlockRenderer *r);
+
+#endif
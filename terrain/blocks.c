@@ -0,0 +1,166 @@
+#include "blocks.h"
+
+#include <math.h>
+#include <raymath.h>
+#include <rcamera.h>
+
+//---Queries---
+
+bool blocks_collide(const VoxelWorld *world, const Camera *camera, float height, float vel_y, float dt,
+                    Vector3 *dr) {
+  bool floor = false, blocked = false;
+  Camera cam = *camera; // the rcamera getters take a non const pointer
+  Vector3 position = cam.position;
+  Vector3 feet_pos = Vector3Add(Vector3Subtract(position, (Vector3){0, height, 0}), (Vector3){0, vel_y * dt, 0});
+  Vector3 head_pos = Vector3Add(position, (Vector3){0, height / 2, 0});
+  Vector3 move_vec =
+      Vector3Add(Vector3Scale(GetCameraForward(&cam), dr->x), Vector3Scale(GetCameraRight(&cam), dr->y));
+  Vector3 player_point = Vector3Subtract(position, (Vector3){0, height / 2, 0});
+  Vector3 step_point = Vector3Add(player_point, move_vec);
+
+  // the voxels under every sphere tested below, a little wider since a sphere
+  // just touching a block counts
+  float r = height / 2, pad = 0.01f;
+  Vector3 body = {r + pad, r + pad, r + pad}, tip = {0.1f + pad, 0.1f + pad, 0.1f + pad};
+  int min[3], max[3];
+  voxels_cell(world,
+              Vector3Min(Vector3Subtract(Vector3Min(feet_pos, head_pos), tip),
+                         Vector3Subtract(Vector3Min(player_point, step_point), body)),
+              min);
+  voxels_cell(world,
+              Vector3Max(Vector3Add(Vector3Max(feet_pos, head_pos), tip),
+                         Vector3Add(Vector3Max(player_point, step_point), body)),
+              max);
+
+  // no early out so the result doesn't depend on the order
+  for (int y = min[1]; y <= max[1]; y++) {
+    for (int z = min[2]; z <= max[2]; z++) {
+      for (int x = min[0]; x <= max[0]; x++) {
+        if (voxels_get(world, x, y, z) == VOXEL_EMPTY)
+          continue;
+        BoundingBox bounds = voxels_bounds(world, x, y, z);
+        // Top collision
+        if (CheckCollisionBoxSphere(bounds, feet_pos, 0.1) || CheckCollisionBoxSphere(bounds, head_pos, 0.1))
+          floor = true;
+        // Collision on this frame
+        if (!CheckCollisionBoxSphere(bounds, player_point, r) && CheckCollisionBoxSphere(bounds, step_point, r))
+          blocked = true;
+      }
+    }
+  }
+  if (blocked)
+    *dr = Vector3Zero();
+  return floor;
+}
+
+bool blocks_raycast(const VoxelWorld *world, Ray ray, float max_distance, RayCollision *hit, int voxel[3]) {
+  *hit = (RayCollision){0};
+  float length = Vector3Length(ray.direction), size = world->voxel_size;
+  if (!world->blocks || !(length > 0))
+    return false;
+  Vector3 dir = Vector3Scale(ray.direction, 1 / length);
+
+  // only the part of the ray over chunks that exist, axis is the face the
+  // ray came in through (-1 while it starts inside)
+  float o[3] = {ray.position.x, ray.position.y, ray.position.z}, d[3] = {dir.x, dir.y, dir.z};
+  float t0 = 0, t1 = max_distance, chunk_size = VOXEL_CHUNK * size;
+  int axis = -1;
+  for (int a = 0; a < 3; a++) {
+    float lo = world->min[a] * chunk_size, hi = (world->max[a] + 1) * chunk_size;
+    if (d[a] == 0) {
+      if (o[a] < lo || o[a] > hi)
+        return false;
+      continue;
+    }
+    float ta = fminf((lo - o[a]) / d[a], (hi - o[a]) / d[a]), tb = fmaxf((lo - o[a]) / d[a], (hi - o[a]) / d[a]);
+    if (ta > t0) {
+      t0 = ta;
+      axis = a;
+    }
+    t1 = fminf(t1, tb);
+  }
+  if (!(t0 <= t1))
+    return false;
+
+  int cell[3], step[3];
+  float next[3], delta[3];
+  for (int a = 0; a < 3; a++) {
+    float lo = world->min[a] * VOXEL_CHUNK, hi = (world->max[a] + 1) * VOXEL_CHUNK - 1;
+    cell[a] = (int)Clamp(floorf((o[a] + d[a] * t0) / size), lo, hi);
+    step[a] = d[a] > 0 ? 1 : -1;
+    next[a] = d[a] != 0 ? ((cell[a] + (d[a] > 0)) * size - o[a]) / d[a] : INFINITY;
+    delta[a] = d[a] != 0 ? size / fabsf(d[a]) : INFINITY;
+  }
+
+  // the chunk is looked up once per chunk the ray passes, not per voxel
+  const VoxelChunk *c = NULL;
+  int k[3] = {0};
+  float t = t0;
+  for (;;) {
+    int kx = cell[0] >> VOXEL_CHUNK_BITS, ky = cell[1] >> VOXEL_CHUNK_BITS, kz = cell[2] >> VOXEL_CHUNK_BITS;
+    if (!c || kx != k[0] || ky != k[1] || kz != k[2]) {
+      c = voxels_chunk(world, kx, ky, kz);
+      k[0] = kx, k[1] = ky, k[2] = kz;
+    }
+    if (c && c->count &&
+        voxel_chunk_get(c, cell[0] & (VOXEL_CHUNK - 1), cell[1] & (VOXEL_CHUNK - 1), cell[2] & (VOXEL_CHUNK - 1))) {
+      if (axis == -1) {
+        // inside a block, it faces back along the ray
+        axis = fabsf(d[0]) > fabsf(d[1]) ? (fabsf(d[0]) > fabsf(d[2]) ? 0 : 2) : (fabsf(d[1]) > fabsf(d[2]) ? 1 : 2);
+      }
+      float normal[3] = {0};
+      normal[axis] = -step[axis];
+      hit->hit = true;
+      hit->distance = t;
+      hit->point = Vector3Add(ray.position, Vector3Scale(dir, t));
+      hit->normal = (Vector3){normal[0], normal[1], normal[2]};
+      voxel[0] = cell[0], voxel[1] = cell[1], voxel[2] = cell[2];
+      return true;
+    }
+
+    axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+    t = next[axis];
+    if (t > t1)
+      return false;
+    cell[axis] += step[axis];
+    next[axis] += delta[axis];
+  }
+}
+
+//---Culling---
+
+int blocks_cull(const VoxelWorld *world, const Frustum *frustum, Block *visible, int capacity, CullStats *stats) {
+  int n = 0;
+  float s = world->voxel_size;
+  *stats = (CullStats){0};
+  for (int i = 0; i < world->count; i++) {
+    const VoxelChunk *c = world->chunks[i];
+    if (!c->count)
+      continue;
+    int x0 = c->x * VOXEL_CHUNK, y0 = c->y * VOXEL_CHUNK, z0 = c->z * VOXEL_CHUNK;
+    BoundingBox bounds = {{x0 * s, y0 * s, z0 * s},
+                          {(x0 + VOXEL_CHUNK) * s, (y0 + VOXEL_CHUNK) * s, (z0 + VOXEL_CHUNK) * s}};
+    FrustumResult chunk = frustum_test_box(frustum, bounds);
+    if (chunk == FRUSTUM_OUTSIDE) {
+      stats->culled += c->count;
+      continue;
+    }
+
+    uint16_t indices[VOXEL_CHUNK_VOLUME];
+    Voxel voxels[VOXEL_CHUNK_VOLUME];
+    int solid = voxel_chunk_solid(c, indices, voxels);
+    for (int k = 0; k < solid; k++) {
+      int v = indices[k];
+      int x = v & (VOXEL_CHUNK - 1), z = (v >> VOXEL_CHUNK_BITS) & (VOXEL_CHUNK - 1), y = v >> (2 * VOXEL_CHUNK_BITS);
+      BoundingBox box = voxels_bounds(world, x0 + x, y0 + y, z0 + z);
+      if (chunk == FRUSTUM_INTERSECT && frustum_test_box(frustum, box) == FRUSTUM_OUTSIDE) {
+        stats->culled++;
+        continue;
+      }
+      stats->visible++;
+      if (n < capacity)
+        visible[n++] = (Block){Vector3Scale(Vector3Add(box.min, box.max), 0.5f), voxels[k] - 1};
+    }
+  }
+  return n;
+}
@@ -0,0 +1,31 @@
+#version 330
+
+in vec2 texCoord;
+in vec3 fragNormal;
+flat in float layer;
+
+out vec4 finalColor;
+
+uniform sampler2DArray blockTextures; // a layer per block texture
+uniform int tile;
+
+const float ambientValue = 0.8;
+const vec3 diffuseCol = vec3(0.4, 0.4, 0.4);
+
+// base.frag with the texture from the array
+void main() {
+    const vec3 lightDir = normalize(-vec3(-0.2, -0.2, -0.0));
+    // no fract, GL_REPEAT wraps. wrapping by hand would jump from 1 to 0 at
+    // every block edge inside a merged quad and pick the smallest mip there
+    vec3 texColor = texture(blockTextures, vec3(texCoord * tile, layer)).rgb; // tile
+
+    // diffuse
+    vec3 norm = normalize(fragNormal);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diffuseCol * diff * texColor;
+
+    vec3 ambient = ambientValue * texColor;
+    vec3 result = ambient + diffuse;
+
+    finalColor = vec4(result, 1.0);
+}
@@ -0,0 +1,35 @@
+#ifndef BLOCKS_H
+#define BLOCKS_H
+
+#include <raylib.h>
+
+#include "frustum.h"
+#include "voxels.h"
+
+// player placed cubes, one per voxel of a VoxelWorld. the voxel grid is the
+// spatial index as well: queries only look at the voxels around them and
+// cost the same however many blocks there are
+
+// a block to draw
+typedef struct Block {
+  Vector3 pos; // centre
+  int texture_id;
+} Block;
+
+// collide a player (camera at the eyes, `height` tall, falling at vel_y)
+// against the blocks in the voxels around it. dr is the camera space move
+// passed to UpdateCameraPro and gets zeroed if it would walk into a block.
+// returns true if a block is under the feet or inside the body
+bool blocks_collide(const VoxelWorld *world, const Camera *camera, float height, float vel_y, float dt,
+                    Vector3 *dr);
+// nearest block within max_distance hit by the ray, false if none. walks the
+// voxels along the ray (a dda) up to the first solid one, voxel gets its
+// coordinates. a ray starting inside a block hits it at distance 0
+bool blocks_raycast(const VoxelWorld *world, Ray ray, float max_distance, RayCollision *hit, int voxel[3]);
+
+// the blocks in the frustum, at most capacity of them written to visible.
+// chunks fully inside or outside skip the per block tests. returns how many
+// were written
+int blocks_cull(const VoxelWorld *world, const Frustum *frustum, Block *visible, int capacity, CullStats *stats);
+
+#endif
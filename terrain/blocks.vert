@@ -0,0 +1,31 @@
+#version 330
+
+// BlockVertex meshes (see block_mesh.h), one per voxel chunk. x, y, z are in
+// voxels from the chunk's corner and w is the face direction plus 8 times the
+// texture layer, all arriving as plain integers
+in vec4 vertexPosition;
+
+uniform mat4 mvp;
+uniform mat4 matNormal;
+
+uniform vec3 chunkOrigin; // world position of the chunk's corner
+uniform float voxelSize;
+
+out vec2 texCoord;
+out vec3 fragNormal;
+flat out float layer;
+
+const vec3 faceNormals[6] = vec3[](vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0),
+                                   vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0));
+
+void main()
+{
+    int face = int(vertexPosition.w) % 8;
+    vec3 pos = vertexPosition.xyz;
+    // in voxels across the face, so a merged quad repeats the texture once
+    // per block like a single cube
+    texCoord = face < 2 ? pos.zy : face < 4 ? pos.xz : pos.xy;
+    layer = floor(vertexPosition.w/8.0);
+    fragNormal = vec3(matNormal) * faceNormals[face];
+    gl_Position = mvp * vec4(chunkOrigin + pos*voxelSize, 1.0);
+}
@@ -0,0 +1,296 @@
+#include "cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TILE_MAGIC 0x454c4954 // "TILE"
+#define TEXTURE_MAGIC 0x43584554 // "TEXC"
+#define CACHE_VERSION 2
+#define CACHE_PATH_MAX 512
+
+enum {
+  TILE_VERTICES = 1 << 0,
+  TILE_NORMALS = 1 << 1,
+  TILE_TEXCOORDS = 1 << 2,
+};
+
+// 64 bytes aligned so the float arrays after it stay aligned in the mapping
+typedef struct TileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint8_t key[CACHE_KEY_MAX];
+  uint32_t key_size;
+  int32_t cx, cz;
+  int32_t width, length;
+  float spacing, max_height;
+  int32_t vertex_count;
+  uint32_t flags;
+  uint64_t payload_size;
+  uint64_t checksum;
+} __attribute__((aligned(64))) TileHeader;
+
+typedef struct TextureHeader {
+  uint32_t magic;
+  uint32_t version;
+  int64_t source_mtime;
+  int64_t source_size;
+  int32_t width, height, mipmaps, format;
+  uint64_t payload_size;
+  uint64_t checksum;
+} __attribute__((aligned(64))) TextureHeader;
+
+// fnv-1a over 8 byte words, only guards against truncated or damaged files
+static uint64_t checksum(const void *data, size_t size) {
+  const uint8_t *p = data;
+  uint64_t h = 0xcbf29ce484222325ull;
+  size_t words = size / 8;
+  for (size_t i = 0; i < words; i++) {
+    uint64_t w;
+    memcpy(&w, p + i * 8, 8);
+    h = (h ^ w) * 0x100000001b3ull;
+  }
+  for (size_t i = words * 8; i < size; i++)
+    h = (h ^ p[i]) * 0x100000001b3ull;
+  return h;
+}
+
+bool cache_init(const char *dir) {
+  if (mkdir(dir, 0755) != 0) {
+    struct stat st;
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+      TRACELOG(LOG_WARNING, "CACHE: can't use %s, caching disabled", dir);
+      return false;
+    }
+  }
+  return true;
+}
+
+// map a whole file read only, NULL on failure
+static void *map_file(const char *path, size_t *size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  void *map = NULL;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+      map = NULL;
+    else
+      *size = st.st_size;
+  }
+  close(fd);
+  return map;
+}
+
+// write to a temp file and rename so readers never see a partial file
+static bool write_file(const char *path, const void *header, size_t header_size,
+                       const void **parts, const size_t *sizes, int count) {
+  char tmp[CACHE_PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+  FILE *f = fopen(tmp, "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(header, header_size, 1, f) == 1;
+  for (int i = 0; i < count && ok; i++)
+    ok = sizes[i] == 0 || fwrite(parts[i], sizes[i], 1, f) == 1;
+  ok = fclose(f) == 0 && ok;
+  if (ok)
+    ok = rename(tmp, path) == 0;
+  if (!ok)
+    remove(tmp);
+  return ok;
+}
+
+//---Tiles---
+
+static void tile_path(char *out, const char *dir, const void *key, size_t key_size, int cx, int cz) {
+  snprintf(out, CACHE_PATH_MAX, "%s/tile_%016llx_%d_%d.bin", dir,
+           (unsigned long long)checksum(key, key_size), cx, cz);
+}
+
+// sizes of the mesh arrays in file order
+static int tile_parts(const TerrainMesh *mesh, uint32_t flags, const void **parts, size_t *sizes) {
+  int n = 0;
+  if (flags & TILE_VERTICES) { parts[n] = mesh->vertices; sizes[n++] = (size_t)mesh->vertex_count * 3 * sizeof(float); }
+  if (flags & TILE_NORMALS) { parts[n] = mesh->normals; sizes[n++] = (size_t)mesh->vertex_count * 3 * sizeof(float); }
+  if (flags & TILE_TEXCOORDS) { parts[n] = mesh->texcoords; sizes[n++] = (size_t)mesh->vertex_count * 2 * sizeof(float); }
+  return n;
+}
+
+bool cache_store_tile(const char *dir, const void *key, size_t key_size, int cx, int cz,
+                      const Heightfield *hf, const TerrainMesh *mesh) {
+  if (!dir || key_size > CACHE_KEY_MAX)
+    return false;
+
+  uint32_t flags = (mesh->vertices ? TILE_VERTICES : 0) | (mesh->normals ? TILE_NORMALS : 0) |
+                   (mesh->texcoords ? TILE_TEXCOORDS : 0);
+  const void *parts[4] = {hf->heights};
+  size_t sizes[4] = {(size_t)hf->width * hf->length * sizeof(float)};
+  int count = 1 + tile_parts(mesh, flags, parts + 1, sizes + 1);
+
+  TileHeader header = {
+      .magic = TILE_MAGIC,
+      .version = CACHE_VERSION,
+      .key_size = key_size,
+      .cx = cx,
+      .cz = cz,
+      .width = hf->width,
+      .length = hf->length,
+      .spacing = hf->spacing,
+      .max_height = hf->max_height,
+      .vertex_count = mesh->vertex_count,
+      .flags = flags,
+  };
+  memcpy(header.key, key, key_size);
+
+  // checksum runs over the payload as if it were one buffer
+  uint64_t h = 0;
+  for (int i = 0; i < count; i++) {
+    h = h * 31 + checksum(parts[i], sizes[i]);
+    header.payload_size += sizes[i];
+  }
+  header.checksum = h;
+
+  char path[CACHE_PATH_MAX];
+  tile_path(path, dir, key, key_size, cx, cz);
+  return write_file(path, &header, sizeof(header), parts, sizes, count);
+}
+
+bool cache_load_tile(const char *dir, const void *key, size_t key_size, int cx, int cz, CacheTile *tile) {
+  if (!dir || key_size > CACHE_KEY_MAX)
+    return false;
+
+  char path[CACHE_PATH_MAX];
+  tile_path(path, dir, key, key_size, cx, cz);
+  size_t size = 0;
+  uint8_t *map = map_file(path, &size);
+  if (!map)
+    return false;
+
+  const TileHeader *header = (const TileHeader *)map;
+  bool ok = size >= sizeof(TileHeader) && header->magic == TILE_MAGIC && header->version == CACHE_VERSION &&
+            header->key_size == key_size && memcmp(header->key, key, key_size) == 0 &&
+            header->cx == cx && header->cz == cz && header->payload_size == size - sizeof(TileHeader);
+
+  memset(tile, 0, sizeof(*tile));
+  tile->mesh.vertex_count = ok ? header->vertex_count : 0;
+
+  const void *parts[4];
+  size_t sizes[4];
+  int count = 0;
+  if (ok) {
+    // tile_parts only reads the counts, pointers are filled in below
+    sizes[0] = (size_t)header->width * header->length * sizeof(float);
+    count = 1 + tile_parts(&tile->mesh, header->flags, parts + 1, sizes + 1);
+    size_t total = 0;
+    for (int i = 0; i < count; i++)
+      total += sizes[i];
+    ok = total == header->payload_size;
+  }
+
+  uint64_t h = 0;
+  uint8_t *p = map + sizeof(TileHeader);
+  for (int i = 0; ok && i < count; i++) {
+    parts[i] = p;
+    h = h * 31 + checksum(p, sizes[i]);
+    p += sizes[i];
+  }
+  if (!ok || h != header->checksum) {
+    TRACELOG(LOG_WARNING, "CACHE: stale or corrupt tile %s, regenerating", path);
+    munmap(map, size);
+    return false;
+  }
+
+  tile->map = map;
+  tile->map_size = size;
+  tile->heights = parts[0];
+  tile->width = header->width;
+  tile->length = header->length;
+  tile->spacing = header->spacing;
+  tile->max_height = header->max_height;
+  int n = 1;
+  if (header->flags & TILE_VERTICES) tile->mesh.vertices = (float *)parts[n++];
+  if (header->flags & TILE_NORMALS) tile->mesh.normals = (float *)parts[n++];
+  if (header->flags & TILE_TEXCOORDS) tile->mesh.texcoords = (float *)parts[n++];
+  return true;
+}
+
+void cache_release_tile(CacheTile *tile) {
+  if (tile->map)
+    munmap(tile->map, tile->map_size);
+  memset(tile, 0, sizeof(*tile));
+}
+
+//---Textures---
+
+static size_t mipmap_chain_size(int width, int height, int mipmaps, int format) {
+  size_t size = 0;
+  for (int i = 0; i < mipmaps; i++) {
+    size += GetPixelDataSize(width, height, format);
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+  return size;
+}
+
+Texture cache_load_texture_mipmapped(const char *dir, const char *path) {
+  struct stat st;
+  bool use_cache = dir && stat(path, &st) == 0;
+  char cache_path[CACHE_PATH_MAX];
+
+  if (use_cache) {
+    snprintf(cache_path, sizeof(cache_path), "%s/tex_%016llx.bin", dir,
+             (unsigned long long)checksum(path, strlen(path)));
+    size_t size = 0;
+    uint8_t *map = map_file(cache_path, &size);
+    if (map) {
+      const TextureHeader *header = (const TextureHeader *)map;
+      bool ok = size >= sizeof(TextureHeader) && header->magic == TEXTURE_MAGIC &&
+                header->version == CACHE_VERSION && header->source_mtime == st.st_mtime &&
+                header->source_size == st.st_size && header->payload_size == size - sizeof(TextureHeader) &&
+                checksum(map + sizeof(TextureHeader), header->payload_size) == header->checksum;
+      if (ok) {
+        Image image = {
+            .data = map + sizeof(TextureHeader),
+            .width = header->width,
+            .height = header->height,
+            .mipmaps = header->mipmaps,
+            .format = header->format,
+        };
+        Texture texture = LoadTextureFromImage(image);
+        munmap(map, size);
+        return texture;
+      }
+      TRACELOG(LOG_WARNING, "CACHE: stale texture cache for %s, rebuilding", path);
+      munmap(map, size);
+    }
+  }
+
+  Image image = LoadImage(path);
+  ImageMipmaps(&image);
+  if (use_cache && image.data) {
+    TextureHeader header = {
+        .magic = TEXTURE_MAGIC,
+        .version = CACHE_VERSION,
+        .source_mtime = st.st_mtime,
+        .source_size = st.st_size,
+        .width = image.width,
+        .height = image.height,
+        .mipmaps = image.mipmaps,
+        .format = image.format,
+        .payload_size = mipmap_chain_size(image.width, image.height, image.mipmaps, image.format),
+    };
+    header.checksum = checksum(image.data, header.payload_size);
+    const void *parts[1] = {image.data};
+    size_t sizes[1] = {header.payload_size};
+    write_file(cache_path, &header, sizeof(header), parts, sizes, 1);
+  }
+  Texture texture = LoadTextureFromImage(image);
+  UnloadImage(image);
+  return texture;
+}
@@ -0,0 +1,42 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "heightfield.h"
+#include "terrain_mesh.h"
+
+// on-disk cache of generated terrain tiles (heightfield + mesh arrays) and
+// mipmapped textures. files are mmapped on load and uploaded straight from
+// the mapping. anything with a wrong version, key, size or checksum is
+// treated as a miss and regenerated.
+
+#define CACHE_KEY_MAX 64
+
+// a mapped tile, heights and mesh arrays point into the mapping
+typedef struct CacheTile {
+  void *map;
+  size_t map_size;
+  const float *heights;
+  int width, length;
+  float spacing, max_height;
+  TerrainMesh mesh;
+} CacheTile;
+
+// creates dir if needed, false if it can't be used
+bool cache_init(const char *dir);
+
+// key is the raw bytes of whatever generated the tile (at most CACHE_KEY_MAX),
+// it is hashed into the file name and compared in full on load
+bool cache_load_tile(const char *dir, const void *key, size_t key_size, int cx, int cz, CacheTile *tile);
+bool cache_store_tile(const char *dir, const void *key, size_t key_size, int cx, int cz,
+                      const Heightfield *hf, const TerrainMesh *mesh);
+void cache_release_tile(CacheTile *tile);
+
+// LoadTexture + ImageMipmaps, with the mipmap chain cached next to the tiles
+// and invalidated when the source file changes
+Texture cache_load_texture_mipmapped(const char *dir, const char *path);
+
+#endif
@@ -0,0 +1,327 @@
+#include "cdlod.h"
+
+#include <math.h>
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---Setup---
+
+Cdlod cdlod_init(CdlodConfig cfg, int cells, float spacing) {
+  Cdlod lod = {.cells = cells, .spacing = spacing};
+  if (cfg.levels <= 0)
+    return lod;
+
+  // morphing and quadrants both need an even patch
+  if (cfg.patch_cells < 2 || cfg.patch_cells > 128 || cfg.patch_cells % 2 || cells % cfg.patch_cells) {
+    TRACELOG(LOG_WARNING, "CDLOD: a %d cell patch doesn't fit %d cell chunks, lod disabled", cfg.patch_cells,
+             cells);
+    return lod;
+  }
+  // every level has to tile the chunk
+  int levels = 1;
+  while (levels < cfg.levels && levels < CDLOD_MAX_LEVELS && cells % (cfg.patch_cells << levels) == 0)
+    levels++;
+  cfg.levels = levels;
+  lod.cfg = cfg;
+  lod.roots = cells / (cfg.patch_cells << (levels - 1));
+
+  for (int l = 0; l < levels; l++) {
+    lod.ranges[l] = cfg.lod0_range * (float)(1 << l);
+    float prev = l ? lod.ranges[l - 1] : 0;
+    float start = prev + (lod.ranges[l] - prev) * cfg.morph_start;
+    lod.morph[l][0] = start;
+    lod.morph[l][1] = 1.0f / (lod.ranges[l] - start);
+
+    int per_side = cells / (cfg.patch_cells << l);
+    lod.bounds_offset[l] = lod.bounds_count;
+    lod.bounds_count += per_side * per_side;
+  }
+  // nothing coarser to morph into
+  lod.morph[levels - 1][0] = 0;
+  lod.morph[levels - 1][1] = 0;
+  return lod;
+}
+
+static void patch_upload(Cdlod *lod) {
+  int p = lod->cfg.patch_cells, n = p + 1, half = p / 2;
+  float *vertices = RL_MALLOC(n * n * 3 * sizeof(float));
+  for (int z = 0; z < n; z++) {
+    for (int x = 0; x < n; x++) {
+      float *v = &vertices[(z * n + x) * 3];
+      v[0] = x;
+      v[1] = 0;
+      v[2] = z;
+    }
+  }
+
+  // same triangulation as terrain_indices_build, one quadrant after the other
+  lod->index_count = p * p * 6;
+  unsigned short *indices = RL_MALLOC(lod->index_count * sizeof(unsigned short));
+  unsigned short *out = indices;
+  for (int q = 0; q < 4; q++) {
+    int qx = (q & 1) * half, qz = (q >> 1) * half;
+    for (int z = qz; z < qz + half; z++) {
+      for (int x = qx; x < qx + half; x++) {
+        unsigned short i00 = z * n + x, i10 = i00 + 1;
+        unsigned short i01 = i00 + n, i11 = i01 + 1;
+        *out++ = i00;
+        *out++ = i01;
+        *out++ = i10;
+        *out++ = i10;
+        *out++ = i01;
+        *out++ = i11;
+      }
+    }
+  }
+
+  lod->vao = rlLoadVertexArray();
+  rlEnableVertexArray(lod->vao);
+  lod->vbo = rlLoadVertexBuffer(vertices, n * n * 3 * sizeof(float), false);
+  rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, 3, RL_FLOAT, 0, 0, 0);
+  rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION);
+  lod->ebo = rlLoadVertexBufferElement(indices, lod->index_count * sizeof(unsigned short), false);
+  rlDisableVertexArray();
+
+  RL_FREE(vertices);
+  RL_FREE(indices);
+}
+
+void cdlod_unload(Cdlod *lod) {
+  if (lod->vao) {
+    rlUnloadVertexArray(lod->vao);
+    rlUnloadVertexBuffer(lod->vbo);
+    rlUnloadVertexBuffer(lod->ebo);
+  }
+  RL_FREE(lod->nodes);
+  lod->nodes = NULL;
+  lod->vao = 0;
+}
+
+//---Chunks---
+
+// level 0 from the samples, edges included since neighbours share them
+static void leaf_bounds(const Cdlod *lod, const Heightfield *hf, float *bounds, int nx, int nz) {
+  int p = lod->cfg.patch_cells;
+  float lo = INFINITY, hi = -INFINITY;
+  for (int z = nz * p; z <= (nz + 1) * p; z++) {
+    const float *row = &hf->heights[z * hf->width];
+    for (int x = nx * p; x <= (nx + 1) * p; x++) {
+      lo = fminf(lo, row[x]);
+      hi = fmaxf(hi, row[x]);
+    }
+  }
+  float *b = &bounds[(nz * (lod->cells / p) + nx) * 2];
+  b[0] = lo;
+  b[1] = hi;
+}
+
+// every other level from its four children
+static void parent_bounds(const Cdlod *lod, float *bounds, int level, int nx, int nz) {
+  int per_side = lod->cells / (lod->cfg.patch_cells << level), child_side = per_side * 2;
+  const float *c00 = &bounds[(lod->bounds_offset[level - 1] + nz * 2 * child_side + nx * 2) * 2];
+  const float *c01 = c00 + child_side * 2;
+  float *b = &bounds[(lod->bounds_offset[level] + nz * per_side + nx) * 2];
+  b[0] = fminf(fminf(c00[0], c00[2]), fminf(c01[0], c01[2]));
+  b[1] = fmaxf(fmaxf(c00[1], c00[3]), fmaxf(c01[1], c01[3]));
+}
+
+void cdlod_chunk_build(const Cdlod *lod, const Heightfield *hf, CdlodChunk *chunk) {
+  chunk->bounds = RL_MALLOC(lod->bounds_count * 2 * sizeof(float));
+  for (int l = 0; l < lod->cfg.levels; l++) {
+    int per_side = lod->cells / (lod->cfg.patch_cells << l);
+    for (int nz = 0; nz < per_side; nz++) {
+      for (int nx = 0; nx < per_side; nx++) {
+        if (l == 0)
+          leaf_bounds(lod, hf, chunk->bounds, nx, nz);
+        else
+          parent_bounds(lod, chunk->bounds, l, nx, nz);
+      }
+    }
+  }
+}
+
+static unsigned int load_sample_texture(const void *data, int width, int length, int format) {
+  unsigned int id = rlLoadTexture(data, width, length, format, 1);
+  // linear so morphing vertices between samples follow the surface
+  rlTextureParameters(id, RL_TEXTURE_MIN_FILTER, RL_TEXTURE_FILTER_LINEAR);
+  rlTextureParameters(id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_LINEAR);
+  rlTextureParameters(id, RL_TEXTURE_WRAP_S, RL_TEXTURE_WRAP_CLAMP);
+  rlTextureParameters(id, RL_TEXTURE_WRAP_T, RL_TEXTURE_WRAP_CLAMP);
+  return id;
+}
+
+void cdlod_chunk_upload(CdlodChunk *chunk, const Heightfield *hf, const float *normals) {
+  chunk->height_map = load_sample_texture(hf->heights, hf->width, hf->length, PIXELFORMAT_UNCOMPRESSED_R32);
+  chunk->normal_map = load_sample_texture(normals, hf->width, hf->length, PIXELFORMAT_UNCOMPRESSED_R32G32B32);
+}
+
+void cdlod_chunk_update(const Cdlod *lod, CdlodChunk *chunk, const Heightfield *hf, HeightfieldRect rect,
+                        const float *normals) {
+  // the nodes touching the rect and their ancestors, a node spans samples
+  // n * size to (n + 1) * size so one on a node edge is in both
+  for (int l = 0; l < lod->cfg.levels; l++) {
+    int size = lod->cfg.patch_cells << l, last = lod->cells / size - 1;
+    int x0 = rect.x0 ? (rect.x0 - 1) / size : 0, x1 = rect.x1 / size < last ? rect.x1 / size : last;
+    int z0 = rect.z0 ? (rect.z0 - 1) / size : 0, z1 = rect.z1 / size < last ? rect.z1 / size : last;
+    for (int nz = z0; nz <= z1; nz++) {
+      for (int nx = x0; nx <= x1; nx++) {
+        if (l == 0)
+          leaf_bounds(lod, hf, chunk->bounds, nx, nz);
+        else
+          parent_bounds(lod, chunk->bounds, l, nx, nz);
+      }
+    }
+  }
+
+  if (!chunk->height_map)
+    return;
+  int w = heightfield_rect_width(rect), l = heightfield_rect_length(rect);
+  float *heights = RL_MALLOC((size_t)w * l * sizeof(float));
+  for (int z = 0; z < l; z++)
+    memcpy(&heights[z * w], &hf->heights[(rect.z0 + z) * hf->width + rect.x0], w * sizeof(float));
+  rlUpdateTexture(chunk->height_map, rect.x0, rect.z0, w, l, PIXELFORMAT_UNCOMPRESSED_R32, heights);
+  rlUpdateTexture(chunk->normal_map, rect.x0, rect.z0, w, l, PIXELFORMAT_UNCOMPRESSED_R32G32B32, normals);
+  RL_FREE(heights);
+}
+
+void cdlod_chunk_unload(CdlodChunk *chunk) {
+  if (chunk->height_map)
+    rlUnloadTexture(chunk->height_map);
+  if (chunk->normal_map)
+    rlUnloadTexture(chunk->normal_map);
+  RL_FREE(chunk->bounds);
+  *chunk = (CdlodChunk){0};
+}
+
+size_t cdlod_chunk_bytes(const Cdlod *lod, const Heightfield *hf) {
+  return (size_t)hf->width * hf->length * 4 * sizeof(float) + (size_t)lod->bounds_count * 2 * sizeof(float);
+}
+
+//---Selection---
+
+static void add_node(Cdlod *lod, const CdlodChunk *chunk, Vector3 origin, int level, int nx, int nz,
+                     unsigned char quadrants) {
+  if (lod->node_count == lod->node_capacity) {
+    lod->node_capacity = lod->node_capacity ? lod->node_capacity * 2 : 256;
+    lod->nodes = RL_REALLOC(lod->nodes, lod->node_capacity * sizeof(CdlodNode));
+  }
+  int size = lod->cfg.patch_cells << level;
+  lod->nodes[lod->node_count++] = (CdlodNode){chunk, origin, nx * size, nz * size, level, quadrants};
+
+  int p = lod->cfg.patch_cells;
+  int drawn = (quadrants & 1) + (quadrants >> 1 & 1) + (quadrants >> 2 & 1) + (quadrants >> 3 & 1);
+  lod->stats.nodes++;
+  lod->stats.triangles += p * p * 2 * drawn / 4;
+  lod->stats.level_nodes[level]++;
+}
+
+static BoundingBox node_box(const Cdlod *lod, const CdlodChunk *chunk, Vector3 origin, int level, int nx, int nz) {
+  int per_side = lod->cells / (lod->cfg.patch_cells << level);
+  const float *b = &chunk->bounds[(lod->bounds_offset[level] + nz * per_side + nx) * 2];
+  float size = (lod->cfg.patch_cells << level) * lod->spacing;
+  Vector3 min = {origin.x + nx * size, origin.y + b[0], origin.z + nz * size};
+  return (BoundingBox){min, {min.x + size, origin.y + b[1], min.z + size}};
+}
+
+// false when the node is beyond its level's range, the parent then covers
+// that quadrant itself. nodes out of view count as handled so nothing
+// draws them, children of a node fully in view skip the test
+static bool select_node(Cdlod *lod, const CdlodChunk *chunk, Vector3 origin, Vector3 eye, const Frustum *frustum,
+                        int level, int nx, int nz) {
+  BoundingBox box = node_box(lod, chunk, origin, level, nx, nz);
+  if (frustum) {
+    FrustumResult result = frustum_test_box(frustum, box);
+    if (result == FRUSTUM_OUTSIDE) {
+      lod->stats.culled++;
+      return true;
+    }
+    if (result == FRUSTUM_INSIDE)
+      frustum = NULL;
+  }
+  if (!CheckCollisionBoxSphere(box, eye, lod->ranges[level]))
+    return false;
+
+  if (level == 0 || !CheckCollisionBoxSphere(box, eye, lod->ranges[level - 1])) {
+    add_node(lod, chunk, origin, level, nx, nz, 0xf);
+    return true;
+  }
+
+  unsigned char quadrants = 0;
+  for (int q = 0; q < 4; q++) {
+    if (!select_node(lod, chunk, origin, eye, frustum, level - 1, nx * 2 + (q & 1), nz * 2 + (q >> 1)))
+      quadrants |= 1 << q;
+  }
+  if (quadrants)
+    add_node(lod, chunk, origin, level, nx, nz, quadrants);
+  return true;
+}
+
+void cdlod_begin(Cdlod *lod) {
+  lod->node_count = 0;
+  lod->stats = (CdlodStats){0};
+}
+
+void cdlod_select(Cdlod *lod, const CdlodChunk *chunk, Vector3 origin, Vector3 eye, const Frustum *frustum) {
+  int top = lod->cfg.levels - 1;
+  for (int nz = 0; nz < lod->roots; nz++) {
+    for (int nx = 0; nx < lod->roots; nx++) {
+      // past the last range there is nothing coarser, draw the root anyway
+      if (!select_node(lod, chunk, origin, eye, frustum, top, nx, nz))
+        add_node(lod, chunk, origin, top, nx, nz, 0xf);
+    }
+  }
+}
+
+//---Drawing---
+
+void cdlod_draw(Cdlod *lod, RenderQueue *queue, Material material, Vector3 eye) {
+  if (lod->node_count == 0)
+    return;
+  if (!lod->vao)
+    patch_upload(lod);
+
+  Shader shader = material.shader;
+  if (shader.id != lod->shader_id) {
+    lod->shader_id = shader.id;
+    lod->loc_node = GetShaderLocation(shader, "node");
+    lod->loc_morph = GetShaderLocation(shader, "morph");
+    lod->loc_eye = GetShaderLocation(shader, "eye");
+    lod->loc_spacing = GetShaderLocation(shader, "spacing");
+    lod->loc_height_map = GetShaderLocation(shader, "heightMap");
+    lod->loc_normal_map = GetShaderLocation(shader, "normalMap");
+  }
+
+  int slots[2] = {1, 2}; // heights, normals. the diffuse map is on 0
+  int quarter = lod->index_count / 4;
+  for (int i = 0; i < lod->node_count; i++) {
+    const CdlodNode *node = &lod->nodes[i];
+    float size = (lod->cfg.patch_cells << node->level) * lod->spacing;
+    Vector2 center = {node->origin.x + node->x * lod->spacing + size / 2, node->origin.z + node->z * lod->spacing + size / 2};
+    float depth = Vector2Distance(center, (Vector2){eye.x, eye.z});
+    Vector3 local_eye = Vector3Subtract(eye, node->origin);
+    float params[3] = {node->x, node->z, 1 << node->level};
+
+    // a draw per quadrant unless it's whole, the queue skips the uniforms
+    // they share
+    bool whole = node->quadrants == 0xf;
+    for (int q = 0; q < (whole ? 1 : 4); q++) {
+      if (!whole && !(node->quadrants & 1 << q))
+        continue;
+      int first = whole ? 0 : q * quarter, count = whole ? lod->index_count : quarter;
+      RenderCommand *command = render_queue_push(queue, shader, lod->vao, first, count, RENDER_INDEX_16, depth);
+      command->textures[0] = material.maps[MATERIAL_MAP_DIFFUSE].texture.id;
+      command->textures[1] = node->chunk->height_map;
+      command->textures[2] = node->chunk->normal_map;
+      command->color = material.maps[MATERIAL_MAP_DIFFUSE].color;
+      command->transform = MatrixTranslate(node->origin.x, node->origin.y, node->origin.z);
+      render_queue_uniform(queue, lod->loc_spacing, SHADER_UNIFORM_FLOAT, &lod->spacing);
+      render_queue_uniform(queue, lod->loc_height_map, SHADER_UNIFORM_INT, &slots[0]);
+      render_queue_uniform(queue, lod->loc_normal_map, SHADER_UNIFORM_INT, &slots[1]);
+      render_queue_uniform(queue, lod->loc_eye, SHADER_UNIFORM_VEC3, &local_eye);
+      render_queue_uniform(queue, lod->loc_node, SHADER_UNIFORM_VEC3, params);
+      render_queue_uniform(queue, lod->loc_morph, SHADER_UNIFORM_VEC2, lod->morph[node->level]);
+    }
+  }
+}
@@ -0,0 +1,105 @@
+#ifndef CDLOD_H
+#define CDLOD_H
+
+#include <raylib.h>
+#include <stddef.h>
+
+#include "frustum.h"
+#include "heightfield.h"
+#include "render_queue.h"
+
+// continuous distance based lod (cdlod). every chunk is covered by a quadtree
+// of nodes, a node at level l spans patch_cells << l cells and is drawn as the
+// same patch_cells grid with a sample step of 1 << l. nodes are picked from
+// the distance to the camera, and the vertex shader (cdlod.vert) reads the
+// heights from a texture and slides odd vertices onto their even neighbours
+// as a node approaches the next coarser level, so levels meet without seams
+// or popping. the triangle count depends on the ranges, not on the terrain
+// size.
+
+#define CDLOD_MAX_LEVELS 8
+
+typedef struct CdlodConfig {
+  int patch_cells;   // grid cells per patch side, even, <= 128 and dividing the chunk
+  int levels;        // levels per chunk, clamped to what the chunk size allows.
+                     // 0 (or a patch that doesn't fit) disables lod
+  float lod0_range;  // world distance drawn at full resolution, doubles per
+                     // level. should be at least twice a level 0 node
+  float morph_start; // fraction of a level's range where morphing begins
+} CdlodConfig;
+
+// per chunk data: min/max heights of every node for the range tests and the
+// textures the shader samples
+typedef struct CdlodChunk {
+  float *bounds; // min, max per node, level 0 first, row major per level
+  unsigned int height_map; // r32f, one texel per sample
+  unsigned int normal_map; // rgb32f
+} CdlodChunk;
+
+// a node picked for drawing, quadrants is a mask of the four children drawn
+// at this node's resolution (the others went to finer nodes)
+typedef struct CdlodNode {
+  const CdlodChunk *chunk;
+  Vector3 origin; // chunk world position
+  int x, z;       // first sample
+  int level;
+  unsigned char quadrants;
+} CdlodNode;
+
+typedef struct CdlodStats {
+  int nodes;     // selected this frame
+  int triangles; // submitted this frame
+  int culled;    // nodes outside the frustum
+  int level_nodes[CDLOD_MAX_LEVELS];
+} CdlodStats;
+
+typedef struct Cdlod {
+  CdlodConfig cfg;
+  int cells; // per chunk side
+  float spacing;
+  int roots; // top level nodes per chunk side
+  float ranges[CDLOD_MAX_LEVELS];
+  float morph[CDLOD_MAX_LEVELS][2]; // start, 1 / (end - start)
+  int bounds_offset[CDLOD_MAX_LEVELS];
+  int bounds_count;
+
+  // the patch, x and z are grid coordinates. indices are ordered by quadrant
+  // so a quadrant is one contiguous draw
+  unsigned int vao, vbo, ebo;
+  int index_count;
+
+  CdlodNode *nodes;
+  int node_count, node_capacity;
+  CdlodStats stats;
+
+  // uniform locations, looked up again when the shader changes
+  unsigned int shader_id;
+  int loc_node, loc_morph, loc_eye, loc_spacing, loc_height_map, loc_normal_map;
+} Cdlod;
+
+// chunks are cells x cells with the given sample spacing. cpu side only, the
+// patch is uploaded on the first draw
+Cdlod cdlod_init(CdlodConfig cfg, int cells, float spacing);
+void cdlod_unload(Cdlod *lod);
+
+// cpu side only so it can run on a worker thread
+void cdlod_chunk_build(const Cdlod *lod, const Heightfield *hf, CdlodChunk *chunk);
+// normals are per sample, same layout as TerrainMesh.normals
+void cdlod_chunk_upload(CdlodChunk *chunk, const Heightfield *hf, const float *normals);
+// after an edit to rect of the chunk's heightfield: the bounds of the nodes
+// over it and their ancestors, and just that rect of the textures. normals
+// are for the rect, xyz per sample row by row
+void cdlod_chunk_update(const Cdlod *lod, CdlodChunk *chunk, const Heightfield *hf, HeightfieldRect rect,
+                        const float *normals);
+void cdlod_chunk_unload(CdlodChunk *chunk);
+size_t cdlod_chunk_bytes(const Cdlod *lod, const Heightfield *hf);
+
+// selection for one frame: begin, select every chunk, then draw. nodes
+// outside the frustum are dropped, pass NULL when the whole chunk is visible
+void cdlod_begin(Cdlod *lod);
+void cdlod_select(Cdlod *lod, const CdlodChunk *chunk, Vector3 origin, Vector3 eye, const Frustum *frustum);
+// queues the selected nodes, grouped by chunk textures and front to back.
+// only the diffuse map of the material is bound, the shader has to be cdlod.vert
+void cdlod_draw(Cdlod *lod, RenderQueue *queue, Material material, Vector3 eye);
+
+#endif
@@ -0,0 +1,45 @@
+#version 330
+
+// cdlod patch, x and z are grid coordinates of a flat patch that every node
+// places over its part of the chunk (see cdlod.h)
+in vec3 vertexPosition;
+
+uniform mat4 mvp;
+uniform mat4 matNormal;
+
+uniform sampler2D heightMap; // one texel per heightfield sample
+uniform sampler2D normalMap;
+uniform vec3 node;     // first sample (x, z) and samples per grid cell
+uniform vec2 morph;    // distance where morphing starts, 1 / morph length
+uniform vec3 eye;      // camera in chunk space
+uniform float spacing; // world distance between samples
+
+out vec2 texCoord;
+out vec3 fragNormal;
+
+vec2 sampleUv(vec2 s)
+{
+    return (s + 0.5)/vec2(textureSize(heightMap, 0));
+}
+
+vec3 surface(vec2 s)
+{
+    return vec3(s.x*spacing, texture(heightMap, sampleUv(s)).r, s.y*spacing);
+}
+
+void main()
+{
+    vec2 grid = vertexPosition.xz;
+    vec3 pos = surface(node.xy + grid*node.z);
+
+    // odd vertices slide onto their even neighbour as the node gets close to
+    // the next coarser level's range, at 1 the patch is that level exactly
+    float k = clamp((distance(pos, eye) - morph.x)*morph.y, 0.0, 1.0);
+    grid -= fract(grid*0.5)*2.0*k;
+    vec2 s = node.xy + grid*node.z;
+    pos = surface(s);
+
+    texCoord = s/(vec2(textureSize(heightMap, 0)) - 1.0);
+    fragNormal = vec3(matNormal) * texture(normalMap, sampleUv(s)).xyz;
+    gl_Position = mvp * vec4(pos, 1.0);
+}
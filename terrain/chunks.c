@@ -0,0 +1,845 @@
+#include "chunks.h"
+
+#include <limits.h>
+#include <math.h>
+#include <raymath.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "parallel.h"
+#include "perlin.h"
+
+//---Lookup---
+
+static unsigned int chunk_hash(int cx, int cz) {
+  return (unsigned int)cx * 73856093u ^ (unsigned int)cz * 19349663u;
+}
+
+static void table_insert(ChunkManager *cm, Chunk *c) {
+  unsigned int mask = cm->table_size - 1;
+  unsigned int i = chunk_hash(c->cx, c->cz) & mask;
+  while (cm->table[i])
+    i = (i + 1) & mask;
+  cm->table[i] = c;
+}
+
+// rebuilt from scratch on growth and after evictions, both are rare
+static void table_rebuild(ChunkManager *cm) {
+  int size = cm->table_size ? cm->table_size : 64;
+  while (size < cm->count * 2)
+    size *= 2;
+  if (size != cm->table_size) {
+    RL_FREE(cm->table);
+    cm->table = RL_MALLOC(size * sizeof(Chunk *));
+    cm->table_size = size;
+  }
+  memset(cm->table, 0, size * sizeof(Chunk *));
+  for (int i = 0; i < cm->count; i++)
+    table_insert(cm, cm->chunks[i]);
+}
+
+Chunk *chunks_find(const ChunkManager *cm, int cx, int cz) {
+  unsigned int mask = cm->table_size - 1;
+  unsigned int i = chunk_hash(cx, cz) & mask;
+  while (cm->table[i]) {
+    Chunk *c = cm->table[i];
+    if (c->cx == cx && c->cz == cz)
+      return c;
+    i = (i + 1) & mask;
+  }
+  return NULL;
+}
+
+//---Workers---
+
+// everything that changes a tile's contents, bump mesh_format when the
+// mesh builder changes
+typedef struct ChunkKey {
+  int mesh_format;
+  int cells;
+  float spacing;
+  float max_height;
+  int seed_x, seed_z;
+  float noise_step;
+  float lacunarity;
+  float gain;
+  int octaves;
+} ChunkKey;
+
+#define MESH_FORMAT 3 // 2: smooth normals from the noise derivatives, 3: indexed
+
+static ChunkKey chunk_key(const ChunkConfig *cfg) {
+  return (ChunkKey){MESH_FORMAT, cfg->cells, cfg->spacing, cfg->max_height, cfg->seed_x, cfg->seed_z,
+                    cfg->noise_step, cfg->lacunarity, cfg->gain, cfg->octaves};
+}
+
+// done with a cpu mesh, its arrays are either ours or in the cache mapping
+static void chunk_release_mesh(Chunk *c, TerrainMesh *mesh) {
+  if (c->tile.map) {
+    cache_release_tile(&c->tile);
+    mesh->vertices = NULL;
+    mesh->normals = NULL;
+    mesh->texcoords = NULL;
+  } else {
+    terrain_mesh_free_cpu(mesh);
+  }
+}
+
+static void chunk_generate(const ChunkManager *cm, Chunk *c) {
+  const ChunkConfig *cfg = &cm->cfg;
+  int n = cfg->cells + 1;
+  ChunkKey key = chunk_key(cfg);
+  c->hf = heightfield_alloc(n, n, cfg->spacing, cfg->max_height);
+
+  bool cached = cfg->cache_dir && cache_load_tile(cfg->cache_dir, &key, sizeof(key), c->cx, c->cz, &c->tile);
+  if (cached && (c->tile.width != n || c->tile.length != n)) {
+    cache_release_tile(&c->tile);
+    cached = false;
+  }
+
+  if (cached) {
+    memcpy(c->hf.heights, c->tile.heights, (size_t)n * n * sizeof(float));
+    c->mesh = c->tile.mesh;
+  } else {
+    // offsets in samples so the shared edge samples of neighbours are identical
+    // slopes only live long enough to give the mesh its normals
+    heightfield_alloc_slopes(&c->hf);
+    perlin_heightfield(&c->hf, cfg->seed_x + c->cx * cfg->cells, cfg->seed_z + c->cz * cfg->cells,
+                       cfg->noise_step * n, cfg->lacunarity, cfg->gain, cfg->octaves, 1);
+    c->mesh = terrain_mesh_build(&c->hf);
+    RL_FREE(c->hf.slopes);
+    c->hf.slopes = NULL;
+    if (cfg->cache_dir)
+      cache_store_tile(cfg->cache_dir, &key, sizeof(key), c->cx, c->cz, &c->hf, &c->mesh);
+  }
+  c->min_height = INFINITY;
+  c->max_height = -INFINITY;
+  for (int i = 0; i < n * n; i++) {
+    c->min_height = fminf(c->min_height, c->hf.heights[i]);
+    c->max_height = fmaxf(c->max_height, c->hf.heights[i]);
+  }
+
+  c->pyramid = height_pyramid_build(&c->hf);
+  c->bytes = (size_t)n * n * sizeof(float) + height_pyramid_bytes(&c->pyramid);
+  if (cm->lod.cfg.levels) {
+    cdlod_chunk_build(&cm->lod, &c->hf, &c->lod);
+    c->bytes += cdlod_chunk_bytes(&cm->lod, &c->hf);
+    return;
+  }
+
+  if (cm->rtin) {
+    // the full mesh only lends its normals
+    TerrainMesh full = c->mesh;
+    rtin_init(&c->rtin, &c->hf);
+    c->mesh = rtin_build_mesh(&c->rtin, &c->hf, full.normals, cfg->rtin_error, cfg->rtin_error * 2, &c->indices);
+    chunk_release_mesh(c, &full);
+    c->bytes += (size_t)n * n * sizeof(float) + (size_t)c->indices.count * sizeof(unsigned int);
+  }
+  if (cfg->packed) {
+    c->packed = packed_mesh_from_terrain(&c->mesh, &c->hf, 0);
+    chunk_release_mesh(c, &c->mesh);
+    c->bytes += packed_mesh_bytes(&c->packed);
+  } else {
+    c->bytes += (size_t)c->mesh.vertex_count * 8 * sizeof(float);
+  }
+}
+
+static void *chunk_worker(void *arg) {
+  ChunkManager *cm = arg;
+  pthread_mutex_lock(&cm->lock);
+  for (;;) {
+    while (!cm->quit && cm->queue_count == 0)
+      pthread_cond_wait(&cm->wake, &cm->lock);
+    if (cm->quit)
+      break;
+
+    Chunk *c = cm->queue[cm->queue_head];
+    cm->queue_head = (cm->queue_head + 1) % cm->queue_capacity;
+    cm->queue_count--;
+
+    if (c->cancel) {
+      c->state = CHUNK_CANCELLED;
+      continue;
+    }
+    c->state = CHUNK_GENERATING;
+    pthread_mutex_unlock(&cm->lock);
+
+    chunk_generate(cm, c);
+
+    pthread_mutex_lock(&cm->lock);
+    c->state = CHUNK_GENERATED;
+  }
+  pthread_mutex_unlock(&cm->lock);
+  return NULL;
+}
+
+// caller holds the lock
+static void queue_push(ChunkManager *cm, Chunk *c) {
+  if (cm->queue_count == cm->queue_capacity) {
+    int capacity = cm->queue_capacity ? cm->queue_capacity * 2 : 64;
+    Chunk **queue = RL_MALLOC(capacity * sizeof(Chunk *));
+    for (int i = 0; i < cm->queue_count; i++)
+      queue[i] = cm->queue[(cm->queue_head + i) % cm->queue_capacity];
+    RL_FREE(cm->queue);
+    cm->queue = queue;
+    cm->queue_head = 0;
+    cm->queue_capacity = capacity;
+  }
+  cm->queue[(cm->queue_head + cm->queue_count) % cm->queue_capacity] = c;
+  cm->queue_count++;
+}
+
+//---Manager---
+
+void chunks_init(ChunkManager *cm, ChunkConfig cfg) {
+  memset(cm, 0, sizeof(*cm));
+  cm->cfg = cfg;
+  cm->chunk_size = cfg.cells * cfg.spacing;
+  cm->lod = cdlod_init(cfg.lod, cfg.cells, cfg.spacing);
+  if (!cm->lod.cfg.levels && cfg.rtin_error > 0) {
+    cm->rtin = cfg.cells >= 2 && !(cfg.cells & (cfg.cells - 1));
+    if (!cm->rtin)
+      TRACELOG(LOG_WARNING, "CHUNKS: adaptive meshes need power of two chunks, not %d cells", cfg.cells);
+  }
+  if (!cm->lod.cfg.levels && !cm->rtin)
+    cm->indices = terrain_indices_build(cfg.cells + 1, cfg.cells + 1);
+  table_rebuild(cm);
+
+  pthread_mutex_init(&cm->lock, NULL);
+  pthread_cond_init(&cm->wake, NULL);
+
+  int threads = cfg.threads > 0 ? cfg.threads : parallel_cpu_count() - 1;
+  if (threads < 1)
+    threads = 1;
+  cm->workers = RL_MALLOC(threads * sizeof(pthread_t));
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&cm->workers[cm->worker_count], NULL, chunk_worker, cm) == 0)
+      cm->worker_count++;
+  }
+  if (cm->worker_count == 0)
+    TRACELOG(LOG_WARNING, "CHUNKS: could not start any worker threads");
+}
+
+static void chunk_free(Chunk *c) {
+  cdlod_chunk_unload(&c->lod);
+  rtin_unload(&c->rtin);
+  terrain_indices_unload(&c->indices);
+  packed_mesh_unload(&c->packed);
+  height_pyramid_unload(&c->pyramid);
+  if (c->state == CHUNK_READY)
+    terrain_mesh_unload(&c->mesh);
+  else if (c->tile.map)
+    cache_release_tile(&c->tile);
+  else
+    terrain_mesh_free_cpu(&c->mesh);
+  heightfield_unload(&c->hf);
+  RL_FREE(c);
+}
+
+void chunks_unload(ChunkManager *cm) {
+  pthread_mutex_lock(&cm->lock);
+  cm->quit = true;
+  pthread_cond_broadcast(&cm->wake);
+  pthread_mutex_unlock(&cm->lock);
+  for (int i = 0; i < cm->worker_count; i++)
+    pthread_join(cm->workers[i], NULL);
+
+  for (int i = 0; i < cm->count; i++)
+    chunk_free(cm->chunks[i]);
+  RL_FREE(cm->chunks);
+  RL_FREE(cm->table);
+  RL_FREE(cm->queue);
+  RL_FREE(cm->workers);
+  terrain_indices_unload(&cm->indices);
+  cdlod_unload(&cm->lod);
+  pthread_mutex_destroy(&cm->lock);
+  pthread_cond_destroy(&cm->wake);
+}
+
+static void chunk_remove(ChunkManager *cm, int index) {
+  cm->stats.bytes -= cm->chunks[index]->bytes;
+  chunk_free(cm->chunks[index]);
+  cm->chunks[index] = cm->chunks[--cm->count];
+}
+
+static int ring_distance(const Chunk *c, int cx, int cz) {
+  int dx = abs(c->cx - cx), dz = abs(c->cz - cz);
+  return dx > dz ? dx : dz;
+}
+
+static void request_ring(ChunkManager *cm, int cx, int cz) {
+  int r = cm->cfg.radius;
+  bool added = false;
+
+  pthread_mutex_lock(&cm->lock);
+  // nearest rings first so the ground under the player comes in first
+  for (int d = 0; d <= r; d++) {
+    for (int z = cz - d; z <= cz + d; z++) {
+      for (int x = cx - d; x <= cx + d; x++) {
+        if (abs(x - cx) != d && abs(z - cz) != d)
+          continue;
+
+        Chunk *c = chunks_find(cm, x, z);
+        if (c) {
+          c->last_used = cm->frame;
+          c->cancel = false;
+          continue;
+        }
+
+        c = RL_CALLOC(1, sizeof(Chunk));
+        c->cx = x;
+        c->cz = z;
+        c->state = CHUNK_QUEUED;
+        c->last_used = cm->frame;
+        if (cm->count == cm->capacity) {
+          cm->capacity = cm->capacity ? cm->capacity * 2 : 64;
+          cm->chunks = RL_REALLOC(cm->chunks, cm->capacity * sizeof(Chunk *));
+        }
+        cm->chunks[cm->count++] = c;
+        if (cm->count * 2 > cm->table_size)
+          table_rebuild(cm);
+        else
+          table_insert(cm, c);
+        queue_push(cm, c);
+        added = true;
+      }
+    }
+  }
+
+  // anything still queued outside the ring is not worth generating anymore
+  for (int i = 0; i < cm->count; i++) {
+    Chunk *c = cm->chunks[i];
+    if (c->state == CHUNK_QUEUED && ring_distance(c, cx, cz) > r)
+      c->cancel = true;
+  }
+
+  if (added)
+    pthread_cond_broadcast(&cm->wake);
+  pthread_mutex_unlock(&cm->lock);
+}
+
+void chunks_update(ChunkManager *cm, Vector3 position) {
+  cm->frame++;
+  int cx = (int)floorf(position.x / cm->chunk_size);
+  int cz = (int)floorf(position.z / cm->chunk_size);
+  request_ring(cm, cx, cz);
+
+  // snapshot worker progress, GENERATED and CANCELLED chunks belong to the
+  // main thread from here on
+  int pending = 0;
+  bool removed = false;
+  pthread_mutex_lock(&cm->lock);
+  for (int i = 0; i < cm->count; i++) {
+    Chunk *c = cm->chunks[i];
+    if (c->state == CHUNK_QUEUED || c->state == CHUNK_GENERATING)
+      pending++;
+    c->has_data = c->state == CHUNK_GENERATED || c->state == CHUNK_READY;
+    c->dead = c->state == CHUNK_CANCELLED;
+  }
+  pthread_mutex_unlock(&cm->lock);
+
+  for (int i = 0; i < cm->count;) {
+    if (cm->chunks[i]->dead) {
+      chunk_remove(cm, i);
+      removed = true;
+    } else {
+      i++;
+    }
+  }
+
+  // time sliced upload, nearest first. always allow one so a slow upload
+  // can't stall streaming, after that only start one if it should fit
+  double start = GetTime();
+  cm->stats.uploaded = 0;
+  for (;;) {
+    Chunk *best = NULL;
+    int best_d = 0;
+    for (int i = 0; i < cm->count; i++) {
+      Chunk *c = cm->chunks[i];
+      int d = ring_distance(c, cx, cz);
+      if (c->has_data && c->state == CHUNK_GENERATED && (!best || d < best_d)) {
+        best = c;
+        best_d = d;
+      }
+    }
+    if (!best)
+      break;
+
+    double elapsed = GetTime() - start;
+    if (!cm->cfg.headless && cm->stats.uploaded > 0 && elapsed + cm->upload_cost > cm->cfg.upload_budget)
+      break;
+
+    double t = GetTime();
+    if (cm->cfg.headless) {
+      // the heightfield is all the queries read
+    } else if (cm->lod.cfg.levels) {
+      cdlod_chunk_upload(&best->lod, &best->hf, best->mesh.normals);
+    } else {
+      TerrainIndices *indices = cm->rtin ? &best->indices : &cm->indices;
+      if (!indices->ebo)
+        terrain_indices_upload(indices);
+      if (cm->cfg.packed)
+        packed_mesh_upload(&best->packed, indices);
+      else
+        terrain_mesh_upload(&best->mesh, indices);
+    }
+    if (best->tile.map) {
+      // straight from the mapping, nothing to free
+      best->mesh.vertices = NULL;
+      best->mesh.normals = NULL;
+      best->mesh.texcoords = NULL;
+      cache_release_tile(&best->tile);
+    } else {
+      // the gpu has it now, height queries read the heightfield
+      terrain_mesh_free_cpu(&best->mesh);
+    }
+    t = GetTime() - t;
+    cm->upload_cost = cm->upload_cost ? cm->upload_cost * 0.9 + t * 0.1 : t;
+
+    best->state = CHUNK_READY;
+    cm->stats.bytes += best->bytes;
+    cm->stats.uploaded++;
+  }
+  cm->stats.upload_time = GetTime() - start;
+
+  // lru eviction, the ring itself is never evicted and neither are edited
+  // chunks, they would come back as generated
+  while (cm->stats.bytes > cm->cfg.memory_budget) {
+    int victim = -1;
+    for (int i = 0; i < cm->count; i++) {
+      Chunk *c = cm->chunks[i];
+      if (!c->has_data || c->state != CHUNK_READY || c->edited || ring_distance(c, cx, cz) <= cm->cfg.radius)
+        continue;
+      if (victim < 0 || c->last_used < cm->chunks[victim]->last_used)
+        victim = i;
+    }
+    if (victim < 0)
+      break;
+    chunk_remove(cm, victim);
+    cm->stats.evicted++;
+    removed = true;
+  }
+
+  if (removed)
+    table_rebuild(cm);
+
+  cm->stats.loaded = 0;
+  for (int i = 0; i < cm->count; i++)
+    cm->stats.loaded += cm->chunks[i]->has_data && cm->chunks[i]->state == CHUNK_READY;
+  cm->stats.pending = pending;
+}
+
+void chunks_wait(ChunkManager *cm, Vector3 position) {
+  double budget = cm->cfg.upload_budget;
+  cm->cfg.upload_budget = INFINITY;
+  for (;;) {
+    chunks_update(cm, position);
+    int cx = (int)floorf(position.x / cm->chunk_size);
+    int cz = (int)floorf(position.z / cm->chunk_size);
+    int r = cm->cfg.radius;
+    bool ready = true;
+    for (int z = cz - r; z <= cz + r && ready; z++) {
+      for (int x = cx - r; x <= cx + r && ready; x++) {
+        Chunk *c = chunks_find(cm, x, z);
+        ready = c && c->has_data && c->state == CHUNK_READY;
+      }
+    }
+    if (ready)
+      break;
+    usleep(1000);
+  }
+  cm->cfg.upload_budget = budget;
+}
+
+void chunks_draw(ChunkManager *cm, RenderQueue *queue, Material material, Vector3 eye, const Frustum *frustum) {
+  bool lod = cm->lod.cfg.levels;
+  if (lod)
+    cdlod_begin(&cm->lod);
+
+  int drawn = 0, culled = 0, triangles = 0;
+  for (int i = 0; i < cm->count; i++) {
+    const Chunk *c = cm->chunks[i];
+    if (!c->has_data || c->state != CHUNK_READY)
+      continue;
+    Vector3 origin = {c->cx * cm->chunk_size, 0, c->cz * cm->chunk_size};
+
+    FrustumResult result = FRUSTUM_INSIDE;
+    if (frustum) {
+      BoundingBox box = {{origin.x, c->min_height, origin.z},
+                         {origin.x + cm->chunk_size, c->max_height, origin.z + cm->chunk_size}};
+      result = frustum_test_box(frustum, box);
+    }
+    if (result == FRUSTUM_OUTSIDE) {
+      culled++;
+      continue;
+    }
+
+    if (lod) {
+      cdlod_select(&cm->lod, &c->lod, origin, eye, result == FRUSTUM_INSIDE ? NULL : frustum);
+    } else {
+      const TerrainIndices *indices = cm->rtin ? &c->indices : &cm->indices;
+      Matrix transform = MatrixTranslate(origin.x, origin.y, origin.z);
+      float half = cm->chunk_size / 2;
+      float depth = Vector2Distance((Vector2){origin.x + half, origin.z + half}, (Vector2){eye.x, eye.z});
+      if (cm->cfg.packed)
+        packed_mesh_draw(&c->packed, queue, material, transform, depth);
+      else
+        terrain_mesh_draw(&c->mesh, indices, queue, material, transform, depth);
+      triangles += indices->count / 3;
+      drawn++;
+    }
+  }
+
+  if (lod) {
+    cdlod_draw(&cm->lod, queue, material, eye);
+    cm->stats.nodes = cm->lod.stats.nodes;
+    cm->stats.triangles = cm->lod.stats.triangles;
+    culled += cm->lod.stats.culled;
+  } else {
+    cm->stats.nodes = drawn;
+    cm->stats.triangles = triangles;
+  }
+  cm->stats.culled = culled;
+}
+
+//---Editing---
+
+#define SCULPT_HEADROOM 0.1f // of max_height, kept above and below re-packed chunks
+
+static int floor_div(int a, int b) {
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static bool chunk_ready(const Chunk *c) {
+  return c && c->has_data && c->state == CHUNK_READY;
+}
+
+// global sample (gx, gz) is (gx * spacing, gz * spacing) in the world, chunk
+// (cx, cz) holds gx from cx * cells to (cx + 1) * cells
+static bool sample_height(const ChunkManager *cm, int gx, int gz, float *height) {
+  int cells = cm->cfg.cells, cx = floor_div(gx, cells), cz = floor_div(gz, cells);
+  // samples on an edge are in the chunks before it as well
+  for (int k = 0; k < 4; k++) {
+    int x = cx - (k & 1), z = cz - (k >> 1);
+    if ((x != cx && gx != cx * cells) || (z != cz && gz != cz * cells))
+      continue;
+    const Chunk *c = chunks_find(cm, x, z);
+    if (chunk_ready(c)) {
+      *height = heightfield_at(&c->hf, gx - x * cells, gz - z * cells);
+      return true;
+    }
+  }
+  return false;
+}
+
+// central differences across chunk borders so edited edges match, one sided
+// next to chunks that aren't loaded
+static Vector3 sample_normal(const ChunkManager *cm, int gx, int gz) {
+  float h, left, right, back, front;
+  sample_height(cm, gx, gz, &h);
+  bool has_left = sample_height(cm, gx - 1, gz, &left), has_right = sample_height(cm, gx + 1, gz, &right);
+  bool has_back = sample_height(cm, gx, gz - 1, &back), has_front = sample_height(cm, gx, gz + 1, &front);
+  int steps_x = has_left + has_right, steps_z = has_back + has_front;
+  float dx = steps_x ? ((has_right ? right : h) - (has_left ? left : h)) / (steps_x * cm->cfg.spacing) : 0;
+  float dz = steps_z ? ((has_front ? front : h) - (has_back ? back : h)) / (steps_z * cm->cfg.spacing) : 0;
+  return Vector3Normalize((Vector3){-dx, 1, -dz});
+}
+
+// local rect of the chunk, xyz per sample like heightfield_rect_normals
+static void chunk_normals(const ChunkManager *cm, const Chunk *c, HeightfieldRect rect, float *normals) {
+  int cells = cm->cfg.cells;
+  for (int z = rect.z0; z <= rect.z1; z++) {
+    for (int x = rect.x0; x <= rect.x1; x++) {
+      Vector3 n = sample_normal(cm, c->cx * cells + x, c->cz * cells + z);
+      *normals++ = n.x;
+      *normals++ = n.y;
+      *normals++ = n.z;
+    }
+  }
+}
+
+// for edits the partial updates can't follow: the adaptive mesh changes shape
+// and packed heights can leave their range. still the chunk's size, not the
+// world's
+static void chunk_rebuild(ChunkManager *cm, Chunk *c) {
+  const ChunkConfig *cfg = &cm->cfg;
+  int n = c->hf.width;
+  float *normals = RL_MALLOC((size_t)n * n * 3 * sizeof(float));
+  chunk_normals(cm, c, (HeightfieldRect){0, 0, n - 1, n - 1}, normals);
+
+  cm->stats.bytes -= c->bytes;
+  c->bytes = (size_t)n * n * sizeof(float) + height_pyramid_bytes(&c->pyramid);
+  TerrainMesh mesh;
+  TerrainIndices *indices = &cm->indices;
+  if (cm->rtin) {
+    rtin_unload(&c->rtin);
+    terrain_indices_unload(&c->indices);
+    rtin_init(&c->rtin, &c->hf);
+    mesh = rtin_build_mesh(&c->rtin, &c->hf, normals, cfg->rtin_error, cfg->rtin_error * 2, &c->indices);
+    indices = &c->indices;
+    c->bytes += (size_t)n * n * sizeof(float) + (size_t)indices->count * sizeof(unsigned int);
+    if (!cfg->headless)
+      terrain_indices_upload(indices);
+  } else {
+    mesh = terrain_mesh_build(&c->hf);
+    memcpy(mesh.normals, normals, (size_t)n * n * 3 * sizeof(float));
+  }
+  RL_FREE(normals);
+
+  if (cfg->packed) {
+    packed_mesh_unload(&c->packed);
+    c->packed = packed_mesh_from_terrain(&mesh, &c->hf, cm->rtin ? 0 : cfg->max_height * SCULPT_HEADROOM);
+    terrain_mesh_free_cpu(&mesh);
+    if (!cfg->headless)
+      packed_mesh_upload(&c->packed, indices);
+    c->bytes += packed_mesh_bytes(&c->packed);
+  } else {
+    terrain_mesh_unload(&c->mesh);
+    c->mesh = mesh;
+    if (!cfg->headless)
+      terrain_mesh_upload(&c->mesh, indices);
+    terrain_mesh_free_cpu(&c->mesh);
+    c->bytes += (size_t)c->mesh.vertex_count * 8 * sizeof(float);
+  }
+  cm->stats.bytes += c->bytes;
+}
+
+// rect of global samples to the chunk's local one, false if they don't meet
+static bool chunk_rect(const ChunkManager *cm, const Chunk *c, HeightfieldRect rect, HeightfieldRect *local) {
+  int cells = cm->cfg.cells, x = c->cx * cells, z = c->cz * cells;
+  *local = (HeightfieldRect){
+      rect.x0 > x ? rect.x0 - x : 0,
+      rect.z0 > z ? rect.z0 - z : 0,
+      rect.x1 < x + cells ? rect.x1 - x : cells,
+      rect.z1 < z + cells ? rect.z1 - z : cells,
+  };
+  return local->x0 <= local->x1 && local->z0 <= local->z1;
+}
+
+bool chunks_sculpt(ChunkManager *cm, const SculptBrush *brush, Vector3 center, float dt) {
+  int cells = cm->cfg.cells;
+  float s = cm->cfg.spacing;
+  HeightfieldRect r = {
+      (int)ceilf((center.x - brush->radius) / s),
+      (int)ceilf((center.z - brush->radius) / s),
+      (int)floorf((center.x + brush->radius) / s),
+      (int)floorf((center.z + brush->radius) / s),
+  };
+  if (r.x0 > r.x1 || r.z0 > r.z1)
+    return false;
+
+  // every chunk with a sample under the brush has to be loaded, a missing one
+  // would keep the old heights on its side of a shared edge
+  for (int cz = floor_div(r.z0 - 1, cells); cz <= floor_div(r.z1, cells); cz++) {
+    for (int cx = floor_div(r.x0 - 1, cells); cx <= floor_div(r.x1, cells); cx++) {
+      if (!chunk_ready(chunks_find(cm, cx, cz)))
+        return false;
+    }
+  }
+
+  // new heights first, smoothing has to see the old neighbours
+  int w = heightfield_rect_width(r);
+  float *next = RL_MALLOC((size_t)w * heightfield_rect_length(r) * sizeof(float));
+  for (int gz = r.z0; gz <= r.z1; gz++) {
+    for (int gx = r.x0; gx <= r.x1; gx++) {
+      float h, average = 0, neighbour;
+      sample_height(cm, gx, gz, &h);
+      int offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+      for (int k = 0; k < 4; k++)
+        average += (sample_height(cm, gx + offsets[k][0], gz + offsets[k][1], &neighbour) ? neighbour : h) * 0.25f;
+      float weight = sculpt_falloff(brush, Vector2Distance((Vector2){gx * s, gz * s}, (Vector2){center.x, center.z}));
+      next[(gz - r.z0) * w + gx - r.x0] = sculpt_sample(brush, h, average, weight, dt);
+    }
+  }
+  for (int cz = floor_div(r.z0 - 1, cells); cz <= floor_div(r.z1, cells); cz++) {
+    for (int cx = floor_div(r.x0 - 1, cells); cx <= floor_div(r.x1, cells); cx++) {
+      Chunk *c = chunks_find(cm, cx, cz);
+      HeightfieldRect local;
+      if (!chunk_rect(cm, c, r, &local))
+        continue;
+      for (int z = local.z0; z <= local.z1; z++) {
+        const float *row = &next[(cz * cells + z - r.z0) * w + cx * cells + local.x0 - r.x0];
+        memcpy(&c->hf.heights[z * c->hf.width + local.x0], row, heightfield_rect_width(local) * sizeof(float));
+      }
+    }
+  }
+  RL_FREE(next);
+
+  // normals reach one sample further, in whichever chunks are there
+  HeightfieldRect dirty = {r.x0 - 1, r.z0 - 1, r.x1 + 1, r.z1 + 1};
+  for (int cz = floor_div(dirty.z0 - 1, cells); cz <= floor_div(dirty.z1, cells); cz++) {
+    for (int cx = floor_div(dirty.x0 - 1, cells); cx <= floor_div(dirty.x1, cells); cx++) {
+      Chunk *c = chunks_find(cm, cx, cz);
+      HeightfieldRect local;
+      if (!chunk_ready(c) || !chunk_rect(cm, c, dirty, &local))
+        continue;
+      c->edited = true;
+      for (int z = local.z0; z <= local.z1; z++) {
+        for (int x = local.x0; x <= local.x1; x++) {
+          c->min_height = fminf(c->min_height, heightfield_at(&c->hf, x, z));
+          c->max_height = fmaxf(c->max_height, heightfield_at(&c->hf, x, z));
+        }
+      }
+      height_pyramid_update(&c->pyramid, &c->hf, local);
+
+      if (cm->rtin) {
+        chunk_rebuild(cm, c);
+        continue;
+      }
+      float *normals = RL_MALLOC((size_t)heightfield_rect_width(local) * heightfield_rect_length(local) * 3 *
+                                 sizeof(float));
+      chunk_normals(cm, c, local, normals);
+      if (cm->lod.cfg.levels)
+        cdlod_chunk_update(&cm->lod, &c->lod, &c->hf, local, normals);
+      else if (!cm->cfg.packed)
+        terrain_mesh_update(&c->mesh, &c->hf, local, normals);
+      else if (!packed_mesh_update(&c->packed, &c->hf, local, normals))
+        chunk_rebuild(cm, c);
+      RL_FREE(normals);
+    }
+  }
+  return true;
+}
+
+//---Queries---
+
+// chunk and local position for world (x, z), NULL if not on the cpu yet
+static const Chunk *chunk_at(const ChunkManager *cm, float x, float z, float *lx, float *lz) {
+  int cx = (int)floorf(x / cm->chunk_size);
+  int cz = (int)floorf(z / cm->chunk_size);
+  const Chunk *c = chunks_find(cm, cx, cz);
+  if (!c || !c->has_data)
+    return NULL;
+
+  // keep rounding at the far edge inside the last cell
+  float edge = cm->chunk_size * 0.99999f;
+  *lx = Clamp(x - cx * cm->chunk_size, 0, edge);
+  *lz = Clamp(z - cz * cm->chunk_size, 0, edge);
+  return c;
+}
+
+bool chunks_height(const ChunkManager *cm, float x, float z, float *height) {
+  float lx, lz;
+  const Chunk *c = chunk_at(cm, x, z, &lx, &lz);
+  if (!c)
+    return false;
+  if (cm->rtin)
+    return rtin_height(&c->rtin, &c->hf, cm->cfg.rtin_error, lx, lz, height, NULL);
+  return heightfield_height(&c->hf, lx, lz, height, NULL);
+}
+
+#define SAMPLE_RUN 64 // positions handed to heightfield_sample at once
+
+int chunks_sample(const ChunkManager *cm, const float *xs, const float *zs, int count, float *heights,
+                  Vector3 *normals, bool *inside) {
+  float lx[SAMPLE_RUN], lz[SAMPLE_RUN];
+  float size = cm->chunk_size, edge = size * 0.99999f;
+  int found = 0;
+  for (int i = 0; i < count;) {
+    // runs of positions in one chunk go through the vectorized path,
+    // entities close together mostly share one
+    float cx = floorf(xs[i] / size), cz = floorf(zs[i] / size);
+    int run = 0;
+    do {
+      lx[run] = Clamp(xs[i + run] - cx * size, 0, edge);
+      lz[run] = Clamp(zs[i + run] - cz * size, 0, edge);
+      run++;
+    } while (i + run < count && run < SAMPLE_RUN && floorf(xs[i + run] / size) == cx &&
+             floorf(zs[i + run] / size) == cz);
+
+    const Chunk *c = chunks_find(cm, (int)cx, (int)cz);
+    if (c && c->has_data && !cm->rtin) {
+      found += heightfield_sample(&c->hf, lx, lz, run, &heights[i], normals ? &normals[i] : NULL,
+                                  inside ? &inside[i] : NULL);
+    } else {
+      for (int k = 0; k < run; k++) {
+        Vector3 normal = {0, 1, 0};
+        bool in = c && c->has_data &&
+                  rtin_height(&c->rtin, &c->hf, cm->cfg.rtin_error, lx[k], lz[k], &heights[i + k], &normal);
+        if (!in)
+          heights[i + k] = 0;
+        if (normals)
+          normals[i + k] = normal;
+        if (inside)
+          inside[i + k] = in;
+        found += in;
+      }
+    }
+    i += run;
+  }
+  return found;
+}
+
+// chunk coordinates x0, z0, x1, z1 around every chunk with data
+static void loaded_area(const ChunkManager *cm, int area[4]) {
+  area[0] = area[1] = INT_MAX;
+  area[2] = area[3] = INT_MIN;
+  for (int i = 0; i < cm->count; i++) {
+    const Chunk *c = cm->chunks[i];
+    if (!c->has_data)
+      continue;
+    area[0] = c->cx < area[0] ? c->cx : area[0];
+    area[1] = c->cz < area[1] ? c->cz : area[1];
+    area[2] = c->cx > area[2] ? c->cx : area[2];
+    area[3] = c->cz > area[3] ? c->cz : area[3];
+  }
+}
+
+// the chunks under the ray front to back (a dda over the chunk grid), the
+// first one with a hit has the nearest. stops once the ray has left area
+static bool ray_chunks(const ChunkManager *cm, const int area[4], Ray ray, float max_distance,
+                       RayCollision *hit) {
+  *hit = (RayCollision){0};
+  float length = Vector3Length(ray.direction), size = cm->chunk_size;
+  if (!(length > 0))
+    return false;
+  Vector3 dir = Vector3Scale(ray.direction, 1 / length);
+  int cx = (int)floorf(ray.position.x / size), cz = (int)floorf(ray.position.z / size);
+  int step_x = dir.x > 0 ? 1 : -1, step_z = dir.z > 0 ? 1 : -1;
+  float next_x = dir.x != 0 ? ((cx + (dir.x > 0)) * size - ray.position.x) / dir.x : INFINITY;
+  float next_z = dir.z != 0 ? ((cz + (dir.z > 0)) * size - ray.position.z) / dir.z : INFINITY;
+  float delta_x = size / fabsf(dir.x), delta_z = size / fabsf(dir.z);
+
+  for (float t = 0; t <= max_distance;) {
+    if ((step_x > 0 ? cx > area[2] : cx < area[0]) || (step_z > 0 ? cz > area[3] : cz < area[1]))
+      return false;
+    const Chunk *c = chunks_find(cm, cx, cz);
+    if (c && c->has_data) {
+      Vector3 origin = {cx * size, 0, cz * size};
+      Ray local = {Vector3Subtract(ray.position, origin), dir};
+      if (height_pyramid_raycast(&c->pyramid, &c->hf, local, max_distance, hit)) {
+        hit->point = Vector3Add(hit->point, origin);
+        return true;
+      }
+    }
+    if (next_x < next_z) {
+      t = next_x;
+      next_x += delta_x;
+      cx += step_x;
+    } else {
+      t = next_z;
+      next_z += delta_z;
+      cz += step_z;
+    }
+  }
+  return false;
+}
+
+bool chunks_raycast(const ChunkManager *cm, Ray ray, float max_distance, Vector3 *collision) {
+  RayCollision hit;
+  int area[4];
+  loaded_area(cm, area);
+  bool found = ray_chunks(cm, area, ray, max_distance, &hit);
+  *collision = hit.point;
+  return found;
+}
+
+int chunks_raycast_batch(const ChunkManager *cm, const Ray *rays, const float *max_distances, int count,
+                         RayCollision *hits) {
+  int area[4], found = 0;
+  loaded_area(cm, area);
+  for (int i = 0; i < count; i++)
+    found += ray_chunks(cm, area, rays[i], max_distances ? max_distances[i] : INFINITY, &hits[i]);
+  return found;
+}
@@ -0,0 +1,159 @@
+#ifndef CHUNKS_H
+#define CHUNKS_H
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stddef.h>
+
+#include "cache.h"
+#include "cdlod.h"
+#include "frustum.h"
+#include "height_pyramid.h"
+#include "heightfield.h"
+#include "packed_mesh.h"
+#include "render_queue.h"
+#include "rtin.h"
+#include "sculpt.h"
+#include "terrain_mesh.h"
+
+// infinite terrain as square heightfield chunks streamed in around the player.
+// chunks are generated and meshed on worker threads, uploaded on the main
+// thread within a per frame time budget and evicted least recently used
+// first once over the memory budget.
+
+typedef enum ChunkState {
+  CHUNK_QUEUED,     // waiting for a worker
+  CHUNK_GENERATING, // owned by a worker
+  CHUNK_GENERATED,  // heightfield + cpu mesh done, waiting for upload
+  CHUNK_READY,      // on the gpu
+  CHUNK_CANCELLED,  // left the ring before a worker got to it
+} ChunkState;
+
+typedef struct Chunk {
+  int cx, cz;
+  ChunkState state; // shared with the workers, under the lock
+  bool cancel;
+  // main thread only, snapshot of state taken under the lock each update.
+  // once has_data is set the workers are done with the chunk
+  bool has_data;
+  bool dead;
+  Heightfield hf;
+  float min_height, max_height; // bounds for culling
+  TerrainMesh mesh; // not uploaded when drawn with lod, only its normals are
+  CdlodChunk lod;
+  Rtin rtin;              // adaptive meshes only
+  TerrainIndices indices; // the adaptive mesh's own, the others share one
+  PackedMesh packed;      // replaces mesh on the gpu when packing
+  HeightPyramid pyramid;  // raycasts
+  CacheTile tile; // mesh arrays point in here when loaded from the cache
+  long last_used; // frame it was last inside the ring
+  bool edited;    // sculpted, never evicted
+  size_t bytes;
+} Chunk;
+
+typedef struct ChunkConfig {
+  int cells;        // cells per chunk side, chunks share their edge samples
+  float spacing;    // world distance between samples
+  float max_height;
+  // noise, same meaning as perlin_heightfield but the scale is per sample so
+  // neighbouring chunks line up
+  int seed_x, seed_z;
+  float noise_step;
+  float lacunarity;
+  float gain;
+  int octaves;
+
+  int radius;            // chunks kept loaded in each direction of the player
+  size_t memory_budget;  // bytes of chunk data (cpu + gpu) before eviction
+  int threads;           // generation workers, <= 0 for one per cpu minus one
+  double upload_budget;  // seconds per frame spent uploading chunks
+  const char *cache_dir; // on-disk tile cache, NULL to always generate
+  CdlodConfig lod;       // levels 0 draws every chunk at full resolution
+  // with lod off and > 0 chunks are adaptive meshes (rtin) within this many
+  // world units of every sample instead, cells has to be a power of two
+  float rtin_error;
+  // meshes without lod go to the gpu as 8 byte PackedVertex instead of 32
+  // bytes of floats, the shader has to be packed.vert
+  bool packed;
+  // nothing goes to the gpu and chunks_draw can't be used, for running the
+  // game without a window. queries and sculpting work the same
+  bool headless;
+} ChunkConfig;
+
+typedef struct ChunkStats {
+  int loaded;   // on the gpu
+  int pending;  // queued or being generated
+  int uploaded; // this frame
+  int evicted;  // total
+  size_t bytes;
+  double upload_time; // this frame
+  int nodes;          // drawn last frame, chunks or lod nodes
+  int triangles;      // submitted last frame
+  int culled;         // chunks and lod nodes outside the frustum last frame
+} ChunkStats;
+
+typedef struct ChunkManager {
+  ChunkConfig cfg;
+  float chunk_size; // world size of a chunk
+
+  Chunk **chunks;
+  int count, capacity;
+  Chunk **table; // open addressing on (cx, cz)
+  int table_size;
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  Chunk **queue;
+  int queue_head, queue_count, queue_capacity;
+  pthread_t *workers;
+  int worker_count;
+  bool quit;
+
+  TerrainIndices indices; // shared by every full resolution chunk mesh
+  Cdlod lod;
+  bool rtin;
+
+  long frame;
+  double upload_cost; // running average seconds per upload
+  ChunkStats stats;
+} ChunkManager;
+
+void chunks_init(ChunkManager *cm, ChunkConfig cfg);
+void chunks_unload(ChunkManager *cm);
+
+// request the ring around position, upload finished chunks and evict
+void chunks_update(ChunkManager *cm, Vector3 position);
+// block until the ring around position is on the gpu, for startup
+void chunks_wait(ChunkManager *cm, Vector3 position);
+// queues the visible terrain. eye is the camera position the lod is picked
+// for, chunks and lod nodes outside the frustum are skipped (NULL draws
+// everything). with lod on the material shader has to be cdlod.vert, packed
+// meshes need packed.vert
+void chunks_draw(ChunkManager *cm, RenderQueue *queue, Material material, Vector3 eye, const Frustum *frustum);
+
+Chunk *chunks_find(const ChunkManager *cm, int cx, int cz);
+// surface height at world (x, z), false if that chunk isn't loaded. follows
+// the adaptive mesh when there is one so things stand on what is drawn
+bool chunks_height(const ChunkManager *cm, float x, float z, float *height);
+// chunks_height with normals for count world positions (xs[i], zs[i]), see
+// heightfield_sample. inside[i] is false where the chunk isn't loaded,
+// normals and inside may be NULL. returns how many were found
+int chunks_sample(const ChunkManager *cm, const float *xs, const float *zs, int count, float *heights,
+                  Vector3 *normals, bool *inside);
+// first hit on the full resolution surface, chunk by chunk along the ray
+// through their height pyramids. chunks that aren't loaded are passed over.
+// lod and adaptive meshes are drawn within their error of that surface
+bool chunks_raycast(const ChunkManager *cm, Ray ray, float max_distance, Vector3 *collision);
+// count rays at once, e.g. line of sight checks with max_distances[i] the
+// distance to the target (NULL for no limit). returns how many hit
+int chunks_raycast_batch(const ChunkManager *cm, const Ray *rays, const float *max_distances, int count,
+                         RayCollision *hits);
+
+// one stroke of dt seconds centred on world position center (its y is
+// ignored). heights change in every chunk sharing the samples, then only the
+// touched rect of each chunk is re-uploaded (adaptive chunks and packed
+// chunks whose heights left their range are rebuilt whole). false, and
+// nothing changed, unless every chunk under the brush is loaded
+bool chunks_sculpt(ChunkManager *cm, const SculptBrush *brush, Vector3 center, float dt);
+
+#endif
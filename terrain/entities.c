@@ -0,0 +1,344 @@
+#include "entities.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input.h"
+#include "parallel.h"
+#include "player.h"
+
+#define ENTITY_BATCH 4096 // entities per parallel_for item range
+#define ENTITY_RUN 256    // ground heights sampled at once
+#define FLOOR_EPSILON 1   // standing this far over the ground still counts, like the player
+#define TIP_RADIUS 0.1f   // of the spheres at the bottom and top
+#define SORT_TICKS 64     // ticks between regrouping entities by chunk
+
+static float minf(float a, float b) { return a < b ? a : b; }
+static float maxf(float a, float b) { return a > b ? a : b; }
+
+//---Storage---
+
+static void grow(Entities *e, int capacity) {
+  float **fields[] = {&e->x, &e->y, &e->z, &e->vx, &e->vy, &e->vz, &e->radius, &e->jump};
+  for (int f = 0; f < (int)(sizeof(fields) / sizeof(fields[0])); f++)
+    *fields[f] = RL_REALLOC(*fields[f], capacity * sizeof(float));
+  e->flags = RL_REALLOC(e->flags, capacity);
+  e->capacity = capacity;
+}
+
+void entities_init(Entities *entities, int capacity, int threads) {
+  *entities = (Entities){.threads = threads};
+  grow(entities, capacity > 0 ? capacity : 64);
+}
+
+void entities_unload(Entities *entities) {
+  float *fields[] = {entities->x,  entities->y,  entities->z,      entities->vx,
+                     entities->vy, entities->vz, entities->radius, entities->jump};
+  for (int f = 0; f < (int)(sizeof(fields) / sizeof(fields[0])); f++)
+    RL_FREE(fields[f]);
+  RL_FREE(entities->flags);
+  *entities = (Entities){0};
+}
+
+int entities_add(Entities *entities, Vector3 position, Vector3 velocity, float radius, float jump, uint8_t flags) {
+  Entities *e = entities;
+  if (e->count == e->capacity)
+    grow(e, e->capacity * 2);
+  int i = e->count++;
+  e->x[i] = position.x;
+  e->y[i] = position.y;
+  e->z[i] = position.z;
+  e->vx[i] = velocity.x;
+  e->vy[i] = velocity.y;
+  e->vz[i] = velocity.z;
+  e->radius[i] = radius;
+  e->jump[i] = jump;
+  e->flags[i] = flags & ENTITY_JUMPS;
+  return i;
+}
+
+void entities_remove(Entities *entities, int index) {
+  Entities *e = entities;
+  int last = --e->count;
+  e->x[index] = e->x[last];
+  e->y[index] = e->y[last];
+  e->z[index] = e->z[last];
+  e->vx[index] = e->vx[last];
+  e->vy[index] = e->vy[last];
+  e->vz[index] = e->vz[last];
+  e->radius[index] = e->radius[last];
+  e->jump[index] = e->jump[last];
+  e->flags[index] = e->flags[last];
+}
+
+// stable by chunk then index, so the order only depends on the positions
+static int compare_keys(const void *a, const void *b) {
+  uint64_t ka = *(const uint64_t *)a, kb = *(const uint64_t *)b;
+  return (ka > kb) - (ka < kb);
+}
+
+void entities_sort(Entities *entities, float cell) {
+  Entities *e = entities;
+  if (e->count < 2)
+    return;
+  uint64_t *keys = RL_MALLOC(e->count * sizeof(uint64_t));
+  for (int i = 0; i < e->count; i++) {
+    // wraps around far from the origin, that only costs a little grouping
+    uint32_t cx = (uint16_t)(int)floorf(e->x[i] / cell), cz = (uint16_t)(int)floorf(e->z[i] / cell);
+    keys[i] = (uint64_t)(cz << 16 | cx) << 32 | (uint32_t)i;
+  }
+  qsort(keys, e->count, sizeof(uint64_t), compare_keys);
+
+  float *scratch = RL_MALLOC(e->count * sizeof(float));
+  float *fields[] = {e->x, e->y, e->z, e->vx, e->vy, e->vz, e->radius, e->jump};
+  for (int f = 0; f < (int)(sizeof(fields) / sizeof(fields[0])); f++) {
+    for (int i = 0; i < e->count; i++)
+      scratch[i] = fields[f][(uint32_t)keys[i]];
+    memcpy(fields[f], scratch, e->count * sizeof(float));
+  }
+  uint8_t *flags = (uint8_t *)scratch;
+  for (int i = 0; i < e->count; i++)
+    flags[i] = e->flags[(uint32_t)keys[i]];
+  memcpy(e->flags, flags, e->count);
+  RL_FREE(scratch);
+  RL_FREE(keys);
+}
+
+//---Queries---
+
+// heap[0] is the farthest kept entity, a child is never farther than its parent
+static void sift_down(int *heap, float *d2, int n, int k) {
+  int i = heap[k];
+  float d = d2[k];
+  for (;;) {
+    int far = 2 * k + 1;
+    if (far >= n)
+      break;
+    if (far + 1 < n && d2[far + 1] > d2[far])
+      far++;
+    if (d2[far] <= d)
+      break;
+    heap[k] = heap[far];
+    d2[k] = d2[far];
+    k = far;
+  }
+  heap[k] = i;
+  d2[k] = d;
+}
+
+int entities_nearest(const Entities *entities, Vector3 point, float range, int max, int *nearest, float *distances) {
+  const Entities *e = entities;
+  if (max <= 0)
+    return 0;
+  // a max heap of the kept ones, anything farther than its top is out
+  int n = 0;
+  float limit = range * range;
+  for (int i = 0; i < e->count; i++) {
+    float dx = e->x[i] - point.x, dy = e->y[i] - point.y, dz = e->z[i] - point.z;
+    float d2 = dx * dx + dy * dy + dz * dz;
+    if (d2 > limit)
+      continue;
+    if (n < max) {
+      int k = n++;
+      while (k > 0 && distances[(k - 1) / 2] < d2) {
+        nearest[k] = nearest[(k - 1) / 2];
+        distances[k] = distances[(k - 1) / 2];
+        k = (k - 1) / 2;
+      }
+      nearest[k] = i;
+      distances[k] = d2;
+    } else {
+      nearest[0] = i;
+      distances[0] = d2;
+      sift_down(nearest, distances, n, 0);
+    }
+    if (n == max)
+      limit = distances[0];
+  }
+  return n;
+}
+
+//---Blocks---
+
+// squared distance from a point to a voxel's box
+static float voxel_distance2(float s, int vx, int vy, int vz, float x, float y, float z) {
+  float dx = maxf(maxf(vx * s - x, x - (vx + 1) * s), 0);
+  float dy = maxf(maxf(vy * s - y, y - (vy + 1) * s), 0);
+  float dz = maxf(maxf(vz * s - z, z - (vz + 1) * s), 0);
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// a solid voxel touching the sphere at (x, y, z), and with from set, one that
+// doesn't touch the same sphere at from as well (walking into a block)
+static bool sphere_hits(const VoxelWorld *world, float x, float y, float z, float r, const float *from) {
+  float s = world->voxel_size;
+  int x0 = (int)floorf((x - r) / s), x1 = (int)floorf((x + r) / s);
+  int y0 = (int)floorf((y - r) / s), y1 = (int)floorf((y + r) / s);
+  int z0 = (int)floorf((z - r) / s), z1 = (int)floorf((z + r) / s);
+  for (int vy = y0; vy <= y1; vy++) {
+    for (int vz = z0; vz <= z1; vz++) {
+      for (int vx = x0; vx <= x1; vx++) {
+        if (voxel_distance2(s, vx, vy, vz, x, y, z) > r * r || voxels_get(world, vx, vy, vz) == VOXEL_EMPTY)
+          continue;
+        if (!from || voxel_distance2(s, vx, vy, vz, from[0], from[1], from[2]) > r * r)
+          return true;
+      }
+    }
+  }
+  return false;
+}
+
+// blocks_collide for one entity: stops the walk (nx, nz back to x, z) and
+// sets the floor flag
+static void collide_blocks(const VoxelWorld *world, Entities *e, int i, float dt, float *nx, float *nz) {
+  float x = e->x[i], y = e->y[i], z = e->z[i], r = e->radius[i];
+  // blocks are sparse, most entities near them still have no voxel chunk
+  // under their reach and skip the voxel by voxel tests
+  float reach = r + fabsf(e->vy[i] * dt) + TIP_RADIUS, chunk_size = VOXEL_CHUNK * world->voxel_size;
+  int lo[3] = {(int)floorf((minf(x, *nx) - reach) / chunk_size), (int)floorf((y - reach) / chunk_size),
+               (int)floorf((minf(z, *nz) - reach) / chunk_size)};
+  int hi[3] = {(int)floorf((maxf(x, *nx) + reach) / chunk_size), (int)floorf((y + reach) / chunk_size),
+               (int)floorf((maxf(z, *nz) + reach) / chunk_size)};
+  bool near = false;
+  for (int cy = lo[1]; cy <= hi[1] && !near; cy++)
+    for (int cz = lo[2]; cz <= hi[2] && !near; cz++)
+      for (int cx = lo[0]; cx <= hi[0] && !near; cx++)
+        near = voxels_chunk(world, cx, cy, cz) != NULL;
+  if (!near)
+    return;
+
+  if (sphere_hits(world, x, y - r + e->vy[i] * dt, z, TIP_RADIUS, NULL) ||
+      sphere_hits(world, x, y + r, z, TIP_RADIUS, NULL))
+    e->flags[i] |= ENTITY_ON_FLOOR;
+  float from[3] = {x, y, z};
+  if ((*nx != x || *nz != z) && sphere_hits(world, *nx, y, *nz, r, from)) {
+    e->flags[i] |= ENTITY_BLOCKED;
+    *nx = x;
+    *nz = z;
+  }
+}
+
+//---Tick---
+
+typedef struct TickJob {
+  Entities *entities;
+  const ChunkManager *chunks;
+  const VoxelWorld *voxels;
+  float dt;
+  float lo[3], hi[3]; // around every block
+  int awake;
+} TickJob;
+
+// the player's vertical rules for one entity over ground, frozen when the
+// ground isn't loaded
+static void fall(Entities *e, int i, float nx, float nz, float ground, bool inside, float dt) {
+  if (!inside)
+    return;
+  float y = e->y[i], r = e->radius[i];
+  bool floor = (e->flags[i] & ENTITY_ON_FLOOR) || y - r - FLOOR_EPSILON <= ground;
+  float vy = floor ? (e->flags[i] & ENTITY_JUMPS ? e->jump[i] : 0) : e->vy[i] - GRAVITY * dt;
+  e->x[i] = nx;
+  e->z[i] = nz;
+  e->y[i] = maxf(y, ground + r) + vy * dt;
+  e->vy[i] = vy;
+  e->flags[i] |= floor ? ENTITY_ON_FLOOR : 0;
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+static __m128 flag_mask(const uint8_t *flags, int bit) {
+  return _mm_castsi128_ps(
+      _mm_set_epi32(-!!(flags[3] & bit), -!!(flags[2] & bit), -!!(flags[1] & bit), -!!(flags[0] & bit)));
+}
+
+static __m128 select_ps(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// fall four at a time, same operations in the same order so the lanes match
+// the scalar rule bit for bit
+static void fall_run(Entities *e, int begin, int n, const float *nx, const float *nz, const float *ground,
+                     const bool *inside, float dt) {
+  int k = 0;
+  __m128 step = _mm_set1_ps(dt), gravity = _mm_set1_ps(GRAVITY * dt), epsilon = _mm_set1_ps(FLOOR_EPSILON);
+  for (; k + 4 <= n; k += 4) {
+    int i = begin + k;
+    __m128 in = _mm_castsi128_ps(_mm_set_epi32(-inside[k + 3], -inside[k + 2], -inside[k + 1], -inside[k]));
+    __m128 y = _mm_loadu_ps(&e->y[i]), r = _mm_loadu_ps(&e->radius[i]), vy = _mm_loadu_ps(&e->vy[i]);
+    __m128 g = _mm_loadu_ps(&ground[k]);
+    __m128 floor = _mm_or_ps(flag_mask(&e->flags[i], ENTITY_ON_FLOOR),
+                             _mm_cmple_ps(_mm_sub_ps(_mm_sub_ps(y, r), epsilon), g));
+    __m128 jump = _mm_and_ps(flag_mask(&e->flags[i], ENTITY_JUMPS), _mm_loadu_ps(&e->jump[i]));
+    __m128 next_vy = select_ps(floor, jump, _mm_sub_ps(vy, gravity));
+    __m128 next_y = _mm_add_ps(_mm_max_ps(y, _mm_add_ps(g, r)), _mm_mul_ps(next_vy, step));
+    _mm_storeu_ps(&e->y[i], select_ps(in, next_y, y));
+    _mm_storeu_ps(&e->vy[i], select_ps(in, next_vy, vy));
+    _mm_storeu_ps(&e->x[i], select_ps(in, _mm_loadu_ps(&nx[k]), _mm_loadu_ps(&e->x[i])));
+    _mm_storeu_ps(&e->z[i], select_ps(in, _mm_loadu_ps(&nz[k]), _mm_loadu_ps(&e->z[i])));
+    int landed = _mm_movemask_ps(_mm_and_ps(in, floor));
+    for (int l = 0; l < 4; l++)
+      e->flags[i + l] |= landed >> l & 1 ? ENTITY_ON_FLOOR : 0;
+  }
+  for (; k < n; k++)
+    fall(e, begin + k, nx[k], nz[k], ground[k], inside[k], dt);
+}
+#else
+static void fall_run(Entities *e, int begin, int n, const float *nx, const float *nz, const float *ground,
+                     const bool *inside, float dt) {
+  for (int k = 0; k < n; k++)
+    fall(e, begin + k, nx[k], nz[k], ground[k], inside[k], dt);
+}
+#endif
+
+static void tick_batch(void *user, int begin, int end) {
+  TickJob *job = user;
+  Entities *e = job->entities;
+  float dt = job->dt;
+  float nx[ENTITY_RUN], nz[ENTITY_RUN], ground[ENTITY_RUN];
+  bool inside[ENTITY_RUN];
+  int awake = 0;
+  for (int run = begin; run < end; run += ENTITY_RUN) {
+    int n = end - run < ENTITY_RUN ? end - run : ENTITY_RUN;
+    const float *x = &e->x[run], *z = &e->z[run], *vx = &e->vx[run], *vz = &e->vz[run];
+    for (int k = 0; k < n; k++) {
+      nx[k] = x[k] + vx[k] * dt;
+      nz[k] = z[k] + vz[k] * dt;
+      e->flags[run + k] &= ENTITY_JUMPS;
+    }
+
+    // only the entities whose reach meets the box around the blocks look
+    // at voxels, so open ground costs nothing
+    if (job->voxels->blocks) {
+      for (int k = 0; k < n; k++) {
+        int i = run + k;
+        float reach = e->radius[i] + fabsf(e->vy[i] * dt) + TIP_RADIUS;
+        if (minf(x[k], nx[k]) - reach > job->hi[0] || maxf(x[k], nx[k]) + reach < job->lo[0] ||
+            e->y[i] - reach > job->hi[1] || e->y[i] + reach < job->lo[1] ||
+            minf(z[k], nz[k]) - reach > job->hi[2] || maxf(z[k], nz[k]) + reach < job->lo[2])
+          continue;
+        collide_blocks(job->voxels, e, i, dt, &nx[k], &nz[k]);
+      }
+    }
+
+    awake += chunks_sample(job->chunks, nx, nz, n, ground, NULL, inside);
+    fall_run(e, run, n, nx, nz, ground, inside, dt);
+  }
+  __atomic_fetch_add(&job->awake, awake, __ATOMIC_RELAXED);
+}
+
+void entities_tick(Entities *entities, const ChunkManager *chunks, const VoxelWorld *voxels, float dt) {
+  double start = input_clock();
+  if (entities->ticks++ % SORT_TICKS == 0)
+    entities_sort(entities, chunks->chunk_size);
+  TickJob job = {entities, chunks, voxels, dt, {0}, {0}, 0};
+  float chunk_size = VOXEL_CHUNK * voxels->voxel_size;
+  for (int a = 0; a < 3; a++) {
+    job.lo[a] = voxels->min[a] * chunk_size;
+    job.hi[a] = (voxels->max[a] + 1) * chunk_size;
+  }
+  parallel_for(entities->count, ENTITY_BATCH, entities->threads, tick_batch, &job);
+  entities->awake = job.awake;
+  entities->tick_time = input_clock() - start;
+}
@@ -0,0 +1,57 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <raylib.h>
+#include <stdint.h>
+
+#include "chunks.h"
+#include "voxels.h"
+
+// lots of simple moving things, npcs and physics props, kept as one array
+// per field. a tick runs the player's rules (gravity, jumping, standing on
+// terrain and blocks, being stopped by blocks) for every entity, in batches
+// spread over every cpu, with the ground heights sampled a run at a time.
+// entities are spheres, the player's feet and head checks happen at the
+// bottom and top of the sphere.
+
+enum {
+  ENTITY_JUMPS = 1 << 0,    // jumps again whenever it lands
+  ENTITY_ON_FLOOR = 1 << 1, // set by the tick
+  ENTITY_BLOCKED = 1 << 2,  // set by the tick, its last move ran into a block
+};
+
+typedef struct Entities {
+  int count, capacity;
+  float *x, *y, *z;    // centre
+  float *vx, *vy, *vz; // world units per second, vx and vz are walking
+  float *radius;
+  float *jump; // vy a jump starts with
+  uint8_t *flags;
+  int threads; // <= 0 for one per cpu
+  long ticks;
+  // last tick
+  double tick_time; // seconds
+  int awake;        // over loaded terrain, the others stay where they are
+} Entities;
+
+void entities_init(Entities *entities, int capacity, int threads);
+void entities_unload(Entities *entities);
+// returns the new entity's index
+int entities_add(Entities *entities, Vector3 position, Vector3 velocity, float radius, float jump, uint8_t flags);
+// the last entity takes the removed one's index
+void entities_remove(Entities *entities, int index);
+
+// groups entities by cell sized squares of the ground so runs of them sample
+// the same chunk, which reorders the indices. the tick does it now and then
+void entities_sort(Entities *entities, float cell);
+
+// up to max entities within range of point, picked by distance (not by
+// index, which entities_sort changes). their indices go to nearest and
+// squared distances to distances, in no particular order. returns how many
+int entities_nearest(const Entities *entities, Vector3 point, float range, int max, int *nearest, float *distances);
+
+// dt seconds for every entity, the ground has to stay as it is during the
+// call (no chunks_update or sculpting from another thread)
+void entities_tick(Entities *entities, const ChunkManager *chunks, const VoxelWorld *voxels, float dt);
+
+#endif
@@ -0,0 +1,18 @@
+// post process effect, fog thickening with depth
+
+uniform float fogDensity;
+uniform vec3 fogColor;
+
+float linearizeDepth(float depth) {
+    const float zNear = 0.1;
+    const float zFar = 2000.0;
+    return (2 * zNear) / (zFar + zNear - depth * (zFar - zNear));
+}
+
+vec3 fog(vec3 color, vec2 uv, float depth) {
+    float fogValue = linearizeDepth(depth) * fogDensity;
+
+    vec3 haze = fogColor * fogValue;
+    vec3 scene = color * (1.0 - fogValue / 2);
+    return haze + scene;
+}
@@ -0,0 +1,211 @@
+#include "height_pyramid.h"
+
+#include <math.h>
+#include <raymath.h>
+#include <stdlib.h>
+
+//---Build---
+
+// plain compares, fminf and fmaxf are library calls at -O2 for their nan
+// handling and nothing here is nan
+static inline float minf(float a, float b) { return a < b ? a : b; }
+static inline float maxf(float a, float b) { return a > b ? a : b; }
+
+HeightPyramid height_pyramid_build(const Heightfield *hf) {
+  HeightPyramid pyramid = {0};
+  int w = hf->width - 1, l = hf->length - 1;
+  if (w < 1 || l < 1)
+    return pyramid;
+  // halving rounds up so odd sizes keep their last cells
+  for (;;) {
+    pyramid.width[pyramid.levels] = w;
+    pyramid.length[pyramid.levels] = l;
+    pyramid.offset[pyramid.levels] = pyramid.count;
+    pyramid.count += w * l;
+    pyramid.levels++;
+    if (w == 1 && l == 1)
+      break;
+    w = (w + 1) / 2;
+    l = (l + 1) / 2;
+  }
+  pyramid.bounds = RL_MALLOC((size_t)pyramid.count * 2 * sizeof(float));
+  height_pyramid_update(&pyramid, hf, (HeightfieldRect){0, 0, hf->width - 1, hf->length - 1});
+  return pyramid;
+}
+
+void height_pyramid_update(HeightPyramid *pyramid, const Heightfield *hf, HeightfieldRect rect) {
+  if (!pyramid->bounds)
+    return;
+  // a sample is a corner of the cells before and after it
+  int x0 = rect.x0 > 0 ? rect.x0 - 1 : 0, x1 = rect.x1 < pyramid->width[0] ? rect.x1 : pyramid->width[0] - 1;
+  int z0 = rect.z0 > 0 ? rect.z0 - 1 : 0, z1 = rect.z1 < pyramid->length[0] ? rect.z1 : pyramid->length[0] - 1;
+  for (int z = z0; z <= z1; z++) {
+    for (int x = x0; x <= x1; x++) {
+      const float *row = &hf->heights[z * hf->width + x], *next = row + hf->width;
+      float *b = &pyramid->bounds[(z * pyramid->width[0] + x) * 2];
+      b[0] = minf(minf(row[0], row[1]), minf(next[0], next[1]));
+      b[1] = maxf(maxf(row[0], row[1]), maxf(next[0], next[1]));
+    }
+  }
+
+  for (int l = 1; l < pyramid->levels; l++) {
+    x0 /= 2, x1 /= 2, z0 /= 2, z1 /= 2;
+    int child_w = pyramid->width[l - 1], child_l = pyramid->length[l - 1];
+    for (int nz = z0; nz <= z1; nz++) {
+      for (int nx = x0; nx <= x1; nx++) {
+        // a last odd child stands in for its missing neighbour
+        const float *c = &pyramid->bounds[(pyramid->offset[l - 1] + nz * 2 * child_w + nx * 2) * 2];
+        int right = nx * 2 + 1 < child_w ? 2 : 0, front = nz * 2 + 1 < child_l ? child_w * 2 : 0;
+        float *b = &pyramid->bounds[(pyramid->offset[l] + nz * pyramid->width[l] + nx) * 2];
+        b[0] = minf(minf(c[0], c[right]), minf(c[front], c[front + right]));
+        b[1] = maxf(maxf(c[1], c[right + 1]), maxf(c[front + 1], c[front + right + 1]));
+      }
+    }
+  }
+}
+
+void height_pyramid_unload(HeightPyramid *pyramid) {
+  RL_FREE(pyramid->bounds);
+  *pyramid = (HeightPyramid){0};
+}
+
+size_t height_pyramid_bytes(const HeightPyramid *pyramid) {
+  return (size_t)pyramid->count * 2 * sizeof(float);
+}
+
+//---Raycast---
+
+// the ray with x and z in samples and y in world units, t is the world
+// distance along it
+typedef struct Trace {
+  float ox, oy, oz;
+  float dx, dy, dz;
+} Trace;
+
+// narrows t0..t1 to where o + d * t is within lo..hi
+static bool clip(float o, float d, float lo, float hi, float *t0, float *t1) {
+  if (d == 0)
+    return o >= lo && o <= hi;
+  float ta = (lo - o) / d, tb = (hi - o) / d;
+  *t0 = maxf(*t0, minf(ta, tb));
+  *t1 = minf(*t1, maxf(ta, tb));
+  return *t0 <= *t1;
+}
+
+// the cell of sample coordinate v, kept within lo..hi
+static int cell_in(float v, int lo, int hi) {
+  return (int)minf(maxf(floorf(v), lo), hi);
+}
+
+// first t in ta..tb where the ray is on or under the surface of cell (x, z).
+// the diagonal fx + fz = 1 splits the segment into one piece per triangle,
+// on each the height above the triangle's plane is linear in t
+static bool cell_hit(const Heightfield *hf, const Trace *r, int x, int z, float ta, float tb, float *t,
+                     Vector3 *normal) {
+  const float *row = &hf->heights[z * hf->width + x], *next = row + hf->width;
+  float h00 = row[0], h10 = row[1], h01 = next[0], h11 = next[1];
+  float cuts[3] = {ta, tb, tb};
+  float along = r->dx + r->dz;
+  if (along != 0) {
+    float tm = (x + z + 1 - r->ox - r->oz) / along;
+    if (tm > ta && tm < tb)
+      cuts[1] = tm;
+  }
+
+  for (int k = 0; k < 2; k++) {
+    float a = cuts[k], b = cuts[k + 1];
+    if (k && !(a < b))
+      break;
+    float mid = (a + b) * 0.5f;
+    bool upper = r->ox + r->dx * mid - x + r->oz + r->dz * mid - z > 1;
+    // plane h = base + sx * fx + sz * fz, like sample_cell
+    float sx = upper ? h11 - h01 : h10 - h00;
+    float sz = upper ? h11 - h10 : h01 - h00;
+    float base = upper ? h11 - sx - sz : h00;
+    float fa = r->oy + r->dy * a - (base + sx * (r->ox + r->dx * a - x) + sz * (r->oz + r->dz * a - z));
+    float fb = r->oy + r->dy * b - (base + sx * (r->ox + r->dx * b - x) + sz * (r->oz + r->dz * b - z));
+    if (fa <= 0 || fb <= 0) {
+      *t = fa <= 0 ? a : a + (b - a) * fa / (fa - fb);
+      *normal = Vector3Normalize((Vector3){-sx / hf->spacing, 1, -sz / hf->spacing});
+      return true;
+    }
+  }
+  return false;
+}
+
+bool height_pyramid_raycast(const HeightPyramid *pyramid, const Heightfield *hf, Ray ray, float max_distance,
+                            RayCollision *hit) {
+  *hit = (RayCollision){0};
+  float length = Vector3Length(ray.direction);
+  if (!pyramid->bounds || !(length > 0))
+    return false;
+  Vector3 dir = Vector3Scale(ray.direction, 1 / length);
+  float s = hf->spacing;
+  Trace r = {ray.position.x / s, ray.position.y, ray.position.z / s, dir.x / s, dir.y, dir.z / s};
+
+  // down to the part of the ray over the heightfield and under its top
+  int top = pyramid->levels - 1;
+  float t = 0, t1 = max_distance;
+  if (!clip(r.ox, r.dx, 0, pyramid->width[0], &t, &t1) || !clip(r.oz, r.dz, 0, pyramid->length[0], &t, &t1) ||
+      !clip(r.oy, r.dy, -INFINITY, pyramid->bounds[pyramid->offset[top] * 2 + 1], &t, &t1))
+    return false;
+
+  int level = top;
+  int x = cell_in(r.ox + r.dx * t, 0, pyramid->width[0] - 1);
+  int z = cell_in(r.oz + r.dz * t, 0, pyramid->length[0] - 1);
+  for (;;) {
+    int nx = x >> level, nz = z >> level, size = 1 << level;
+    const float *b = &pyramid->bounds[(pyramid->offset[level] + nz * pyramid->width[level] + nx) * 2];
+    float tx = r.dx > 0 ? ((nx + 1) * size - r.ox) / r.dx : r.dx < 0 ? (nx * size - r.ox) / r.dx : INFINITY;
+    float tz = r.dz > 0 ? ((nz + 1) * size - r.oz) / r.dz : r.dz < 0 ? (nz * size - r.oz) / r.dz : INFINITY;
+    float te = maxf(minf(minf(tx, tz), t1), t);
+    float ya = r.oy + r.dy * t, yb = r.oy + r.dy * te;
+
+    bool found = false;
+    float t_hit, h;
+    Vector3 normal = {0, 1, 0};
+    if (minf(ya, yb) <= b[1]) {
+      if (maxf(ya, yb) < b[0]) {
+        // under the whole node, only where the ray starts
+        found = true;
+        t_hit = t;
+        heightfield_height(hf, (r.ox + r.dx * t) * s, (r.oz + r.dz * t) * s, &h, &normal);
+      } else if (level > 0) {
+        level--;
+        continue;
+      } else {
+        found = cell_hit(hf, &r, x, z, t, te, &t_hit, &normal);
+      }
+    }
+    if (found) {
+      hit->hit = true;
+      hit->distance = t_hit;
+      hit->point = Vector3Add(ray.position, Vector3Scale(dir, t_hit));
+      hit->normal = normal;
+      return true;
+    }
+
+    if (te >= t1)
+      return false;
+    // the coordinate that crossed the node's border steps over it, the other
+    // follows the ray but stays in the node
+    int x0 = nx * size, z0 = nz * size;
+    int x1 = x0 + size <= pyramid->width[0] ? x0 + size - 1 : pyramid->width[0] - 1;
+    int z1 = z0 + size <= pyramid->length[0] ? z0 + size - 1 : pyramid->length[0] - 1;
+    x = tx <= tz ? (r.dx > 0 ? x0 + size : x0 - 1) : cell_in(r.ox + r.dx * te, x0, x1);
+    z = tz <= tx ? (r.dz > 0 ? z0 + size : z0 - 1) : cell_in(r.oz + r.dz * te, z0, z1);
+    if (x < 0 || x >= pyramid->width[0] || z < 0 || z >= pyramid->length[0])
+      return false;
+    t = te;
+    if (level < top)
+      level++;
+  }
+}
+
+int height_pyramid_raycast_batch(const HeightPyramid *pyramid, const Heightfield *hf, const Ray *rays,
+                                 const float *max_distances, int count, RayCollision *hits) {
+  int found = 0;
+  for (int i = 0; i < count; i++)
+    found += height_pyramid_raycast(pyramid, hf, rays[i], max_distances ? max_distances[i] : INFINITY, &hits[i]);
+  return found;
+}
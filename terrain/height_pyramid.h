@@ -0,0 +1,44 @@
+#ifndef HEIGHT_PYRAMID_H
+#define HEIGHT_PYRAMID_H
+
+#include <raylib.h>
+#include <stddef.h>
+
+#include "heightfield.h"
+
+// min/max height pyramid for raycasts. level 0 holds the bounds of every grid
+// cell, each level above the bounds of 2x2 nodes below it, up to one node for
+// the whole heightfield. a ray walks the nodes front to back with a dda,
+// skips every node it passes over, only goes down a level where it dips
+// under a node's max and ends with an exact test against the two triangles
+// of a cell, the same ones heightfield_height interpolates.
+
+#define HEIGHT_PYRAMID_MAX_LEVELS 32
+
+typedef struct HeightPyramid {
+  int levels;
+  int width[HEIGHT_PYRAMID_MAX_LEVELS], length[HEIGHT_PYRAMID_MAX_LEVELS]; // nodes per level
+  int offset[HEIGHT_PYRAMID_MAX_LEVELS]; // first node of each level
+  int count;
+  float *bounds; // min, max per node, level 0 first, row major per level
+} HeightPyramid;
+
+// cpu only, about twice the heights in size
+HeightPyramid height_pyramid_build(const Heightfield *hf);
+// after an edit to rect of the heightfield, the cells touching it and their
+// ancestors
+void height_pyramid_update(HeightPyramid *pyramid, const Heightfield *hf, HeightfieldRect rect);
+void height_pyramid_unload(HeightPyramid *pyramid);
+size_t height_pyramid_bytes(const HeightPyramid *pyramid);
+
+// first hit within max_distance of a ray in the heightfield's local space,
+// distance in world units. a ray starting under the surface hits where it
+// starts. no allocation
+bool height_pyramid_raycast(const HeightPyramid *pyramid, const Heightfield *hf, Ray ray, float max_distance,
+                            RayCollision *hit);
+// count rays at once, e.g. line of sight checks with max_distances[i] the
+// distance to the target (NULL for no limit). returns how many hit
+int height_pyramid_raycast_batch(const HeightPyramid *pyramid, const Heightfield *hf, const Ray *rays,
+                                 const float *max_distances, int count, RayCollision *hits);
+
+#endif
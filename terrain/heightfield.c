@@ -0,0 +1,272 @@
+#include "heightfield.h"
+
+#include <math.h>
+#include <raymath.h>
+#include <stdlib.h>
+
+Heightfield heightfield_alloc(int width, int length, float spacing, float max_height) {
+  Heightfield hf = {
+      .width = width,
+      .length = length,
+      .spacing = spacing,
+      .max_height = max_height,
+      .heights = RL_CALLOC((size_t)width * length, sizeof(float)),
+  };
+  return hf;
+}
+
+void heightfield_alloc_slopes(Heightfield *hf) {
+  if (!hf->slopes)
+    hf->slopes = RL_CALLOC((size_t)hf->width * hf->length * 2, sizeof(float));
+}
+
+void heightfield_unload(Heightfield *hf) {
+  RL_FREE(hf->heights);
+  RL_FREE(hf->slopes);
+  hf->heights = NULL;
+  hf->slopes = NULL;
+}
+
+Vector3 heightfield_normal(const Heightfield *hf, int x, int z) {
+  // the normal of y = h(x, z) is (-dh/dx, 1, -dh/dz)
+  int i = z * hf->width + x;
+  float dx, dz;
+  if (hf->slopes) {
+    dx = hf->slopes[i * 2];
+    dz = hf->slopes[i * 2 + 1];
+  } else {
+    int x0 = x > 0 ? x - 1 : x, x1 = x < hf->width - 1 ? x + 1 : x;
+    int z0 = z > 0 ? z - 1 : z, z1 = z < hf->length - 1 ? z + 1 : z;
+    dx = (heightfield_at(hf, x1, z) - heightfield_at(hf, x0, z)) / ((x1 - x0) * hf->spacing);
+    dz = (heightfield_at(hf, x, z1) - heightfield_at(hf, x, z0)) / ((z1 - z0) * hf->spacing);
+  }
+  return Vector3Normalize((Vector3){-dx, 1, -dz});
+}
+
+void heightfield_rect_normals(const Heightfield *hf, HeightfieldRect rect, float *normals) {
+  for (int z = rect.z0; z <= rect.z1; z++) {
+    for (int x = rect.x0; x <= rect.x1; x++) {
+      Vector3 n = heightfield_normal(hf, x, z);
+      *normals++ = n.x;
+      *normals++ = n.y;
+      *normals++ = n.z;
+    }
+  }
+}
+
+// Function to compute barycentric coordinates for a point P in a triangle defined by vertices A, B, C
+void barycentric_coordinates(Vector2 P, Vector2 A, Vector2 B, Vector2 C, float* lambda1, float* lambda2, float* lambda3) {
+    float denom = (B.y - C.y) * (A.x - C.x) + (C.x - B.x) * (A.y - C.y);
+    
+    *lambda1 = ((B.y - C.y) * (P.x - C.x) + (C.x - B.x) * (P.y - C.y)) / denom;
+    *lambda2 = ((C.y - A.y) * (P.x - C.x) + (A.x - C.x) * (P.y - C.y)) / denom;
+    *lambda3 = 1.0f - *lambda1 - *lambda2;  // Ensure that the sum of lambdas equals 1
+}
+
+//---Queries---
+
+// cells split along the (x+1, z) - (x, z+1) diagonal like the meshes, so the
+// lower triangle is fx + fz <= 1. slopes are per sample step
+static inline void sample_cell(const Heightfield *hf, float x, float z, float *height, float *dx, float *dz) {
+  int w = hf->width;
+  int cx = (int)x < w - 2 ? (int)x : w - 2, cz = (int)z < hf->length - 2 ? (int)z : hf->length - 2;
+  float fx = x - cx, fz = z - cz;
+  const float *h = &hf->heights[cz * w + cx];
+  float h00 = h[0], h10 = h[1], h01 = h[w], h11 = h[w + 1];
+  if (fx + fz <= 1) {
+    *dx = h10 - h00;
+    *dz = h01 - h00;
+    *height = h00 + fx * *dx + fz * *dz;
+  } else {
+    *dx = h11 - h01;
+    *dz = h11 - h10;
+    *height = h11 - (1 - fx) * *dx - (1 - fz) * *dz;
+  }
+}
+
+bool heightfield_height(const Heightfield *hf, float x, float z, float *height, Vector3 *normal) {
+  float sx = x / hf->spacing, sz = z / hf->spacing, dx, dz;
+  if (!(sx >= 0 && sz >= 0 && sx <= hf->width - 1 && sz <= hf->length - 1))
+    return false;
+  sample_cell(hf, sx, sz, height, &dx, &dz);
+  if (normal) {
+    // spelled out in the same order as the sse2 path so both agree to the bit
+    float inv_spacing = 1.0f / hf->spacing, nx = dx * inv_spacing, nz = dz * inv_spacing;
+    float scale = 1.0f / sqrtf(nx * nx + 1 + nz * nz);
+    *normal = (Vector3){-nx * scale, scale, -nz * scale};
+  }
+  return true;
+}
+
+float get_terrain_height(float x, float z, const Heightfield *hf) {
+  float height;
+  return heightfield_height(hf, x, z, &height, NULL) ? height : -1;
+}
+
+// the scalar path for the tail, and everything without sse2
+static int sample_scalar(const Heightfield *hf, const float *xs, const float *zs, int count, float *heights,
+                         Vector3 *normals, bool *inside) {
+  int found = 0;
+  for (int i = 0; i < count; i++) {
+    Vector3 normal = {0, 1, 0};
+    bool in = heightfield_height(hf, xs[i], zs[i], &heights[i], normals ? &normal : NULL);
+    if (!in)
+      heights[i] = 0;
+    if (normals)
+      normals[i] = normal;
+    if (inside)
+      inside[i] = in;
+    found += in;
+  }
+  return found;
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+int heightfield_sample(const Heightfield *hf, const float *xs, const float *zs, int count, float *heights,
+                       Vector3 *normals, bool *inside) {
+  int w = hf->width, found = 0, i = 0;
+  __m128 inv_spacing = _mm_set1_ps(1.0f / hf->spacing), zero = _mm_setzero_ps(), one = _mm_set1_ps(1);
+  __m128 last_x = _mm_set1_ps(w - 1), last_z = _mm_set1_ps(hf->length - 1);
+  __m128i last_cx = _mm_set1_epi32(w - 2), last_cz = _mm_set1_epi32(hf->length - 2);
+  for (; i + 4 <= count; i += 4) {
+    // divided like heightfield_height, a multiply can round differently
+    __m128 x = _mm_div_ps(_mm_loadu_ps(&xs[i]), _mm_set1_ps(hf->spacing));
+    __m128 z = _mm_div_ps(_mm_loadu_ps(&zs[i]), _mm_set1_ps(hf->spacing));
+    __m128 in = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmple_ps(x, last_x)),
+                           _mm_and_ps(_mm_cmpge_ps(z, zero), _mm_cmple_ps(z, last_z)));
+    // outside lanes (nan too, max returns its second operand) are clamped
+    // onto the field so their loads stay in bounds
+    x = _mm_min_ps(_mm_max_ps(x, zero), last_x);
+    z = _mm_min_ps(_mm_max_ps(z, zero), last_z);
+    __m128i cx = _mm_cvttps_epi32(x), cz = _mm_cvttps_epi32(z);
+    // no min_epi32 before sse4.1
+    cx = _mm_sub_epi32(cx, _mm_and_si128(_mm_cmpgt_epi32(cx, last_cx), _mm_set1_epi32(1)));
+    cz = _mm_sub_epi32(cz, _mm_and_si128(_mm_cmpgt_epi32(cz, last_cz), _mm_set1_epi32(1)));
+    __m128 fx = _mm_sub_ps(x, _mm_cvtepi32_ps(cx)), fz = _mm_sub_ps(z, _mm_cvtepi32_ps(cz));
+
+    int cell_x[4], cell_z[4];
+    _mm_storeu_si128((__m128i *)cell_x, cx);
+    _mm_storeu_si128((__m128i *)cell_z, cz);
+    float c00[4], c10[4], c01[4], c11[4];
+    for (int k = 0; k < 4; k++) {
+      const float *h = &hf->heights[cell_z[k] * w + cell_x[k]];
+      c00[k] = h[0];
+      c10[k] = h[1];
+      c01[k] = h[w];
+      c11[k] = h[w + 1];
+    }
+    __m128 h00 = _mm_loadu_ps(c00), h10 = _mm_loadu_ps(c10), h01 = _mm_loadu_ps(c01), h11 = _mm_loadu_ps(c11);
+
+    // both triangles, then one comparison picks per lane
+    __m128 upper = _mm_cmpgt_ps(_mm_add_ps(fx, fz), one);
+    __m128 dx_low = _mm_sub_ps(h10, h00), dz_low = _mm_sub_ps(h01, h00);
+    __m128 dx_high = _mm_sub_ps(h11, h01), dz_high = _mm_sub_ps(h11, h10);
+    __m128 height_low = _mm_add_ps(_mm_add_ps(h00, _mm_mul_ps(fx, dx_low)), _mm_mul_ps(fz, dz_low));
+    __m128 height_high = _mm_sub_ps(_mm_sub_ps(h11, _mm_mul_ps(_mm_sub_ps(one, fx), dx_high)),
+                                    _mm_mul_ps(_mm_sub_ps(one, fz), dz_high));
+    __m128 height = _mm_or_ps(_mm_and_ps(upper, height_high), _mm_andnot_ps(upper, height_low));
+    _mm_storeu_ps(&heights[i], _mm_and_ps(in, height));
+
+    int mask = _mm_movemask_ps(in);
+    found += (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3 & 1);
+    for (int k = 0; inside && k < 4; k++)
+      inside[i + k] = mask >> k & 1;
+    if (!normals)
+      continue;
+
+    // (-dh/dx, 1, -dh/dz), flat over the triangle
+    __m128 nx = _mm_or_ps(_mm_and_ps(upper, dx_high), _mm_andnot_ps(upper, dx_low));
+    __m128 nz = _mm_or_ps(_mm_and_ps(upper, dz_high), _mm_andnot_ps(upper, dz_low));
+    nx = _mm_and_ps(in, _mm_mul_ps(nx, inv_spacing));
+    nz = _mm_and_ps(in, _mm_mul_ps(nz, inv_spacing));
+    __m128 scale = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), one), _mm_mul_ps(nz, nz))));
+    float out_x[4], out_y[4], out_z[4];
+    _mm_storeu_ps(out_x, _mm_mul_ps(_mm_sub_ps(zero, nx), scale));
+    _mm_storeu_ps(out_y, scale);
+    _mm_storeu_ps(out_z, _mm_mul_ps(_mm_sub_ps(zero, nz), scale));
+    for (int k = 0; k < 4; k++)
+      normals[i + k] = (Vector3){out_x[k], out_y[k], out_z[k]};
+  }
+  return found + sample_scalar(hf, xs + i, zs + i, count - i, heights + i, normals ? normals + i : NULL,
+                               inside ? inside + i : NULL);
+}
+#else
+int heightfield_sample(const Heightfield *hf, const float *xs, const float *zs, int count, float *heights,
+                       Vector3 *normals, bool *inside) {
+  return sample_scalar(hf, xs, zs, count, heights, normals, inside);
+}
+#endif
+
+Mesh heightfield_build_mesh(const Heightfield *hf) {
+  Mesh mesh = {0};
+  int cells_x = hf->width - 1, cells_z = hf->length - 1;
+  float s = hf->spacing;
+
+  mesh.triangleCount = cells_x * cells_z * 2;
+  mesh.vertexCount = mesh.triangleCount * 3;
+  mesh.vertices = RL_MALLOC(mesh.vertexCount * 3 * sizeof(float));
+  mesh.normals = RL_MALLOC(mesh.vertexCount * 3 * sizeof(float));
+  mesh.texcoords = RL_MALLOC(mesh.vertexCount * 2 * sizeof(float));
+
+  // the normal of z = h(x, z) is (-dh/dx, 1, -dh/dz), one per sample
+  Vector3 *sample_normals = NULL;
+  if (hf->slopes) {
+    int count = hf->width * hf->length;
+    sample_normals = RL_MALLOC(count * sizeof(Vector3));
+    for (int i = 0; i < count; i++)
+      sample_normals[i] = Vector3Normalize((Vector3){-hf->slopes[i * 2], 1, -hf->slopes[i * 2 + 1]});
+  }
+
+  // restrict locals, otherwise every store reloads hf through a possible alias
+  const float *heights = hf->heights;
+  const Vector3 *restrict smooth = sample_normals;
+  float *restrict vertices = mesh.vertices;
+  float *restrict normals = mesh.normals;
+  float *restrict texcoords = mesh.texcoords;
+  int width = hf->width;
+  float u_step = 1.0f / cells_x, v_step = 1.0f / cells_z;
+
+  int v = 0, t = 0;
+  for (int z = 0; z < cells_z; z++) {
+    for (int x = 0; x < cells_x; x++) {
+      // two triangles split along the (x+1, z) - (x, z+1) diagonal
+      int corners[6][2] = {{x, z}, {x, z + 1}, {x + 1, z}, {x + 1, z}, {x, z + 1}, {x + 1, z + 1}};
+
+      for (int i = 0; i < 6; i++) {
+        int cx = corners[i][0], cz = corners[i][1];
+        vertices[v + i * 3] = cx * s;
+        vertices[v + i * 3 + 1] = heights[cz * width + cx];
+        vertices[v + i * 3 + 2] = cz * s;
+        texcoords[t + i * 2] = cx * u_step;
+        texcoords[t + i * 2 + 1] = cz * v_step;
+        if (smooth) {
+          Vector3 n = smooth[cz * width + cx];
+          normals[v + i * 3] = n.x;
+          normals[v + i * 3 + 1] = n.y;
+          normals[v + i * 3 + 2] = n.z;
+        }
+      }
+
+      // flat normal per triangle
+      for (int i = 0; i < 6 && !smooth; i += 3) {
+        Vector3 a = {vertices[v + i * 3], vertices[v + i * 3 + 1], vertices[v + i * 3 + 2]};
+        Vector3 b = {vertices[v + i * 3 + 3], vertices[v + i * 3 + 4], vertices[v + i * 3 + 5]};
+        Vector3 c = {vertices[v + i * 3 + 6], vertices[v + i * 3 + 7], vertices[v + i * 3 + 8]};
+        Vector3 n = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(b, a), Vector3Subtract(c, a)));
+        for (int k = 0; k < 3; k++) {
+          normals[v + (i + k) * 3] = n.x;
+          normals[v + (i + k) * 3 + 1] = n.y;
+          normals[v + (i + k) * 3 + 2] = n.z;
+        }
+      }
+
+      v += 18;
+      t += 12;
+    }
+  }
+
+  RL_FREE(sample_normals);
+  return mesh;
+}
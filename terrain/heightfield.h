@@ -0,0 +1,67 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <raylib.h>
+
+// terrain source of truth: one float per sample in world units, replaces the
+// rgba heightmap image. sample (x, z) sits at (x*spacing, h, z*spacing) in
+// terrain local space.
+typedef struct Heightfield {
+  int width;  // samples along x
+  int length; // samples along z
+  float spacing;
+  float max_height;
+  float *heights; // row major, z * width + x
+  // optional surface slope (dh/dx, dh/dz) per sample, same layout as heights.
+  // filled by perlin_heightfield from the noise derivatives, NULL if unused
+  float *slopes;
+} Heightfield;
+
+// samples x0..x1 by z0..z1, inclusive
+typedef struct HeightfieldRect {
+  int x0, z0, x1, z1;
+} HeightfieldRect;
+
+static inline int heightfield_rect_width(HeightfieldRect r) { return r.x1 - r.x0 + 1; }
+static inline int heightfield_rect_length(HeightfieldRect r) { return r.z1 - r.z0 + 1; }
+
+Heightfield heightfield_alloc(int width, int length, float spacing, float max_height);
+// make room for slopes so the generator fills them in
+void heightfield_alloc_slopes(Heightfield *hf);
+void heightfield_unload(Heightfield *hf);
+
+static inline float heightfield_at(const Heightfield *hf, int x, int z) {
+  return hf->heights[z * hf->width + x];
+}
+
+// world size covered by the samples
+static inline float heightfield_size_x(const Heightfield *hf) { return (hf->width - 1) * hf->spacing; }
+static inline float heightfield_size_z(const Heightfield *hf) { return (hf->length - 1) * hf->spacing; }
+
+// unit surface normal at a sample, from the slopes when present and central
+// differences otherwise
+Vector3 heightfield_normal(const Heightfield *hf, int x, int z);
+// heightfield_normal for every sample in rect, xyz per sample row by row
+void heightfield_rect_normals(const Heightfield *hf, HeightfieldRect rect, float *normals);
+
+// barycentric coordinates of P in the triangle A, B, C
+void barycentric_coordinates(Vector2 P, Vector2 A, Vector2 B, Vector2 C, float* lambda1, float* lambda2, float* lambda3);
+
+// surface under count local positions (xs[i], zs[i]) at once, on the
+// triangles the meshes draw: one comparison picks the triangle of the cell
+// and its plane gives the height and the (flat) normal. 4 at a time with
+// sse2. positions off the heightfield get inside[i] = false, height 0 and an
+// up normal. normals and inside may be NULL, returns how many were inside
+int heightfield_sample(const Heightfield *hf, const float *xs, const float *zs, int count, float *heights,
+                       Vector3 *normals, bool *inside);
+// one position, false when off the heightfield. normal may be NULL
+bool heightfield_height(const Heightfield *hf, float x, float z, float *height, Vector3 *normal);
+// heightfield_height, -1 when outside
+float get_terrain_height(float x, float z, const Heightfield *hf);
+
+// same layout as GenMeshHeightmap (6 vertices per cell), cpu side only so it
+// can run on a worker thread. normals are smooth per sample when slopes are
+// present and flat per triangle otherwise
+Mesh heightfield_build_mesh(const Heightfield *hf);
+
+#endif
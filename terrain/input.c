@@ -0,0 +1,113 @@
+#include "input.h"
+
+#include <time.h>
+
+#define LOG_MAGIC 0x4e494d54 // "TMIN"
+#define LOG_VERSION 1
+
+typedef struct LogHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t frame_size; // sizeof(FrameInput) when it was written
+  uint32_t reserved;
+} LogHeader;
+
+//---Polling---
+
+// raylib key or mouse button per InputButton, mouse buttons negated minus one
+static const int bindings[INPUT_BUTTON_COUNT] = {
+    [INPUT_FORWARD] = KEY_W,
+    [INPUT_BACK] = KEY_S,
+    [INPUT_LEFT] = KEY_A,
+    [INPUT_RIGHT] = KEY_D,
+    [INPUT_SPRINT] = KEY_LEFT_SHIFT,
+    [INPUT_JUMP] = KEY_SPACE,
+    [INPUT_TOGGLE_JUMP] = KEY_J,
+    [INPUT_PLACE] = -1 - MOUSE_BUTTON_LEFT,
+    [INPUT_REMOVE] = -1 - MOUSE_BUTTON_RIGHT,
+    [INPUT_TEXTURE_1] = KEY_ONE,
+    [INPUT_TEXTURE_2] = KEY_TWO,
+    [INPUT_RAISE] = KEY_Z,
+    [INPUT_LOWER] = KEY_X,
+    [INPUT_FLATTEN] = KEY_C,
+    [INPUT_SMOOTH] = KEY_V,
+};
+
+FrameInput input_poll(void) {
+  FrameInput frame = {.dt = GetFrameTime(), .look = GetMouseDelta(), .scroll = GetMouseWheelMove()};
+  for (int b = 0; b < INPUT_BUTTON_COUNT; b++) {
+    int key = bindings[b];
+    bool down = key >= 0 ? IsKeyDown(key) : IsMouseButtonDown(-1 - key);
+    bool pressed = key >= 0 ? IsKeyPressed(key) : IsMouseButtonPressed(-1 - key);
+    frame.down |= down << b;
+    frame.pressed |= pressed << b;
+  }
+  return frame;
+}
+
+bool input_down(const FrameInput *frame, InputButton button) {
+  return frame->down >> button & 1;
+}
+
+bool input_pressed(const FrameInput *frame, InputButton button) {
+  return frame->pressed >> button & 1;
+}
+
+//---Log---
+
+// native byte order, logs are for replaying on the machine that made them
+bool input_log_record(InputLog *log, const char *path) {
+  *log = (InputLog){fopen(path, "wb"), true, 0};
+  if (!log->file) {
+    TRACELOG(LOG_WARNING, "INPUT: could not create %s", path);
+    return false;
+  }
+  LogHeader header = {LOG_MAGIC, LOG_VERSION, sizeof(FrameInput), 0};
+  if (fwrite(&header, sizeof(header), 1, log->file) != 1) {
+    input_log_close(log);
+    return false;
+  }
+  return true;
+}
+
+bool input_log_replay(InputLog *log, const char *path) {
+  *log = (InputLog){fopen(path, "rb"), false, 0};
+  if (!log->file) {
+    TRACELOG(LOG_WARNING, "INPUT: could not open %s", path);
+    return false;
+  }
+  LogHeader header;
+  if (fread(&header, sizeof(header), 1, log->file) != 1 || header.magic != LOG_MAGIC ||
+      header.version != LOG_VERSION || header.frame_size != sizeof(FrameInput)) {
+    TRACELOG(LOG_WARNING, "INPUT: %s is not an input log", path);
+    input_log_close(log);
+    return false;
+  }
+  return true;
+}
+
+bool input_log_write(InputLog *log, const FrameInput *frame) {
+  if (!log->file || fwrite(frame, sizeof(*frame), 1, log->file) != 1)
+    return false;
+  log->frames++;
+  return true;
+}
+
+bool input_log_read(InputLog *log, FrameInput *frame) {
+  if (!log->file || fread(frame, sizeof(*frame), 1, log->file) != 1)
+    return false;
+  log->frames++;
+  return true;
+}
+
+void input_log_close(InputLog *log) {
+  if (log->file)
+    fclose(log->file);
+  log->file = NULL;
+}
+
+double input_clock(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
@@ -0,0 +1,62 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <raylib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// everything the game reads from the keyboard and mouse in a frame, and a
+// log of frames on disk. a recorded log fed back frame by frame replays the
+// same session, with or without a window
+
+typedef enum InputButton {
+  INPUT_FORWARD,
+  INPUT_BACK,
+  INPUT_LEFT,
+  INPUT_RIGHT,
+  INPUT_SPRINT,
+  INPUT_JUMP,
+  INPUT_TOGGLE_JUMP, // high jumps on and off
+  INPUT_PLACE,       // a block
+  INPUT_REMOVE,
+  INPUT_TEXTURE_1,
+  INPUT_TEXTURE_2,
+  INPUT_RAISE, // sculpting, by SculptTool
+  INPUT_LOWER,
+  INPUT_FLATTEN,
+  INPUT_SMOOTH,
+  INPUT_BUTTON_COUNT,
+} InputButton;
+
+// 20 bytes, written to the log as is
+typedef struct FrameInput {
+  float dt;         // frame time, seconds
+  Vector2 look;     // mouse movement, pixels
+  float scroll;     // mouse wheel
+  uint16_t down;    // bit per InputButton held
+  uint16_t pressed; // bit per InputButton that went down this frame
+} FrameInput;
+
+typedef struct InputLog {
+  FILE *file;
+  bool writing;
+  long frames;
+} InputLog;
+
+// this frame's input from raylib
+FrameInput input_poll(void);
+bool input_down(const FrameInput *frame, InputButton button);
+bool input_pressed(const FrameInput *frame, InputButton button);
+
+// false if the file can't be opened, or for replays isn't an input log
+bool input_log_record(InputLog *log, const char *path);
+bool input_log_replay(InputLog *log, const char *path);
+bool input_log_write(InputLog *log, const FrameInput *frame);
+// false at the end of the log
+bool input_log_read(InputLog *log, FrameInput *frame);
+void input_log_close(InputLog *log);
+
+// seconds from a monotonic clock, works without a window
+double input_clock(void);
+
+#endif
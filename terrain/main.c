@@ -4,9 +4,21 @@
 #include <rlgl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "block_renderer.h"
+#include "blocks.h"
+#include "chunks.h"
+#include "entities.h"
+#include "frustum.h"
+#include "heightfield.h"
+#include "input.h"
+#include "npc_renderer.h"
+#include "packed_mesh.h"
+#include "player.h"
+#include "post_process.h"
+#include "render_queue.h"
 
-
-#define GRAY_VALUE(c) ((float)(c.r + c.g + c.b) / 3.0f)
 #define MIN(X, Y) ({ __typeof__(X) _X = X; \
                     __typeof__(Y) _Y = Y; \
                    (_X) < (_Y) ? (_X) : (_Y); })
@@ -14,41 +26,39 @@
                     __typeof__(Y) _Y = Y; \
                    (_X) > (_Y) ? (_X) : (_Y); })
 
-Image my_perlin_image(int width, int height, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves);
-
 #define SCREEN_WIDTH 1280
 #define SCREEN_HEIGHT 720
 
-#define GRAVITY 100.0
-#define JUMP 60
 #define BLOCK_SIZE 5
-
-typedef struct Player {
-  float height;
-  Vector3 *position;
-  Camera3D *camera;
-  float vel_y;
-} Player;
-
-typedef struct Terrain {
-  Model *model;
-  Mesh *mesh;
-  int width;
-  int length;
-  int height;
-  float resolution;
-
-} Terrain;
-
-typedef struct Block {
-  Vector3 pos;
-  BoundingBox bounds;
-  int texture_id;
-  bool active;
-} Block;
-
-char *debug;
-int jump_force = JUMP;
+#define GEN_THREADS 0 // terrain generation workers, 0 = one per cpu
+
+// terrain streaming
+#define CHUNK_CELLS 64
+#define CHUNK_RADIUS 3
+#define CHUNK_MEMORY_BUDGET (128 * 1024 * 1024)
+#define CHUNK_UPLOAD_BUDGET 0.002 // seconds per frame
+#define CACHE_DIR "cache"
+#define TERRAIN_SEED 1337 // fixed so the tile cache can be reused between runs
+
+// terrain lod, chunks of 64 cells are drawn as 16, 32 or 64 cell nodes
+#define LOD_PATCH_CELLS 16
+#define LOD_LEVELS 3
+#define LOD0_RANGE 150.0f // world units at full resolution, doubles per level
+
+// 1 for error bounded adaptive meshes (rtin) instead of lod
+#define TERRAIN_RTIN 0
+#define RTIN_MAX_ERROR 0.5f // world units
+
+// terrain sculpting, hold z, x, c or v to raise, lower, flatten or smooth
+#define SCULPT_RADIUS 15.0f
+#define SCULPT_SPEED 20.0f // world units per second at the centre when raising or lowering
+#define SCULPT_RATE 2.0f   // flatten and smooth, fraction of the way per second
+
+// npcs wandering around the spawn, ticked with the player
+#define NPC_COUNT 20000
+#define NPC_SPREAD 700.0f // world units from the spawn
+#define NPC_DRAWN 1024    // nearest ones get a cube each
+#define NPC_DRAW_RANGE 150.0f
 
 // depth texture instead of render buffer
 RenderTexture2D LoadRenderTextureDepthTex(int width, int height)
@@ -89,435 +99,421 @@ RenderTexture2D LoadRenderTextureDepthTex(int width, int height)
     return target;
 }
 
-void player_move_position(Player *player, Vector3 move) {
-  *player->position = Vector3Add(*player->position, move);
-  player->camera->target = Vector3Add(player->camera->target, move);
-}
-
-// Function to compute barycentric coordinates for a point P in a triangle defined by vertices A, B, C
-void barycentric_coordinates(Vector2 P, Vector2 A, Vector2 B, Vector2 C, float* lambda1, float* lambda2, float* lambda3) {
-    float denom = (B.y - C.y) * (A.x - C.x) + (C.x - B.x) * (A.y - C.y);
-    
-    *lambda1 = ((B.y - C.y) * (P.x - C.x) + (C.x - B.x) * (P.y - C.y)) / denom;
-    *lambda2 = ((C.y - A.y) * (P.x - C.x) + (A.x - C.x) * (P.y - C.y)) / denom;
-    *lambda3 = 1.0f - *lambda1 - *lambda2;  // Ensure that the sum of lambdas equals 1
-}
+// everything a frame's update touches, the same with or without a window
+typedef struct Game {
+  ChunkManager chunks;
+  VoxelWorld voxels;
+  Entities npcs;
+  Player player, previous; // the latest two ticks
+  PlayerInput input;       // not simulated yet
+  PlayerClock clock;
+  Camera camera; // drawn, in between previous and player
+  float reach;
+  int current_texture;
+  float fog_density;
+  float flatten_height;
+  Vector3 collision; // where a new block goes
+  bool collided;
+} Game;
+
+// seconds spent in the parts of a frame a replay reports
+typedef struct FrameTiming {
+  int ticks;
+  double player, npcs, picking, edits;
+} FrameTiming;
+
+// shaders, textures and frame buffers, only with a window
+typedef struct Renderer {
+  Shader terrain_shader;
+  Texture texture;
+  Material terrain_material;
+  BlockRenderer blocks;
+  NpcRenderer npcs;
+  RenderQueue queue; // terrain, blocks and npcs, sorted by state
+  RenderTexture scene; // color and depth, read by the post processing
+  PostProcess post;
+} Renderer;
+
+// cache_dir is NULL without a usable cache
+void game_init(Game *game, const char *cache_dir, bool headless) {
+  // terrain gen, same look as the old fixed 1200x1200 map (360 samples, noise
+  // scale 2) but streamed in chunks
+  int width = 1200;
+  int max_height = width / 4;
+  const float resolution = 0.3;
+  int samples = (int)(width * resolution);
+  SetRandomSeed(TERRAIN_SEED);
+  chunks_init(&game->chunks, (ChunkConfig){
+      .cells = CHUNK_CELLS,
+      .spacing = (float)width / (samples - 1),
+      .max_height = max_height,
+      .seed_x = GetRandomValue(0, 10000),
+      .seed_z = GetRandomValue(0, 10000),
+      .noise_step = 2.0f / samples,
+      .lacunarity = 2,
+      .gain = 0.4,
+      .octaves = 6,
+      .radius = CHUNK_RADIUS,
+      .memory_budget = CHUNK_MEMORY_BUDGET,
+      .threads = GEN_THREADS,
+      .upload_budget = CHUNK_UPLOAD_BUDGET,
+      .cache_dir = cache_dir,
+      .lod = {.patch_cells = LOD_PATCH_CELLS, .levels = TERRAIN_RTIN ? 0 : LOD_LEVELS, .lod0_range = LOD0_RANGE,
+              .morph_start = 0.66f},
+      .rtin_error = RTIN_MAX_ERROR,
+      .packed = true,
+      .headless = headless,
+  });
+  game->reach = 2 * samples;
+
+  voxels_init(&game->voxels, BLOCK_SIZE);
+  game->current_texture = 0;
 
-float get_terrain_height(float x, float z, const float *vertices, int rows,
-                         int cols, float cell_size) {
-  // Find grid cell indices from position
-  int cell_x = floor(x / cell_size);
-  int cell_z = floor(z / cell_size);
+  Camera camera = {0};
+  camera.position = (Vector3){0.0f, max_height, -1.0f};
+  camera.target = (Vector3){0.0f, max_height, 0.0f};
+  camera.up = (Vector3){0.0f, 1.0f, 0.0f};
+  camera.fovy = 60.0f;
+  camera.projection = CAMERA_PERSPECTIVE;
+  game->camera = camera;
 
-  // handle out of bounds
-  if (cell_x >= cols - 1 || cell_z >= rows - 1 || cell_x < 0 || cell_z < 0) {
-    return -1;
+  const float dude_speed = 10;
+  game->player = game->previous = player_init(camera, 8, dude_speed);
+  game->input = (PlayerInput){0};
+  game->clock = (PlayerClock){0};
+
+  game->fog_density = 0.4f;
+  game->flatten_height = 0;
+  game->collided = false;
+
+  // ground under the player has to exist before the first frame
+  chunks_wait(&game->chunks, camera.position);
+
+  // dropped from above the terrain, they land over the first few seconds.
+  // raylib's generator is seeded above so replays get the same npcs
+  entities_init(&game->npcs, NPC_COUNT, GEN_THREADS);
+  for (int i = 0; i < NPC_COUNT; i++) {
+    float spread = NPC_SPREAD / 10000;
+    Vector3 pos = {GetRandomValue(-10000, 10000) * spread, max_height + GetRandomValue(0, 100),
+                   GetRandomValue(-10000, 10000) * spread};
+    float angle = GetRandomValue(0, 359) * DEG2RAD, speed = GetRandomValue(0, 20);
+    entities_add(&game->npcs, pos, (Vector3){cosf(angle) * speed, 0, sinf(angle) * speed},
+                 GetRandomValue(10, 30) / 10.0f, 30, GetRandomValue(0, 3) == 0 ? ENTITY_JUMPS : 0);
   }
-
-  // Indiced for corners of the grid cell
-  int vertex_index_top_left =
-      (cell_z * (cols - 1) + cell_x) * 18; // Step of 18 floats for each cell
-  int vertex_index_bottom_left =
-      vertex_index_top_left + 3; // Offset to the bottom-left vertex
-  int vertex_index_top_right =
-      vertex_index_top_left + 6; // Offset to the top-right vertex
-  int vertex_index_bottom_right =
-      vertex_index_top_left + 15; // Offset to the bottom-right vertex
-
-  // Corners of the cell
-  Vector3 tl = *(Vector3 *)&vertices[vertex_index_top_left];
-  Vector3 bl = *(Vector3 *)&vertices[vertex_index_bottom_left];
-  Vector3 tr = *(Vector3 *)&vertices[vertex_index_top_right];
-  Vector3 br = *(Vector3 *)&vertices[vertex_index_bottom_right];
-
-  // Height interpolated with barycentric coordinates
-  // First triangle: V1, V2, V3
-    float lambda1, lambda2, lambda3;
-    barycentric_coordinates((Vector2){x, z}, (Vector2){tl.x, tl.z}, (Vector2){bl.x, bl.z}, (Vector2){tr.x, tr.z}, &lambda1, &lambda2, &lambda3);
-
-    // Check if the point lies inside the first triangle
-    if (lambda1 >= 0 && lambda2 >= 0 && lambda3 >= 0) {
-        // Interpolate the height for the first triangle
-        return lambda1 * tl.y + lambda2 * bl.y + lambda3 * tr.y;
-    }
-
-    // If the point doesn't lie inside the first triangle, check the second triangle: V3, V4, V2
-    float lambda4, lambda5, lambda6;
-    barycentric_coordinates((Vector2){x, z}, (Vector2){tr.x, tr.z}, (Vector2){br.x, br.z}, (Vector2){bl.x, bl.z}, &lambda4, &lambda5, &lambda6);
-    
-    // Interpolate the height for the second triangle
-    return lambda4 * tr.y + lambda5 * br.y + lambda6 * bl.y;
 }
 
-bool raycast_heightmap(Ray ray, Vector3 *collision, Image heightmap_image,
-                       int max_height, float terrain_res, Vector3 terrain_pos) {
-  int width = heightmap_image.width;
-  int height = heightmap_image.height;
-  Color *heightmap_data =
-      LoadImageColors(heightmap_image); // Assuming grayscale heightmap
-
-  // Ray step parameters
-  float step_size = 0.1f; // The distance to move along the ray each iteration
-                          // (adjust for precision)
-  float max_distance = 2 * width; // Maximum distance to march along the ray
-
-  Vector3 ray_pos = ray.position;
-  Vector3 ray_dir = Vector3Normalize(ray.direction); // Normalize the direction
-
-  for (float distance = 0; distance < max_distance; distance += step_size) {
-    // Move along the ray
-    ray_pos = Vector3Add(ray.position, Vector3Scale(ray_dir, distance));
-
-    // Convert current ray position to heightmap coordinates
-    float terrain_x = (ray_pos.x - terrain_pos.x) * terrain_res;
-    float terrain_z = (ray_pos.z - terrain_pos.z) * terrain_res;
-
-    // Check if we're within the bounds of the heightmap
-    if (terrain_x >= 0 && terrain_x < width && terrain_z >= 0 &&
-        terrain_z < height) {
-      // Get heightmap value at the current terrain coordinates
-      int ix = (int)terrain_x;
-      int iz = (int)terrain_z;
-      float terrainHeight =
-          GRAY_VALUE(heightmap_data[iz * width + ix]) / 255.0f * max_height +
-          terrain_pos.y;
-
-      // If the ray's y-position is below the terrain height, we've hit the
-      // terrain
-      if (ray_pos.y <= terrainHeight) {
-        UnloadImageColors(heightmap_data); // Free the heightmap colors
-        *collision = ray_pos;              // Return the collision point
-        return true;
-      }
-    }
-  }
-
-  UnloadImageColors(heightmap_data); // Free the heightmap colors
-  *collision = (Vector3){0};         // No collision found
-  return false;
+void game_unload(Game *game) {
+  chunks_unload(&game->chunks);
+  voxels_unload(&game->voxels);
+  entities_unload(&game->npcs);
 }
 
-void move_player(Player *player, Terrain *terrain, Block *blocks, int block_count, float dt, float dude_speed) {
-  float speed;
-  bool floor = false;
-
-  if (IsKeyDown(KEY_LEFT_SHIFT)) {
-    speed = dude_speed * 4;
+// wait_terrain blocks until the ground around the player is loaded, so a
+// replay sees the same terrain however fast the workers are
+void game_update(Game *game, const FrameInput *frame, bool wait_terrain, FrameTiming *timing) {
+  ChunkManager *chunks = &game->chunks;
+  VoxelWorld *voxels = &game->voxels;
+
+  // Terrain streaming
+  if (wait_terrain)
+    chunks_wait(chunks, game->camera.position);
+  else
+    chunks_update(chunks, game->camera.position);
+
+  // Player Stuff, fixed ticks and the camera drawn in between the last two
+  double t = input_clock();
+  player_input_merge(&game->input, player_input(frame));
+  timing->ticks = player_clock_advance(&game->clock, frame->dt);
+  timing->npcs = 0;
+  for (int i = 0; i < timing->ticks; i++) {
+    game->previous = game->player;
+    player_tick(&game->player, &game->input, chunks, voxels);
+    // presses and mouse movement only count once
+    game->input.toggle_jump = false;
+    game->input.look = (Vector2){0, 0};
+
+    entities_tick(&game->npcs, chunks, voxels, 1.0f / PLAYER_TICK_RATE);
+    timing->npcs += game->npcs.tick_time;
+  }
+  game->camera = player_camera_lerp(&game->previous, &game->player, player_clock_alpha(&game->clock));
+  timing->player = input_clock() - t - timing->npcs;
+
+  // Blocks
+  t = input_clock();
+  Ray ray;
+  ray.position = game->camera.position;
+  ray.direction = GetCameraForward(&game->camera);
+
+  RayCollision closest;
+  int block_voxel[3];
+  bool block_hit = blocks_raycast(voxels, ray, game->reach, &closest, block_voxel);
+  game->collided = block_hit;
+  if (game->collided) {
+    game->collision = Vector3Add(Vector3Scale(closest.normal, 2.5), closest.point);
   } else {
-    speed = dude_speed;
+    game->collided = chunks_raycast(chunks, ray, game->reach, &game->collision);
+    if (game->collided)
+      game->collision.y += 2;
   }
-  Vector3 rot = {GetMouseDelta().x * 0.1, GetMouseDelta().y * 0.1, 0};
+  timing->picking = input_clock() - t;
 
-  Vector3 dr = {(IsKeyDown(KEY_W) - IsKeyDown(KEY_S)) * speed * dt,
-                (IsKeyDown(KEY_D) - IsKeyDown(KEY_A)) * speed * dt, 0};
+  //---Input---
 
-  // Block Collsion
-  for (int i = 0; i < block_count; i++) {
-    if (!blocks[i].active)
-      continue;
-
-    // Top collision
-    Vector3 feet_pos = Vector3Add(
-        Vector3Subtract(*player->position, (Vector3){0, player->height, 0}),
-        (Vector3){0, player->vel_y * dt, 0});
-    if (CheckCollisionBoxSphere(blocks[i].bounds, feet_pos, 0.1)) {
-      floor = true;
-    }
-    if (CheckCollisionBoxSphere(
-            blocks[i].bounds,
-            Vector3Add(*player->position, (Vector3){0, player->height / 2, 0}),
-            0.1)) {
-      floor = true;
-    }
-
-    Vector3 move_vec =
-        Vector3Add(Vector3Scale(GetCameraForward(player->camera), dr.x),
-                   Vector3Scale(GetCameraRight(player->camera), dr.y));
-    Vector3 player_point =
-        Vector3Subtract(*player->position, (Vector3){0, player->height / 2, 0});
-
-    bool collision_cur = CheckCollisionBoxSphere(blocks[i].bounds, player_point,
-                                                 player->height / 2);
-    bool collision_step = CheckCollisionBoxSphere(
-        blocks[i].bounds, Vector3Add(player_point, move_vec),
-        player->height / 2);
-    // Collision on this frame
-    if (!collision_cur && collision_step) {
-      dr = Vector3Zero();
-      break;
-    }
+  t = input_clock();
+  if (frame->scroll != 0) {
+    game->fog_density = MAX(0, MIN(game->fog_density + frame->scroll * 0.05, 2.0));
   }
-
-  UpdateCameraPro(player->camera, dr, rot, 0);
-
-  // Handle Terrain collision
-  Vector3 player_pos = Vector3Transform(
-      *player->position, MatrixInvert(terrain->model->transform));
-
-    int cols = (int)(terrain->width*terrain->resolution);
-    int rows = (int)(terrain->length*terrain->resolution);
-    float mesh_y = get_terrain_height(player_pos.x, player_pos.z, terrain->mesh->vertices,
-                                    rows, cols, 1/terrain->resolution);
-    if (mesh_y != -1) {
-      float epsilon = 1; // subtract epsilon for more lenient jumping
-
-      floor = floor || (player_pos.y - player->height - epsilon <= mesh_y);
-      if (player_pos.y - player->height <= mesh_y) {
-        float y_move = mesh_y + player->height - player->position->y;
-        player->vel_y -= 100;
-        player_move_position(player, (Vector3){0, y_move, 0});
-      }
+  if (input_pressed(frame, INPUT_TEXTURE_1)) {
+    game->current_texture = 0;
+  } else if (input_pressed(frame, INPUT_TEXTURE_2)) {
+    game->current_texture = 1;
   }
 
-  char *text = floor ? "true" : "false";
-  sprintf(debug, "%s", text);
-  if (floor) {
-    player->vel_y = 0;
-  } else {
-    player->vel_y -= GRAVITY * dt;
+  for (int tool = SCULPT_RAISE; tool <= SCULPT_SMOOTH; tool++) {
+    Vector3 hit;
+    InputButton button = INPUT_RAISE + tool;
+    if (!input_down(frame, button) || !chunks_raycast(chunks, ray, game->reach, &hit))
+      continue;
+    // flatten to wherever the stroke started
+    if (input_pressed(frame, button))
+      game->flatten_height = hit.y;
+    SculptBrush brush = {tool, SCULPT_RADIUS, tool <= SCULPT_LOWER ? SCULPT_SPEED : SCULPT_RATE,
+                         game->flatten_height};
+    chunks_sculpt(chunks, &brush, hit, frame->dt);
+    break;
   }
 
-  // Jump
-  if (IsKeyPressed(KEY_J)) {
-    jump_force = jump_force == JUMP ? JUMP * 3 : JUMP;
-  }
-  if (floor && IsKeyDown(KEY_SPACE)) {
-    player->vel_y = jump_force;
-  }
+  if (input_pressed(frame, INPUT_PLACE) && game->collided) {
+    int cell[3];
+    voxels_cell(voxels, game->collision, cell);
+    voxels_set(voxels, cell[0], cell[1], cell[2], game->current_texture + 1);
 
-  player_move_position(player, (Vector3){0, player->vel_y * dt, 0});
+  } else if (block_hit && input_pressed(frame, INPUT_REMOVE)) {
+    voxels_set(voxels, block_voxel[0], block_voxel[1], block_voxel[2], VOXEL_EMPTY);
+  }
+  timing->edits = input_clock() - t;
 }
 
-int main(void) {
-  // init
-  debug = malloc(255 * sizeof(char));
-  SetTraceLogLevel(LOG_WARNING);
-  InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "EPIC MAN");
-  SetTargetFPS(144);
-
-
+void renderer_init(Renderer *r, const char *cache_dir) {
   // loading shaders
-  Shader terrain_shader = LoadShader("terrain/base.vert", "terrain/base.frag");
-  Shader block_shader = LoadShader("terrain/base.vert", "terrain/base.frag");
-  Shader sun_shader = LoadShader(NULL, "terrain/sun.frag");
-  Shader fog_shader = LoadShader(NULL, "terrain/fog.frag");
-  // tiling
-  int t1 = 20, t2 = 1;
-  SetShaderValue(terrain_shader, GetShaderLocation(terrain_shader, "tile"), &t1, SHADER_UNIFORM_INT);
-  SetShaderValue(block_shader, GetShaderLocation(block_shader, "tile"), &t2, SHADER_UNIFORM_INT);
-
-  // terrain gen
-  int width = 1200, length = 1200;
-  int max_height = width / 4;
-  const float resolution = 0.3;
-  Image image;
-  Mesh plane;
-  Model model;
+  r->terrain_shader = LoadShader(TERRAIN_RTIN ? "terrain/packed.vert" : "terrain/cdlod.vert", "terrain/base.frag");
+  // tiling, texture coords span one chunk so keep roughly one repeat per 60 units
+  int t1 = 4;
+  SetShaderValue(r->terrain_shader, GetShaderLocation(r->terrain_shader, "tile"), &t1, SHADER_UNIFORM_INT);
 
   // textures
-  image = my_perlin_image((int)(width * resolution), (int)(length * resolution),
-                          GetRandomValue(0, 10000), GetRandomValue(0, 10000), 2,
-                          2, 0.4, 6);
-
-  Image grass = LoadImage("res/tough_grass.png");
-  ImageMipmaps(&grass);
-  Texture texture = LoadTextureFromImage(grass);
-  SetTextureWrap(texture, TEXTURE_WRAP_REPEAT);
-  SetTextureFilter(texture, TEXTURE_FILTER_ANISOTROPIC_16X);
-
-  // models
-  plane = GenMeshHeightmap(image, (Vector3){width, max_height, length});
-  model = LoadModelFromMesh(plane);
-
-  model.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = texture;
-  model.materials->shader = terrain_shader;
-  model.transform = MatrixTranslate(-width / 2, 0, -length / 2);
-
-  Terrain terrain = {
-      .model = &model,
-      .mesh = &plane,
-      .width = width,
-      .length = length,
-      .height = max_height,
-      .resolution = resolution
-  };
-
-  Block blocks[1024];
-  int count = 0;
-  int current_texture = 0;
-  Texture block_textures[2] = {LoadTexture("res/floor.png"), LoadTexture("res/wall1.png")};
-  int texture_count = 2;
-  Mesh block_mesh = GenMeshCube(BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE);
-  Model block_model = LoadModelFromMesh(block_mesh);
-  block_model.materials[0].maps[MATERIAL_MAP_ALBEDO].texture = block_textures[0];
-  block_model.materials[0].shader = block_shader;
+  r->texture = cache_load_texture_mipmapped(cache_dir, "res/tough_grass.png");
+  SetTextureWrap(r->texture, TEXTURE_WRAP_REPEAT);
+  SetTextureFilter(r->texture, TEXTURE_FILTER_ANISOTROPIC_16X);
+
+  // materials
+  r->terrain_material = LoadMaterialDefault();
+  r->terrain_material.maps[MATERIAL_MAP_ALBEDO].texture = r->texture;
+  r->terrain_material.shader = r->terrain_shader;
+
+  // blocks, a layer of the texture array per texture number
+  const char *block_textures[] = {"res/floor.png", "res/wall1.png"};
+  block_renderer_init(&r->blocks, BLOCK_SIZE, block_textures, 2);
+  npc_renderer_init(&r->npcs, NPC_DRAWN);
+  render_queue_init(&r->queue);
+
+  // post processing, one pass from the scene to the screen
+  r->scene = LoadRenderTextureDepthTex(SCREEN_WIDTH, SCREEN_HEIGHT);
+  post_process_init(&r->post, POST_EFFECT_BIT(POST_SUN) | POST_EFFECT_BIT(POST_FOG));
+  Vector3 fog_color = {0.6f, 0.6f, 0.6f};
+  post_process_set(&r->post, POST_FOG_COLOR, (float *)&fog_color);
+}
 
-  Camera camera = {0};
-  camera.position = (Vector3){0.0f, max_height, -1.0f};
-  camera.target = (Vector3){0.0f, max_height, 0.0f};
-  camera.up = (Vector3){0.0f, 1.0f, 0.0f};
-  camera.fovy = 60.0f;
-  camera.projection = CAMERA_PERSPECTIVE;
+void renderer_unload(Renderer *r) {
+  block_renderer_unload(&r->blocks);
+  npc_renderer_unload(&r->npcs);
+  render_queue_unload(&r->queue);
+  post_process_unload(&r->post);
+}
 
-  Player player = {0};
-  player.camera = &camera;
-  player.height = 8;
-  player.position = &camera.position;
+void renderer_draw(Renderer *r, Game *game) {
+  Camera camera = game->camera;
+  ChunkManager *chunks = &game->chunks;
+
+  BeginDrawing();
+  {
+    BeginTextureMode(r->scene);
+    ClearBackground(SKYBLUE);
+    // ---3D----
+    BeginMode3D(camera);
+
+    Frustum frustum = frustum_from_camera(camera, (float)SCREEN_WIDTH / SCREEN_HEIGHT);
+    chunks_draw(chunks, &r->queue, r->terrain_material, camera.position, &frustum);
+
+    block_renderer_update(&r->blocks, &game->voxels);
+    block_renderer_draw(&r->blocks, &r->queue, &game->voxels, &frustum, camera.position);
+    npc_renderer_draw(&r->npcs, &r->queue, &game->npcs, camera.position, NPC_DRAW_RANGE);
+    render_queue_flush(&r->queue);
+    EndMode3D();
+    EndTextureMode();
+
+    // Post process
+    post_process_set_camera(&r->post, camera, (float)SCREEN_WIDTH / SCREEN_HEIGHT);
+    post_process_set(&r->post, POST_FOG_DENSITY, &game->fog_density);
+    post_process_draw(&r->post, r->scene);
+
+    // ---2D---
+    DrawFPS(10, 10);
+    // Text
+    DrawText(TextFormat("Position (%.1f, %.1f, %.1f)", game->player.camera.position.x,
+                        game->player.camera.position.z, game->player.camera.position.y),
+             10, 40, 20, BLACK);
+    DrawText(TextFormat("ON FLOOR: %s, tick %ld", game->player.on_floor ? "true" : "false", game->clock.ticks), 10,
+             70, 20, BLACK);
+    DrawText(TextFormat("Raycast: (%.1f, %.1f, %.1f)", game->collision.x,
+                        game->collision.y, game->collision.z),
+             10, 100, 20, BLACK);
+    DrawText(TextFormat("Blocks: %d, %d draw calls, %d triangles (%d as cubes), %d remeshing, %.1f MB",
+                        game->voxels.blocks, r->blocks.draw_calls, r->blocks.triangles, game->voxels.blocks * 12,
+                        r->blocks.pending, (game->voxels.bytes + block_renderer_bytes(&r->blocks)) / (1024.0 * 1024.0)),
+             10, 130, 20, BLACK);
+    DrawText(TextFormat("Chunks: %d loaded, %d pending, %.1f MB", chunks->stats.loaded,
+                        chunks->stats.pending, chunks->stats.bytes / (1024.0 * 1024.0)),
+             10, 160, 20, BLACK);
+    DrawText(TextFormat("Terrain: %d nodes, %d triangles, %d culled", chunks->stats.nodes, chunks->stats.triangles,
+                        chunks->stats.culled),
+             10, 190, 20, BLACK);
+    DrawText(TextFormat("NPCs: %d (%d awake, %d drawn), %.2f ms per tick", game->npcs.count, game->npcs.awake,
+                        r->npcs.drawn, game->npcs.tick_time * 1e3),
+             10, 220, 20, BLACK);
+    const RenderStats *draws = &r->queue.stats;
+    DrawText(TextFormat("Draws: %d, binds %d shader %d texture %d vao, %d uniforms, %d skipped", draws->commands,
+                        draws->shader_binds, draws->texture_binds, draws->vao_binds, draws->uniform_sets,
+                        draws->skipped),
+             10, 250, 20, BLACK);
+
+    DrawCircle(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 2, BLACK);
+
+    float rec_w = SCREEN_WIDTH / 6.0;
+    Rectangle fog_rect = {5, SCREEN_HEIGHT - 30, rec_w * (game->fog_density / 2.0), 20};
+    DrawRectangleRounded(fog_rect, 3, 6, RED);
+    fog_rect.width = rec_w;
+    DrawRectangleRoundedLines(fog_rect, 5, 5, BLACK);
+  }
+  EndDrawing();
+}
 
-  // frame buffers
-  RenderTexture fbo1 = LoadRenderTextureDepthTex(SCREEN_WIDTH, SCREEN_HEIGHT);
-  RenderTexture fbo2 = LoadRenderTextureDepthTex(SCREEN_WIDTH, SCREEN_HEIGHT);
+// prints one line per frame and the totals, as csv with # comments like the
+// microbenchmarks
+static void timing_report(const FrameTiming *timing, long frame, const FrameInput *input) {
+  if (frame == 0)
+    printf("frame,dt_ms,ticks,player_us,npcs_us,picking_us,edits_us\n");
+  printf("%ld,%.3f,%d,%.2f,%.2f,%.2f,%.2f\n", frame, input->dt * 1e3, timing->ticks, timing->player * 1e6,
+         timing->npcs * 1e6, timing->picking * 1e6, timing->edits * 1e6);
+}
 
-  float fog_density = 0.4f;
-  Vector3 fog_color = {0.6f, 0.6f, 0.6f};
-  SetShaderValue(fog_shader, GetShaderLocation(fog_shader, "fogColor"), (float *)&fog_color, SHADER_UNIFORM_VEC3);
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s                            play\n"
+          "       %s --record FILE              play and log the input of every frame\n"
+          "       %s --replay FILE [--headless] play a log back as fast as possible, per frame\n"
+          "                                      timings on stdout. headless runs without a window\n",
+          name, name, name);
+}
 
-  DisableCursor();
-  const float dude_speed = 10;
-  float speed;
-  while (!WindowShouldClose()) {
-    float dt = GetFrameTime();
-
-    // Player Stuff
-    move_player(&player, &terrain, blocks, count, dt, dude_speed);
-
-    // Blocks
-    Ray ray;
-    ray.position = camera.position;
-    ray.direction = GetCameraForward(&camera);
-
-    Vector3 collision;
-    bool collided = false;
-    int block_index = -1;
-
-    RayCollision closest = {0};
-    for (int i = 0; i < count; i++) {
-      if (!blocks[i].active)
-        continue;
-
-      RayCollision ray_col = GetRayCollisionBox(ray, blocks[i].bounds);
-      if (ray_col.hit) {
-        if (!collided) {
-          collided = true;
-          closest = ray_col;
-          block_index = i;
-          continue;
-        }
-        float v1 = Vector3Distance(*player.position, closest.point);
-        float v2 = Vector3Distance(*player.position, ray_col.point);
-        if (v2 < v1) {
-          closest = ray_col;
-          block_index = i;
-        }
-      }
-    }
-    if (collided) {
-      collision = Vector3Add(Vector3Scale(closest.normal, 2.5), closest.point);
+int main(int argc, char **argv) {
+  const char *record = NULL, *replay = NULL;
+  bool headless = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+      record = argv[++i];
+    } else if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+      replay = argv[++i];
+    } else if (!strcmp(argv[i], "--headless")) {
+      headless = true;
     } else {
-      collided = raycast_heightmap(ray, &collision, image, max_height,
-                                   terrain.resolution,
-                                   (Vector3){-width / 2, 0, -length / 2});
-      if (collided)
-        collision.y += 2;
+      usage(argv[0]);
+      return 1;
     }
+  }
+  if ((headless && !replay) || (record && replay)) {
+    usage(argv[0]);
+    return 1;
+  }
 
-    //---Input---
-
-    float scroll = GetMouseWheelMove();
-    if (scroll != 0) {
-      fog_density = MAX(0, MIN(fog_density + scroll * 0.05, 2.0));
-    }
-    if (IsKeyPressed(KEY_ONE)) {
-      current_texture = 0;
-    } else if (IsKeyPressed(KEY_TWO)) {
-      current_texture = 1;
-    }
+  InputLog log = {0};
+  if ((record && !input_log_record(&log, record)) || (replay && !input_log_replay(&log, replay)))
+    return 1;
 
-    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && collided) {
-      BoundingBox bounds = {
-          Vector3Subtract(collision, (Vector3){BLOCK_SIZE / 2, BLOCK_SIZE / 2, BLOCK_SIZE / 2}),
-          Vector3Add(collision, (Vector3){BLOCK_SIZE / 2, BLOCK_SIZE / 2, BLOCK_SIZE / 2})
-      };
-      blocks[count++] = (Block){collision, bounds, current_texture, true};
+  // init
+  SetTraceLogLevel(LOG_WARNING);
+  if (!headless) {
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "EPIC MAN");
+    // replays run as fast as they can
+    SetTargetFPS(replay ? 0 : 144);
+  }
 
-    } else if (collided && block_index != -1 && IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)) {
-      printf("remove %d\n", block_index);
-      blocks[block_index].active = false;
+  // terrain tiles and textures share one cache directory
+  const char *cache_dir = cache_init(CACHE_DIR) ? CACHE_DIR : NULL;
+  Game game;
+  game_init(&game, cache_dir, headless);
+  Renderer renderer;
+  if (!headless)
+    renderer_init(&renderer, cache_dir);
+
+  if (!replay)
+    DisableCursor();
+  FrameTiming total = {0}, worst = {0};
+  double start = input_clock();
+  while (headless || !WindowShouldClose()) {
+    FrameInput frame;
+    if (replay) {
+      if (!input_log_read(&log, &frame))
+        break;
+    } else {
+      frame = input_poll();
+      if (record)
+        input_log_write(&log, &frame);
     }
 
-    BeginDrawing();
-    {
-      BeginTextureMode(fbo1);
-      ClearBackground(SKYBLUE);
-      // ---3D----
-      BeginMode3D(camera);
-
-      DrawModel(model, Vector3Zero(), 1, WHITE);
-
-      for (int i = 0; i < count; i++) {
-        if (blocks[i].active) {
-          block_model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture =
-              block_textures[blocks[i].texture_id];
-          DrawModel(block_model, blocks[i].pos, 1, WHITE);
-        }
-      }
-      EndMode3D();
-      EndTextureMode();
-
-      // Post process
-      Rectangle rec = {0, 0, fbo1.texture.width, -fbo1.texture.height};
-
-      // sun
-      SetShaderValueMatrix(sun_shader, GetShaderLocation(sun_shader, "view"), GetCameraMatrix(camera));
-      SetShaderValueMatrix(sun_shader, GetShaderLocation(sun_shader, "projection"),
-                           GetCameraProjectionMatrix(&camera, (float)SCREEN_WIDTH / SCREEN_HEIGHT));
-      BeginTextureMode(fbo2);
-      BeginShaderMode(sun_shader);
-
-      DrawTextureRec(fbo1.texture, rec, (Vector2){0, 0}, WHITE);
-
-      EndShaderMode();
-      EndTextureMode();
-
-      // fog
-      SetShaderValue(fog_shader, GetShaderLocation(fog_shader, "fogDensity"), &fog_density, SHADER_UNIFORM_FLOAT);
-      BeginTextureMode(fbo1);
-      BeginShaderMode(fog_shader);
-
-      SetShaderValueTexture(fog_shader, GetShaderLocation(fog_shader, "depthTexture"), fbo1.depth);
-      DrawTextureRec(fbo2.texture, rec, (Vector2){0, 0}, WHITE);
-
-      EndShaderMode();
-      EndTextureMode();
-
-      DrawTextureRec(fbo1.texture, rec, (Vector2){0, 0}, WHITE);
-
-      // ---2D---
-      DrawFPS(10, 10);
-      // Text
-      DrawText(TextFormat("Position (%.1f, %.1f, %.1f)", player.position->x,
-                          player.position->z, player.position->y),
-               10, 40, 20, BLACK);
-      DrawText(TextFormat("ON FLOOR: %s", debug), 10, 70, 20, BLACK);
-      DrawText(TextFormat("Raycast: (%.1f, %.1f, %.1f)", collision.x,
-                          collision.y, collision.z),
-               10, 100, 20, BLACK);
-      DrawText(TextFormat("Blocks: %d", count), 10, 130, 20, BLACK);
-
-      DrawCircle(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 2, BLACK);
-      float texture_scale = 200.0 / (width * resolution);
-
-      float rec_w = SCREEN_WIDTH / 6.0;
-      Rectangle fog_rect = {5, SCREEN_HEIGHT - 30, rec_w * (fog_density / 2.0), 20};
-      DrawRectangleRounded(fog_rect, 3, 6, RED);
-      fog_rect.width = rec_w;
-      DrawRectangleRoundedLines(fog_rect, 5, 5, BLACK);
+    FrameTiming timing;
+    game_update(&game, &frame, replay, &timing);
+    if (replay) {
+      timing_report(&timing, log.frames - 1, &frame);
+      total.ticks += timing.ticks;
+      total.player += timing.player;
+      total.npcs += timing.npcs;
+      total.picking += timing.picking;
+      total.edits += timing.edits;
+      worst.player = MAX(worst.player, timing.player);
+      worst.npcs = MAX(worst.npcs, timing.npcs);
+      worst.picking = MAX(worst.picking, timing.picking);
+      worst.edits = MAX(worst.edits, timing.edits);
     }
-    EndDrawing();
+
+    if (!headless)
+      renderer_draw(&renderer, &game);
+    // the renderer has seen this frame's edits
+    voxels_clear_dirty(&game.voxels);
+  }
+
+  if (replay && log.frames) {
+    double n = log.frames;
+    printf("# %ld frames, %d ticks in %.3f s\n", log.frames, total.ticks, input_clock() - start);
+    printf("# mean us: player %.2f, npcs %.2f, picking %.2f, edits %.2f\n", total.player / n * 1e6,
+           total.npcs / n * 1e6, total.picking / n * 1e6, total.edits / n * 1e6);
+    printf("# max us: player %.2f, npcs %.2f, picking %.2f, edits %.2f\n", worst.player * 1e6, worst.npcs * 1e6,
+           worst.picking * 1e6, worst.edits * 1e6);
+    Vector3 p = game.player.camera.position;
+    printf("# player at (%.9g, %.9g, %.9g), vel_y %.9g, %d blocks\n", p.x, p.y, p.z, game.player.vel_y,
+           game.voxels.blocks);
+    double npc_y = 0;
+    for (int i = 0; i < game.npcs.count; i++)
+      npc_y += game.npcs.y[i];
+    printf("# %d npcs, %d awake, mean height %.9g\n", game.npcs.count, game.npcs.awake, npc_y / game.npcs.count);
   }
+  input_log_close(&log);
 
-  UnloadModel(model);
-  CloseWindow();
+  if (!headless)
+    renderer_unload(&renderer);
+  game_unload(&game);
+  if (!headless)
+    CloseWindow();
 
   return 0;
 }
@@ -0,0 +1,589 @@
+#include "noise.h"
+
+#include <pthread.h>
+
+// raylib already exports the stb_perlin functions, rename ours so we only
+// get the permutation tables out of it
+#define stb_perlin_noise3_internal noise_stb_noise3_internal
+#define stb_perlin_noise3 noise_stb_noise3
+#define stb_perlin_noise3_seed noise_stb_noise3_seed
+#define stb_perlin_ridge_noise3 noise_stb_ridge_noise3
+#define stb_perlin_fbm_noise3 noise_stb_fbm_noise3
+#define stb_perlin_turbulence_noise3 noise_stb_turbulence_noise3
+#define stb_perlin_noise3_wrap_nonpow2 noise_stb_noise3_wrap_nonpow2
+#define STB_PERLIN_IMPLEMENTATION
+#include "../lib/stb_perlin.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NOISE_X86
+#endif
+
+#define INLINE static inline __attribute__((always_inline))
+#define EASE(a) ((((a) * 6 - 15) * (a) + 10) * (a) * (a) * (a))
+#define EASE_DERIV(a) ((((a) * 30 - 60) * (a) + 30) * (a) * (a))
+
+// int copies of the stb tables so avx2 can gather from them
+static int perm[512];
+static int grad_idx[512];
+static const float basis_x[12] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0};
+static const float basis_y[12] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1};
+static const float basis_z[12] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1};
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void init_tables(void) {
+  for (int i = 0; i < 512; i++) {
+    perm[i] = stb__perlin_randtab[i];
+    grad_idx[i] = stb__perlin_randtab_grad_idx[i];
+  }
+}
+
+// y only changes per row so its lattice work is done once per octave
+typedef struct RowY {
+  float fy, fy1, v, dv;
+  int y0, y1;
+} RowY;
+
+INLINE RowY row_y(const FbmOctave *o, float y) {
+  float yf = y * o->frequency;
+  int py = stb__perlin_fastfloor(yf);
+  RowY r;
+  r.fy = yf - py;
+  r.fy1 = r.fy - 1;
+  r.v = EASE(r.fy);
+  r.dv = EASE_DERIV(r.fy);
+  r.y0 = py & 255;
+  r.y1 = (py + 1) & 255;
+  return r;
+}
+
+// n = lerp over z of the two gradients hashed from r
+INLINE float corner(const FbmOctave *o, int r, float x, float y) {
+  int g0 = grad_idx[r + o->z0], g1 = grad_idx[r + o->z1];
+  float n0 = basis_x[g0] * x + basis_y[g0] * y + o->z_low[g0];
+  float n1 = basis_x[g1] * x + basis_y[g1] * y + o->z_high[g1];
+  return n0 + (n1 - n0) * o->w;
+}
+
+float fbm_noise2(const Fbm *fbm, float x, float y) {
+  float sum = 0.0f;
+  for (int i = 0; i < fbm->octaves; i++) {
+    const FbmOctave *o = &fbm->octave[i];
+    RowY ry = row_y(o, y);
+    float xf = x * o->frequency;
+    int px = stb__perlin_fastfloor(xf);
+    float fx = xf - px, fx1 = fx - 1;
+    float u = EASE(fx);
+
+    int r0 = perm[(px & 255) + o->seed];
+    int r1 = perm[((px + 1) & 255) + o->seed];
+
+    float n00 = corner(o, perm[r0 + ry.y0], fx, ry.fy);
+    float n01 = corner(o, perm[r0 + ry.y1], fx, ry.fy1);
+    float n10 = corner(o, perm[r1 + ry.y0], fx1, ry.fy);
+    float n11 = corner(o, perm[r1 + ry.y1], fx1, ry.fy1);
+
+    float n0 = n00 + (n01 - n00) * ry.v;
+    float n1 = n10 + (n11 - n10) * ry.v;
+    sum += (n0 + (n1 - n0) * u) * o->amplitude;
+  }
+  return sum;
+}
+
+// corner plus its x and y derivatives, the value is computed exactly as in corner()
+INLINE float corner_grad(const FbmOctave *o, int r, float x, float y, float *dx, float *dy) {
+  int g0 = grad_idx[r + o->z0], g1 = grad_idx[r + o->z1];
+  float n0 = basis_x[g0] * x + basis_y[g0] * y + o->z_low[g0];
+  float n1 = basis_x[g1] * x + basis_y[g1] * y + o->z_high[g1];
+  *dx = basis_x[g0] + (basis_x[g1] - basis_x[g0]) * o->w;
+  *dy = basis_y[g0] + (basis_y[g1] - basis_y[g0]) * o->w;
+  return n0 + (n1 - n0) * o->w;
+}
+
+float fbm_noise2_grad(const Fbm *fbm, float x, float y, float *dx, float *dy) {
+  float sum = 0.0f, sum_dx = 0.0f, sum_dy = 0.0f;
+  for (int i = 0; i < fbm->octaves; i++) {
+    const FbmOctave *o = &fbm->octave[i];
+    RowY ry = row_y(o, y);
+    float xf = x * o->frequency;
+    int px = stb__perlin_fastfloor(xf);
+    float fx = xf - px, fx1 = fx - 1;
+    float u = EASE(fx), du = EASE_DERIV(fx);
+
+    int r0 = perm[(px & 255) + o->seed];
+    int r1 = perm[((px + 1) & 255) + o->seed];
+
+    float x00, y00, x01, y01, x10, y10, x11, y11;
+    float n00 = corner_grad(o, perm[r0 + ry.y0], fx, ry.fy, &x00, &y00);
+    float n01 = corner_grad(o, perm[r0 + ry.y1], fx, ry.fy1, &x01, &y01);
+    float n10 = corner_grad(o, perm[r1 + ry.y0], fx1, ry.fy, &x10, &y10);
+    float n11 = corner_grad(o, perm[r1 + ry.y1], fx1, ry.fy1, &x11, &y11);
+
+    float n0 = n00 + (n01 - n00) * ry.v;
+    float n1 = n10 + (n11 - n10) * ry.v;
+    sum += (n0 + (n1 - n0) * u) * o->amplitude;
+
+    // product rule through both lerps, then the chain rule for the frequency
+    float n0x = x00 + (x01 - x00) * ry.v, n1x = x10 + (x11 - x10) * ry.v;
+    float n0y = y00 + (y01 - y00) * ry.v + (n01 - n00) * ry.dv;
+    float n1y = y10 + (y11 - y10) * ry.v + (n11 - n10) * ry.dv;
+    float k = o->amplitude * o->frequency;
+    sum_dx += (n0x + (n1x - n0x) * u + (n1 - n0) * du) * k;
+    sum_dy += (n0y + (n1y - n0y) * u) * k;
+  }
+  *dx = sum_dx;
+  *dy = sum_dy;
+  return sum;
+}
+
+static void fbm_row_scalar(const Fbm *fbm, const float *xs, float y, float *out, int count) {
+  for (int i = 0; i < count; i++)
+    out[i] = fbm_noise2(fbm, xs[i], y);
+}
+
+static void fbm_row_grad_scalar(const Fbm *fbm, const float *xs, float y, float *out, float *dx, float *dy,
+                                int count) {
+  for (int i = 0; i < count; i++)
+    out[i] = fbm_noise2_grad(fbm, xs[i], y, &dx[i], &dy[i]);
+}
+
+#ifdef NOISE_X86
+
+//---SSE2 (4 pixels)---
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 INLINE __m128i floor4(__m128 a) {
+  __m128i ai = _mm_cvttps_epi32(a);
+  __m128 lt = _mm_cmplt_ps(a, _mm_cvtepi32_ps(ai));
+  return _mm_add_epi32(ai, _mm_castps_si128(lt)); // lt is -1 where true
+}
+
+SSE2 INLINE __m128 ease4(__m128 a) {
+  __m128 t = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(a, _mm_set1_ps(6)), _mm_set1_ps(15)), a), _mm_set1_ps(10));
+  return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, a), a), a);
+}
+
+SSE2 INLINE __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+  return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+// no gathers on sse2, hash per lane and do the math 4 wide
+SSE2 INLINE __m128 corner4(const FbmOctave *o, const int *r, __m128 x, __m128 y) {
+  float gx0[4], gy0[4], gz0[4], gx1[4], gy1[4], gz1[4];
+  for (int l = 0; l < 4; l++) {
+    int g0 = grad_idx[r[l] + o->z0], g1 = grad_idx[r[l] + o->z1];
+    gx0[l] = basis_x[g0]; gy0[l] = basis_y[g0]; gz0[l] = o->z_low[g0];
+    gx1[l] = basis_x[g1]; gy1[l] = basis_y[g1]; gz1[l] = o->z_high[g1];
+  }
+  __m128 n0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx0), x), _mm_mul_ps(_mm_loadu_ps(gy0), y)), _mm_loadu_ps(gz0));
+  __m128 n1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx1), x), _mm_mul_ps(_mm_loadu_ps(gy1), y)), _mm_loadu_ps(gz1));
+  return lerp4(n0, n1, _mm_set1_ps(o->w));
+}
+
+SSE2 INLINE __m128 fbm4(const Fbm *fbm, __m128 x, const RowY *rows, int octaves) {
+  __m128 sum = _mm_setzero_ps();
+#pragma GCC unroll 8
+  for (int i = 0; i < octaves; i++) {
+    const FbmOctave *o = &fbm->octave[i];
+    const RowY *ry = &rows[i];
+    __m128 xf = _mm_mul_ps(x, _mm_set1_ps(o->frequency));
+    __m128i px = floor4(xf);
+    __m128 fx = _mm_sub_ps(xf, _mm_cvtepi32_ps(px));
+    __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1));
+    __m128 u = ease4(fx);
+
+    int x0[4], x1[4];
+    _mm_storeu_si128((__m128i *)x0, _mm_and_si128(px, _mm_set1_epi32(255)));
+    _mm_storeu_si128((__m128i *)x1, _mm_and_si128(_mm_add_epi32(px, _mm_set1_epi32(1)), _mm_set1_epi32(255)));
+    int r00[4], r01[4], r10[4], r11[4];
+    for (int l = 0; l < 4; l++) {
+      int r0 = perm[x0[l] + o->seed], r1 = perm[x1[l] + o->seed];
+      r00[l] = perm[r0 + ry->y0]; r01[l] = perm[r0 + ry->y1];
+      r10[l] = perm[r1 + ry->y0]; r11[l] = perm[r1 + ry->y1];
+    }
+
+    __m128 fy = _mm_set1_ps(ry->fy), fy1 = _mm_set1_ps(ry->fy1), v = _mm_set1_ps(ry->v);
+    __m128 n0 = lerp4(corner4(o, r00, fx, fy), corner4(o, r01, fx, fy1), v);
+    __m128 n1 = lerp4(corner4(o, r10, fx1, fy), corner4(o, r11, fx1, fy1), v);
+    sum = _mm_add_ps(sum, _mm_mul_ps(lerp4(n0, n1, u), _mm_set1_ps(o->amplitude)));
+  }
+  return sum;
+}
+
+typedef struct Grad4 {
+  __m128 n, dx, dy;
+} Grad4;
+
+SSE2 INLINE Grad4 corner4_grad(const FbmOctave *o, const int *r, __m128 x, __m128 y) {
+  float gx0[4], gy0[4], gz0[4], gx1[4], gy1[4], gz1[4];
+  for (int l = 0; l < 4; l++) {
+    int g0 = grad_idx[r[l] + o->z0], g1 = grad_idx[r[l] + o->z1];
+    gx0[l] = basis_x[g0]; gy0[l] = basis_y[g0]; gz0[l] = o->z_low[g0];
+    gx1[l] = basis_x[g1]; gy1[l] = basis_y[g1]; gz1[l] = o->z_high[g1];
+  }
+  __m128 x0 = _mm_loadu_ps(gx0), y0 = _mm_loadu_ps(gy0), x1 = _mm_loadu_ps(gx1), y1 = _mm_loadu_ps(gy1);
+  __m128 n0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x), _mm_mul_ps(y0, y)), _mm_loadu_ps(gz0));
+  __m128 n1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x1, x), _mm_mul_ps(y1, y)), _mm_loadu_ps(gz1));
+  __m128 w = _mm_set1_ps(o->w);
+  return (Grad4){lerp4(n0, n1, w), lerp4(x0, x1, w), lerp4(y0, y1, w)};
+}
+
+SSE2 INLINE Grad4 fbm4_grad(const Fbm *fbm, __m128 x, const RowY *rows, int octaves) {
+  Grad4 sum = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+#pragma GCC unroll 8
+  for (int i = 0; i < octaves; i++) {
+    const FbmOctave *o = &fbm->octave[i];
+    const RowY *ry = &rows[i];
+    __m128 xf = _mm_mul_ps(x, _mm_set1_ps(o->frequency));
+    __m128i px = floor4(xf);
+    __m128 fx = _mm_sub_ps(xf, _mm_cvtepi32_ps(px));
+    __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1));
+    __m128 u = ease4(fx);
+    __m128 du = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(fx, _mm_set1_ps(30)), _mm_set1_ps(60)), fx),
+                                      _mm_set1_ps(30)), _mm_mul_ps(fx, fx));
+
+    int x0[4], x1[4];
+    _mm_storeu_si128((__m128i *)x0, _mm_and_si128(px, _mm_set1_epi32(255)));
+    _mm_storeu_si128((__m128i *)x1, _mm_and_si128(_mm_add_epi32(px, _mm_set1_epi32(1)), _mm_set1_epi32(255)));
+    int r00[4], r01[4], r10[4], r11[4];
+    for (int l = 0; l < 4; l++) {
+      int r0 = perm[x0[l] + o->seed], r1 = perm[x1[l] + o->seed];
+      r00[l] = perm[r0 + ry->y0]; r01[l] = perm[r0 + ry->y1];
+      r10[l] = perm[r1 + ry->y0]; r11[l] = perm[r1 + ry->y1];
+    }
+
+    __m128 fy = _mm_set1_ps(ry->fy), fy1 = _mm_set1_ps(ry->fy1), v = _mm_set1_ps(ry->v), dv = _mm_set1_ps(ry->dv);
+    Grad4 c00 = corner4_grad(o, r00, fx, fy), c01 = corner4_grad(o, r01, fx, fy1);
+    Grad4 c10 = corner4_grad(o, r10, fx1, fy), c11 = corner4_grad(o, r11, fx1, fy1);
+    __m128 n0 = lerp4(c00.n, c01.n, v);
+    __m128 n1 = lerp4(c10.n, c11.n, v);
+    __m128 amplitude = _mm_set1_ps(o->amplitude);
+    sum.n = _mm_add_ps(sum.n, _mm_mul_ps(lerp4(n0, n1, u), amplitude));
+
+    __m128 n0x = lerp4(c00.dx, c01.dx, v), n1x = lerp4(c10.dx, c11.dx, v);
+    __m128 n0y = _mm_add_ps(lerp4(c00.dy, c01.dy, v), _mm_mul_ps(_mm_sub_ps(c01.n, c00.n), dv));
+    __m128 n1y = _mm_add_ps(lerp4(c10.dy, c11.dy, v), _mm_mul_ps(_mm_sub_ps(c11.n, c10.n), dv));
+    __m128 k = _mm_set1_ps(o->amplitude * o->frequency);
+    sum.dx = _mm_add_ps(sum.dx, _mm_mul_ps(_mm_add_ps(lerp4(n0x, n1x, u), _mm_mul_ps(_mm_sub_ps(n1, n0), du)), k));
+    sum.dy = _mm_add_ps(sum.dy, _mm_mul_ps(lerp4(n0y, n1y, u), k));
+  }
+  return sum;
+}
+
+SSE2 INLINE void fbm_row_sse2_impl(const Fbm *fbm, const float *xs, float y, float *out, int count, int octaves) {
+  RowY rows[FBM_MAX_OCTAVES];
+  for (int i = 0; i < octaves; i++)
+    rows[i] = row_y(&fbm->octave[i], y);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+    _mm_storeu_ps(out + i, fbm4(fbm, _mm_loadu_ps(xs + i), rows, octaves));
+  for (; i < count; i++)
+    out[i] = fbm_noise2(fbm, xs[i], y);
+}
+
+SSE2 INLINE void fbm_row_grad_sse2_impl(const Fbm *fbm, const float *xs, float y, float *out, float *dx, float *dy,
+                                        int count, int octaves) {
+  RowY rows[FBM_MAX_OCTAVES];
+  for (int i = 0; i < octaves; i++)
+    rows[i] = row_y(&fbm->octave[i], y);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Grad4 g = fbm4_grad(fbm, _mm_loadu_ps(xs + i), rows, octaves);
+    _mm_storeu_ps(out + i, g.n);
+    _mm_storeu_ps(dx + i, g.dx);
+    _mm_storeu_ps(dy + i, g.dy);
+  }
+  for (; i < count; i++)
+    out[i] = fbm_noise2_grad(fbm, xs[i], y, &dx[i], &dy[i]);
+}
+
+//---AVX2 (8 pixels)---
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 INLINE __m256i floor8(__m256 a) {
+  __m256i ai = _mm256_cvttps_epi32(a);
+  __m256 lt = _mm256_cmp_ps(a, _mm256_cvtepi32_ps(ai), _CMP_LT_OQ);
+  return _mm256_add_epi32(ai, _mm256_castps_si256(lt));
+}
+
+AVX2 INLINE __m256 ease8(__m256 a) {
+  __m256 t = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(a, _mm256_set1_ps(6)), _mm256_set1_ps(15)), a), _mm256_set1_ps(10));
+  return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, a), a), a);
+}
+
+AVX2 INLINE __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+  return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+}
+
+// 12 entry table lookup done in registers, the basis tables are too small
+// to be worth a gather
+typedef struct Lut12 {
+  __m256 lo, hi;
+} Lut12;
+
+AVX2 INLINE Lut12 lut12(const float *tab) {
+  float hi[8] = {tab[8], tab[9], tab[10], tab[11]};
+  return (Lut12){_mm256_loadu_ps(tab), _mm256_loadu_ps(hi)};
+}
+
+AVX2 INLINE __m256 lookup12(Lut12 t, __m256i g) {
+  __m256 is_hi = _mm256_castsi256_ps(_mm256_cmpgt_epi32(g, _mm256_set1_epi32(7)));
+  return _mm256_blendv_ps(_mm256_permutevar8x32_ps(t.lo, g), _mm256_permutevar8x32_ps(t.hi, g), is_hi);
+}
+
+typedef struct OctaveLuts {
+  Lut12 x, y, z_low, z_high;
+} OctaveLuts;
+
+AVX2 INLINE __m256 grad8(Lut12 gz_tab, const OctaveLuts *l, __m256i g, __m256 x, __m256 y) {
+  __m256 gx = lookup12(l->x, g);
+  __m256 gy = lookup12(l->y, g);
+  __m256 gz = lookup12(gz_tab, g);
+  return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, x), _mm256_mul_ps(gy, y)), gz);
+}
+
+AVX2 INLINE __m256 corner8(const FbmOctave *o, const OctaveLuts *l, __m256i r, __m256 x, __m256 y) {
+  __m256i g0 = _mm256_i32gather_epi32(grad_idx, _mm256_add_epi32(r, _mm256_set1_epi32(o->z0)), 4);
+  __m256i g1 = _mm256_i32gather_epi32(grad_idx, _mm256_add_epi32(r, _mm256_set1_epi32(o->z1)), 4);
+  return lerp8(grad8(l->z_low, l, g0, x, y), grad8(l->z_high, l, g1, x, y), _mm256_set1_ps(o->w));
+}
+
+AVX2 INLINE __m256 fbm8(const Fbm *fbm, __m256 x, const RowY *rows, int octaves) {
+  __m256 sum = _mm256_setzero_ps();
+  __m256i mask = _mm256_set1_epi32(255);
+#pragma GCC unroll 8
+  for (int i = 0; i < octaves; i++) {
+    const FbmOctave *o = &fbm->octave[i];
+    const RowY *ry = &rows[i];
+    OctaveLuts l = {lut12(basis_x), lut12(basis_y), lut12(o->z_low), lut12(o->z_high)};
+    __m256 xf = _mm256_mul_ps(x, _mm256_set1_ps(o->frequency));
+    __m256i px = floor8(xf);
+    __m256 fx = _mm256_sub_ps(xf, _mm256_cvtepi32_ps(px));
+    __m256 fx1 = _mm256_sub_ps(fx, _mm256_set1_ps(1));
+    __m256 u = ease8(fx);
+
+    __m256i seed = _mm256_set1_epi32(o->seed);
+    __m256i x0 = _mm256_add_epi32(_mm256_and_si256(px, mask), seed);
+    __m256i x1 = _mm256_add_epi32(_mm256_and_si256(_mm256_add_epi32(px, _mm256_set1_epi32(1)), mask), seed);
+    __m256i r0 = _mm256_i32gather_epi32(perm, x0, 4);
+    __m256i r1 = _mm256_i32gather_epi32(perm, x1, 4);
+    __m256i y0 = _mm256_set1_epi32(ry->y0), y1 = _mm256_set1_epi32(ry->y1);
+    __m256i r00 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r0, y0), 4);
+    __m256i r01 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r0, y1), 4);
+    __m256i r10 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r1, y0), 4);
+    __m256i r11 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r1, y1), 4);
+
+    __m256 fy = _mm256_set1_ps(ry->fy), fy1 = _mm256_set1_ps(ry->fy1), v = _mm256_set1_ps(ry->v);
+    __m256 n0 = lerp8(corner8(o, &l, r00, fx, fy), corner8(o, &l, r01, fx, fy1), v);
+    __m256 n1 = lerp8(corner8(o, &l, r10, fx1, fy), corner8(o, &l, r11, fx1, fy1), v);
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(lerp8(n0, n1, u), _mm256_set1_ps(o->amplitude)));
+  }
+  return sum;
+}
+
+typedef struct Grad8 {
+  __m256 n, dx, dy;
+} Grad8;
+
+AVX2 INLINE Grad8 corner8_grad(const FbmOctave *o, const OctaveLuts *l, __m256i r, __m256 x, __m256 y) {
+  __m256i g0 = _mm256_i32gather_epi32(grad_idx, _mm256_add_epi32(r, _mm256_set1_epi32(o->z0)), 4);
+  __m256i g1 = _mm256_i32gather_epi32(grad_idx, _mm256_add_epi32(r, _mm256_set1_epi32(o->z1)), 4);
+  __m256 x0 = lookup12(l->x, g0), y0 = lookup12(l->y, g0);
+  __m256 x1 = lookup12(l->x, g1), y1 = lookup12(l->y, g1);
+  __m256 n0 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x0, x), _mm256_mul_ps(y0, y)), lookup12(l->z_low, g0));
+  __m256 n1 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x1, x), _mm256_mul_ps(y1, y)), lookup12(l->z_high, g1));
+  __m256 w = _mm256_set1_ps(o->w);
+  return (Grad8){lerp8(n0, n1, w), lerp8(x0, x1, w), lerp8(y0, y1, w)};
+}
+
+AVX2 INLINE Grad8 fbm8_grad(const Fbm *fbm, __m256 x, const RowY *rows, int octaves) {
+  Grad8 sum = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+  __m256i mask = _mm256_set1_epi32(255);
+#pragma GCC unroll 8
+  for (int i = 0; i < octaves; i++) {
+    const FbmOctave *o = &fbm->octave[i];
+    const RowY *ry = &rows[i];
+    OctaveLuts l = {lut12(basis_x), lut12(basis_y), lut12(o->z_low), lut12(o->z_high)};
+    __m256 xf = _mm256_mul_ps(x, _mm256_set1_ps(o->frequency));
+    __m256i px = floor8(xf);
+    __m256 fx = _mm256_sub_ps(xf, _mm256_cvtepi32_ps(px));
+    __m256 fx1 = _mm256_sub_ps(fx, _mm256_set1_ps(1));
+    __m256 u = ease8(fx);
+    __m256 du = _mm256_mul_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(fx, _mm256_set1_ps(30)), _mm256_set1_ps(60)), fx),
+                      _mm256_set1_ps(30)),
+        _mm256_mul_ps(fx, fx));
+
+    __m256i seed = _mm256_set1_epi32(o->seed);
+    __m256i x0 = _mm256_add_epi32(_mm256_and_si256(px, mask), seed);
+    __m256i x1 = _mm256_add_epi32(_mm256_and_si256(_mm256_add_epi32(px, _mm256_set1_epi32(1)), mask), seed);
+    __m256i r0 = _mm256_i32gather_epi32(perm, x0, 4);
+    __m256i r1 = _mm256_i32gather_epi32(perm, x1, 4);
+    __m256i y0 = _mm256_set1_epi32(ry->y0), y1 = _mm256_set1_epi32(ry->y1);
+    __m256i r00 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r0, y0), 4);
+    __m256i r01 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r0, y1), 4);
+    __m256i r10 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r1, y0), 4);
+    __m256i r11 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(r1, y1), 4);
+
+    __m256 fy = _mm256_set1_ps(ry->fy), fy1 = _mm256_set1_ps(ry->fy1);
+    __m256 v = _mm256_set1_ps(ry->v), dv = _mm256_set1_ps(ry->dv);
+    Grad8 c00 = corner8_grad(o, &l, r00, fx, fy), c01 = corner8_grad(o, &l, r01, fx, fy1);
+    Grad8 c10 = corner8_grad(o, &l, r10, fx1, fy), c11 = corner8_grad(o, &l, r11, fx1, fy1);
+    __m256 n0 = lerp8(c00.n, c01.n, v);
+    __m256 n1 = lerp8(c10.n, c11.n, v);
+    sum.n = _mm256_add_ps(sum.n, _mm256_mul_ps(lerp8(n0, n1, u), _mm256_set1_ps(o->amplitude)));
+
+    __m256 n0x = lerp8(c00.dx, c01.dx, v), n1x = lerp8(c10.dx, c11.dx, v);
+    __m256 n0y = _mm256_add_ps(lerp8(c00.dy, c01.dy, v), _mm256_mul_ps(_mm256_sub_ps(c01.n, c00.n), dv));
+    __m256 n1y = _mm256_add_ps(lerp8(c10.dy, c11.dy, v), _mm256_mul_ps(_mm256_sub_ps(c11.n, c10.n), dv));
+    __m256 k = _mm256_set1_ps(o->amplitude * o->frequency);
+    sum.dx = _mm256_add_ps(sum.dx,
+                           _mm256_mul_ps(_mm256_add_ps(lerp8(n0x, n1x, u), _mm256_mul_ps(_mm256_sub_ps(n1, n0), du)), k));
+    sum.dy = _mm256_add_ps(sum.dy, _mm256_mul_ps(lerp8(n0y, n1y, u), k));
+  }
+  return sum;
+}
+
+AVX2 INLINE void fbm_row_avx2_impl(const Fbm *fbm, const float *xs, float y, float *out, int count, int octaves) {
+  RowY rows[FBM_MAX_OCTAVES];
+  for (int i = 0; i < octaves; i++)
+    rows[i] = row_y(&fbm->octave[i], y);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+    _mm256_storeu_ps(out + i, fbm8(fbm, _mm256_loadu_ps(xs + i), rows, octaves));
+  for (; i < count; i++)
+    out[i] = fbm_noise2(fbm, xs[i], y);
+}
+
+AVX2 INLINE void fbm_row_grad_avx2_impl(const Fbm *fbm, const float *xs, float y, float *out, float *dx, float *dy,
+                                        int count, int octaves) {
+  RowY rows[FBM_MAX_OCTAVES];
+  for (int i = 0; i < octaves; i++)
+    rows[i] = row_y(&fbm->octave[i], y);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    Grad8 g = fbm8_grad(fbm, _mm256_loadu_ps(xs + i), rows, octaves);
+    _mm256_storeu_ps(out + i, g.n);
+    _mm256_storeu_ps(dx + i, g.dx);
+    _mm256_storeu_ps(dy + i, g.dy);
+  }
+  for (; i < count; i++)
+    out[i] = fbm_noise2_grad(fbm, xs[i], y, &dx[i], &dy[i]);
+}
+
+// octave count baked in for the common cases so the octave loop unrolls
+#define FBM_ROW(isa, name, n) \
+  static isa void fbm_row_##name##_##n(const Fbm *fbm, const float *xs, float y, float *out, int count) { \
+    fbm_row_##name##_impl(fbm, xs, y, out, count, n); \
+  } \
+  static isa void fbm_row_grad_##name##_##n(const Fbm *fbm, const float *xs, float y, float *out, float *dx, \
+                                            float *dy, int count) { \
+    fbm_row_grad_##name##_impl(fbm, xs, y, out, dx, dy, count, n); \
+  }
+#define FBM_ROWS(isa, name) \
+  FBM_ROW(isa, name, 4) FBM_ROW(isa, name, 5) FBM_ROW(isa, name, 6) FBM_ROW(isa, name, 7) FBM_ROW(isa, name, 8) \
+  static isa void fbm_row_##name##_n(const Fbm *fbm, const float *xs, float y, float *out, int count) { \
+    fbm_row_##name##_impl(fbm, xs, y, out, count, fbm->octaves); \
+  } \
+  static isa void fbm_row_grad_##name##_n(const Fbm *fbm, const float *xs, float y, float *out, float *dx, \
+                                          float *dy, int count) { \
+    fbm_row_grad_##name##_impl(fbm, xs, y, out, dx, dy, count, fbm->octaves); \
+  } \
+  static FbmRowFn fbm_row_##name(int octaves) { \
+    switch (octaves) { \
+      case 4: return fbm_row_##name##_4; \
+      case 5: return fbm_row_##name##_5; \
+      case 6: return fbm_row_##name##_6; \
+      case 7: return fbm_row_##name##_7; \
+      case 8: return fbm_row_##name##_8; \
+      default: return fbm_row_##name##_n; \
+    } \
+  } \
+  static FbmRowGradFn fbm_row_grad_##name(int octaves) { \
+    switch (octaves) { \
+      case 4: return fbm_row_grad_##name##_4; \
+      case 5: return fbm_row_grad_##name##_5; \
+      case 6: return fbm_row_grad_##name##_6; \
+      case 7: return fbm_row_grad_##name##_7; \
+      case 8: return fbm_row_grad_##name##_8; \
+      default: return fbm_row_grad_##name##_n; \
+    } \
+  }
+
+FBM_ROWS(SSE2, sse2)
+FBM_ROWS(AVX2, avx2)
+
+#endif // NOISE_X86
+
+NoiseIsa noise_best_isa(void) {
+#ifdef NOISE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return NOISE_AVX2;
+  if (__builtin_cpu_supports("sse2")) return NOISE_SSE2;
+#endif
+  return NOISE_SCALAR;
+}
+
+const char *noise_isa_name(NoiseIsa isa) {
+  switch (isa) {
+    case NOISE_AVX2: return "avx2";
+    case NOISE_SSE2: return "sse2";
+    default: return "scalar";
+  }
+}
+
+void fbm_set_isa(Fbm *fbm, NoiseIsa isa) {
+  NoiseIsa best = noise_best_isa();
+  fbm->isa = isa > best ? best : isa;
+  fbm->row = fbm_row_scalar;
+  fbm->row_grad = fbm_row_grad_scalar;
+#ifdef NOISE_X86
+  if (fbm->isa == NOISE_AVX2) {
+    fbm->row = fbm_row_avx2(fbm->octaves);
+    fbm->row_grad = fbm_row_grad_avx2(fbm->octaves);
+  } else if (fbm->isa == NOISE_SSE2) {
+    fbm->row = fbm_row_sse2(fbm->octaves);
+    fbm->row_grad = fbm_row_grad_sse2(fbm->octaves);
+  }
+#endif
+}
+
+Fbm fbm_init(float z, float lacunarity, float gain, int octaves) {
+  pthread_once(&tables_once, init_tables);
+
+  Fbm fbm = {0};
+  fbm.octaves = octaves > FBM_MAX_OCTAVES ? FBM_MAX_OCTAVES : octaves;
+
+  // same accumulation as stb_perlin_fbm_noise3 so frequencies match bit for bit
+  float frequency = 1.0f;
+  float amplitude = 1.0f;
+  for (int i = 0; i < fbm.octaves; i++) {
+    FbmOctave *o = &fbm.octave[i];
+    float zf = z * frequency;
+    int pz = stb__perlin_fastfloor(zf);
+    float fz = zf - pz;
+
+    o->frequency = frequency;
+    o->amplitude = amplitude;
+    o->seed = (unsigned char)i;
+    o->z0 = pz & 255;
+    o->z1 = (pz + 1) & 255;
+    o->w = EASE(fz);
+    for (int g = 0; g < 12; g++) {
+      o->z_low[g] = basis_z[g] * fz;
+      o->z_high[g] = basis_z[g] * (fz - 1);
+    }
+
+    frequency *= lacunarity;
+    amplitude *= gain;
+  }
+
+  fbm_set_isa(&fbm, noise_best_isa());
+  return fbm;
+}
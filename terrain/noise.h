@@ -0,0 +1,67 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+// 2d fbm noise: a fixed-z slice of stb_perlin_fbm_noise3 evaluated 4 (SSE2)
+// or 8 (AVX2) pixels at a time. the instruction set is picked at runtime.
+//
+// tolerance: every path does the same float operations in the same order as
+// stb_perlin_fbm_noise3(x, y, z, lacunarity, gain, octaves), so results are
+// bit-identical unless the compiler contracts the stb side into FMAs. we
+// guarantee |simd - stb| <= 1e-5 per sample, which is at most 1 step of
+// difference once quantized to 8 bits.
+//
+// the _grad variants also return the analytic derivative of the noise with
+// respect to x and y (the derivative of the interpolant, not a finite
+// difference). their value output is bit-identical to the plain variants.
+
+#define FBM_MAX_OCTAVES 16
+#define FBM_TOLERANCE 1e-5f
+
+typedef enum NoiseIsa {
+  NOISE_SCALAR,
+  NOISE_SSE2,
+  NOISE_AVX2
+} NoiseIsa;
+
+typedef struct Fbm Fbm;
+typedef void (*FbmRowFn)(const Fbm *fbm, const float *xs, float y, float *out, int count);
+typedef void (*FbmRowGradFn)(const Fbm *fbm, const float *xs, float y, float *out, float *dx, float *dy, int count);
+
+// per octave constants, the z part of the lattice is the same for every pixel
+typedef struct FbmOctave {
+  float frequency;
+  float amplitude;
+  float z_low[12];  // gradient z component times the z fraction
+  float z_high[12]; // same for the upper z corner (fraction - 1)
+  float w;          // eased z fraction
+  int z0, z1;
+  int seed;
+} FbmOctave;
+
+struct Fbm {
+  int octaves;
+  NoiseIsa isa;
+  FbmRowFn row;
+  FbmRowGradFn row_grad;
+  FbmOctave octave[FBM_MAX_OCTAVES];
+};
+
+// octaves above FBM_MAX_OCTAVES are clamped
+Fbm fbm_init(float z, float lacunarity, float gain, int octaves);
+// force a path (clamped to what the cpu supports), used for testing
+void fbm_set_isa(Fbm *fbm, NoiseIsa isa);
+NoiseIsa noise_best_isa(void);
+const char *noise_isa_name(NoiseIsa isa);
+
+float fbm_noise2(const Fbm *fbm, float x, float y);
+float fbm_noise2_grad(const Fbm *fbm, float x, float y, float *dx, float *dy);
+// evaluate count pixels at (xs[i], y)
+static inline void fbm_noise2_row(const Fbm *fbm, const float *xs, float y, float *out, int count) {
+  fbm->row(fbm, xs, y, out, count);
+}
+static inline void fbm_noise2_row_grad(const Fbm *fbm, const float *xs, float y, float *out, float *dx, float *dy,
+                                       int count) {
+  fbm->row_grad(fbm, xs, y, out, dx, dy, count);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "npc_renderer.h"
+
+#include <raymath.h>
+#include <rlgl.h>
+
+#define NPC_COLOR MAROON
+#define NPC_BLOCKED_COLOR RED // its last move ran into a block
+
+void npc_renderer_init(NpcRenderer *r, int max) {
+  *r = (NpcRenderer){.max = max};
+  r->shader = LoadShader("terrain/npcs.vert", "terrain/npcs.frag");
+  r->nearest = RL_MALLOC(max * sizeof(int));
+  r->distances = RL_MALLOC(max * sizeof(float));
+  r->instances = RL_MALLOC(max * sizeof(Vector4));
+  r->colors = RL_MALLOC(max * sizeof(Color));
+
+  r->cube = GenMeshCube(1, 1, 1);
+  UploadMesh(&r->cube, false);
+  int loc_instance = GetShaderLocationAttrib(r->shader, "npcInstance");
+  int loc_color = GetShaderLocationAttrib(r->shader, "npcColor");
+  if (loc_instance < 0 || loc_color < 0) {
+    TRACELOG(LOG_WARNING, "NPCS: shader has no instance attributes, npcs are not drawn");
+    return;
+  }
+  // a buffer per attribute, both start at 0
+  rlEnableVertexArray(r->cube.vaoId);
+  r->instance_vbo = rlLoadVertexBuffer(NULL, max * sizeof(Vector4), true);
+  rlSetVertexAttribute(loc_instance, 4, RL_FLOAT, false, 0, 0);
+  rlEnableVertexAttribute(loc_instance);
+  rlSetVertexAttributeDivisor(loc_instance, 1);
+  r->color_vbo = rlLoadVertexBuffer(NULL, max * sizeof(Color), true);
+  rlSetVertexAttribute(loc_color, 4, RL_UNSIGNED_BYTE, true, 0, 0);
+  rlEnableVertexAttribute(loc_color);
+  rlSetVertexAttributeDivisor(loc_color, 1);
+  rlDisableVertexArray();
+}
+
+void npc_renderer_unload(NpcRenderer *r) {
+  if (r->instance_vbo) {
+    rlUnloadVertexBuffer(r->instance_vbo);
+    rlUnloadVertexBuffer(r->color_vbo);
+  }
+  UnloadMesh(r->cube);
+  UnloadShader(r->shader);
+  RL_FREE(r->nearest);
+  RL_FREE(r->distances);
+  RL_FREE(r->instances);
+  RL_FREE(r->colors);
+  *r = (NpcRenderer){0};
+}
+
+void npc_renderer_draw(NpcRenderer *r, RenderQueue *queue, const Entities *npcs, Vector3 eye, float range) {
+  r->drawn = 0;
+  if (!r->instance_vbo)
+    return;
+  int n = entities_nearest(npcs, eye, range, r->max, r->nearest, r->distances);
+  if (!n)
+    return;
+  for (int k = 0; k < n; k++) {
+    int i = r->nearest[k];
+    r->instances[k] = (Vector4){npcs->x[i], npcs->y[i], npcs->z[i], npcs->radius[i] * 2};
+    r->colors[k] = npcs->flags[i] & ENTITY_BLOCKED ? NPC_BLOCKED_COLOR : NPC_COLOR;
+  }
+  rlUpdateVertexBuffer(r->instance_vbo, r->instances, n * sizeof(Vector4), 0);
+  rlUpdateVertexBuffer(r->color_vbo, r->colors, n * sizeof(Color), 0);
+
+  // they're all within range, sorted as one draw at the range's middle
+  RenderCommand *command =
+      render_queue_push(queue, r->shader, r->cube.vaoId, 0, r->cube.triangleCount * 3, RENDER_INDEX_16, range / 2);
+  command->instances = n;
+  r->drawn = n;
+}
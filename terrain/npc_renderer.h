@@ -0,0 +1,31 @@
+#ifndef NPC_RENDERER_H
+#define NPC_RENDERER_H
+
+#include <raylib.h>
+
+#include "entities.h"
+#include "render_queue.h"
+
+// the npcs nearest the eye as cubes, all of them one instanced draw through
+// the render queue. a unit cube carries each npc's centre, size and colour as
+// per instance attributes, refilled every frame
+
+typedef struct NpcRenderer {
+  Shader shader; // npcs.vert and npcs.frag
+  Mesh cube;     // unit, its vao also holds the instance attributes
+  unsigned int instance_vbo, color_vbo;
+  int max;
+  int *nearest;       // max entity indices
+  float *distances;   // squared, parallel to nearest
+  Vector4 *instances; // xyz centre, w size
+  Color *colors;
+  // last frame
+  int drawn;
+} NpcRenderer;
+
+void npc_renderer_init(NpcRenderer *r, int max);
+void npc_renderer_unload(NpcRenderer *r);
+// queues the up to max npcs nearest the eye within range
+void npc_renderer_draw(NpcRenderer *r, RenderQueue *queue, const Entities *npcs, Vector3 eye, float range);
+
+#endif
@@ -0,0 +1,17 @@
+#version 330
+
+// a unit cube per npc, npcInstance is the npc's centre and size and
+// npcColor its colour, both per instance
+in vec3 vertexPosition;
+in vec4 npcInstance;
+in vec4 npcColor;
+
+uniform mat4 mvp;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = npcColor;
+    gl_Position = mvp * vec4(npcInstance.xyz + vertexPosition*npcInstance.w, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 330
+
+// base.vert for PackedVertex meshes (see packed_mesh.h). x, y, z are 16 bit
+// steps and w holds the two bytes of the octahedral normal, all arriving as
+// plain integers
+in vec4 vertexPosition;
+in vec2 vertexTexCoord;
+
+uniform mat4 mvp;
+uniform mat4 matNormal;
+
+uniform vec3 quantOffset; // position = quantOffset + xyz*quantScale
+uniform vec3 quantScale;
+uniform vec2 uvScale;     // texcoords from x and z, 0 when the mesh has its own
+
+out vec2 texCoord;
+out vec3 fragNormal;
+
+vec3 octahedralDecode(float code)
+{
+    vec2 f = vec2(floor(code/256.0), mod(code, 256.0))/127.0 - 1.0;
+    vec3 n = vec3(f.x, 1.0 - abs(f.x) - abs(f.y), f.y);
+    float t = max(-n.y, 0.0);
+    n.xz += mix(vec2(t), vec2(-t), greaterThanEqual(n.xz, vec2(0.0)));
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 pos = quantOffset + vertexPosition.xyz*quantScale;
+    texCoord = vertexTexCoord + vertexPosition.xz*uvScale;
+    fragNormal = vec3(matNormal) * octahedralDecode(vertexPosition.w);
+    gl_Position = mvp * vec4(pos, 1.0);
+}
@@ -0,0 +1,254 @@
+#include "packed_mesh.h"
+
+#include <math.h>
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---Normals---
+
+// y is folded, so normals facing up (most of the terrain) land in the inner
+// diamond. codes map [0, 254] to [-1, 1] so 0 and the axes are exact
+static Vector3 octahedral_decode(float u, float v) {
+  Vector3 n = {u, 1.0f - fabsf(u) - fabsf(v), v};
+  float t = fmaxf(-n.y, 0);
+  n.x += n.x >= 0 ? -t : t;
+  n.z += n.z >= 0 ? -t : t;
+  return Vector3Normalize(n);
+}
+
+Vector3 packed_normal_decode(unsigned short code) {
+  return octahedral_decode((code >> 8) / 127.0f - 1.0f, (code & 0xff) / 127.0f - 1.0f);
+}
+
+unsigned short packed_normal_encode(Vector3 n) {
+  float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+  if (l1 == 0)
+    return 0x7f7f; // up
+  float u = n.x / l1, v = n.z / l1;
+  if (n.y < 0) {
+    float fu = (1.0f - fabsf(v)) * (u >= 0 ? 1.0f : -1.0f);
+    float fv = (1.0f - fabsf(u)) * (v >= 0 ? 1.0f : -1.0f);
+    u = fu;
+    v = fv;
+  }
+
+  // rounding each axis on its own can be a step off, try the four codes
+  // around the exact position and keep the one closest in angle
+  float cu = (u + 1.0f) * 127.0f, cv = (v + 1.0f) * 127.0f;
+  int u0 = Clamp(floorf(cu), 0, 253), v0 = Clamp(floorf(cv), 0, 253);
+  unsigned short best = 0;
+  float best_dot = -2;
+  for (int k = 0; k < 4; k++) {
+    unsigned short code = (u0 + (k & 1)) << 8 | (v0 + (k >> 1));
+    float d = Vector3DotProduct(packed_normal_decode(code), n);
+    if (d > best_dot) {
+      best_dot = d;
+      best = code;
+    }
+  }
+  return best;
+}
+
+//---Packing---
+
+static unsigned short quantize(float value, float offset, float scale) {
+  return scale > 0 ? (unsigned short)Clamp(roundf((value - offset) / scale), 0, 65535) : 0;
+}
+
+PackedMesh packed_mesh_from_terrain(const TerrainMesh *mesh, const Heightfield *hf, float headroom) {
+  int count = mesh->vertex_count;
+  float low = INFINITY, high = -INFINITY;
+  for (int i = 0; i < count; i++) {
+    low = fminf(low, mesh->vertices[i * 3 + 1]);
+    high = fmaxf(high, mesh->vertices[i * 3 + 1]);
+  }
+  low -= headroom;
+  high += headroom;
+
+  PackedMesh packed = {
+      .vertex_count = count,
+      .vertices = RL_MALLOC(count * sizeof(PackedVertex)),
+      .offset = {0, low, 0},
+      .scale = {hf->spacing, (high - low) / 65535.0f, hf->spacing},
+      .uv_scale = {1.0f / (hf->width - 1), 1.0f / (hf->length - 1)},
+  };
+  const float *vertices = mesh->vertices, *normals = mesh->normals;
+  float to_grid = 1.0f / hf->spacing;
+  for (int i = 0; i < count; i++) {
+    const float *p = &vertices[i * 3], *n = &normals[i * 3];
+    packed.vertices[i] = (PackedVertex){
+        .x = (unsigned short)lroundf(p[0] * to_grid),
+        .y = quantize(p[1], low, packed.scale.y),
+        .z = (unsigned short)lroundf(p[2] * to_grid),
+        .normal = packed_normal_encode((Vector3){n[0], n[1], n[2]}),
+    };
+  }
+  return packed;
+}
+
+PackedMesh packed_mesh_from_mesh(Mesh mesh) {
+  BoundingBox box = GetMeshBoundingBox(mesh);
+  int count = mesh.vertexCount;
+  PackedMesh packed = {
+      .vertex_count = count,
+      .vertices = RL_MALLOC(count * sizeof(PackedVertex)),
+      .texcoords = mesh.texcoords ? RL_MALLOC(count * 2 * sizeof(unsigned short)) : NULL,
+      .offset = box.min,
+      .scale = Vector3Scale(Vector3Subtract(box.max, box.min), 1.0f / 65535.0f),
+      .index_count = mesh.indices ? mesh.triangleCount * 3 : count,
+  };
+
+  for (int i = 0; i < count; i++) {
+    const float *p = &mesh.vertices[i * 3];
+    Vector3 n = mesh.normals ? (Vector3){mesh.normals[i * 3], mesh.normals[i * 3 + 1], mesh.normals[i * 3 + 2]}
+                             : (Vector3){0, 1, 0};
+    packed.vertices[i] = (PackedVertex){
+        .x = quantize(p[0], box.min.x, packed.scale.x),
+        .y = quantize(p[1], box.min.y, packed.scale.y),
+        .z = quantize(p[2], box.min.z, packed.scale.z),
+        .normal = packed_normal_encode(n),
+    };
+    for (int k = 0; packed.texcoords && k < 2; k++)
+      packed.texcoords[i * 2 + k] = quantize(mesh.texcoords[i * 2 + k], 0, 1.0f / 65535.0f);
+  }
+
+  if (mesh.indices) {
+    packed.indices = RL_MALLOC(packed.index_count * sizeof(unsigned short));
+    memcpy(packed.indices, mesh.indices, packed.index_count * sizeof(unsigned short));
+  }
+  return packed;
+}
+
+bool packed_mesh_update(PackedMesh *mesh, const Heightfield *hf, HeightfieldRect rect, const float *normals) {
+  float low = mesh->offset.y, high = low + mesh->scale.y * 65535.0f;
+  for (int z = rect.z0; z <= rect.z1; z++) {
+    for (int x = rect.x0; x <= rect.x1; x++) {
+      float h = heightfield_at(hf, x, z);
+      if (!(h >= low && h <= high))
+        return false;
+    }
+  }
+
+  int w = heightfield_rect_width(rect), l = heightfield_rect_length(rect);
+  PackedVertex *packed = RL_MALLOC((size_t)w * l * sizeof(PackedVertex));
+  for (int z = rect.z0, i = 0; z <= rect.z1; z++) {
+    for (int x = rect.x0; x <= rect.x1; x++, i++) {
+      const float *n = &normals[i * 3];
+      packed[i] = (PackedVertex){
+          .x = x,
+          .y = quantize(heightfield_at(hf, x, z), low, mesh->scale.y),
+          .z = z,
+          .normal = packed_normal_encode((Vector3){n[0], n[1], n[2]}),
+      };
+    }
+  }
+
+  // same row by row upload as terrain_mesh_update
+  int rows = w == hf->width ? 1 : l, row_size = (w == hf->width ? l : 1) * w;
+  for (int r = 0; r < rows; r++) {
+    int first = (rect.z0 + r) * hf->width + rect.x0;
+    if (mesh->vertices)
+      memcpy(&mesh->vertices[first], &packed[r * row_size], row_size * sizeof(PackedVertex));
+    if (mesh->vao)
+      rlUpdateVertexBuffer(mesh->vbo[0], &packed[r * row_size], row_size * sizeof(PackedVertex),
+                           first * sizeof(PackedVertex));
+  }
+  RL_FREE(packed);
+  return true;
+}
+
+//---Gpu---
+
+void packed_mesh_upload(PackedMesh *mesh, const TerrainIndices *indices) {
+  mesh->vao = rlLoadVertexArray();
+  rlEnableVertexArray(mesh->vao);
+
+  // one attribute for position and normal, the shader splits the normal's
+  // bytes. not normalized so the values arrive as the integers they are
+  mesh->vbo[0] = rlLoadVertexBuffer(mesh->vertices, mesh->vertex_count * sizeof(PackedVertex), false);
+  rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, 4, RL_UNSIGNED_SHORT, false, 0, 0);
+  rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION);
+
+  if (mesh->texcoords) {
+    mesh->vbo[1] = rlLoadVertexBuffer(mesh->texcoords, mesh->vertex_count * 2 * sizeof(unsigned short), false);
+    rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, 2, RL_UNSIGNED_SHORT, true, 0, 0);
+    rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD);
+  } else {
+    rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD);
+  }
+  rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL);
+  rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR);
+
+  // element buffer binding is vao state
+  if (indices) {
+    mesh->index_count = indices->count;
+    mesh->wide_indices = true;
+    rlEnableVertexBufferElement(indices->ebo);
+  } else if (mesh->indices) {
+    mesh->ebo = rlLoadVertexBufferElement(mesh->indices, mesh->index_count * sizeof(unsigned short), false);
+  }
+  rlDisableVertexArray();
+  packed_mesh_free_cpu(mesh);
+}
+
+void packed_mesh_free_cpu(PackedMesh *mesh) {
+  RL_FREE(mesh->vertices);
+  RL_FREE(mesh->texcoords);
+  RL_FREE(mesh->indices);
+  mesh->vertices = NULL;
+  mesh->texcoords = NULL;
+  mesh->indices = NULL;
+}
+
+void packed_mesh_unload(PackedMesh *mesh) {
+  if (mesh->vao) {
+    rlUnloadVertexArray(mesh->vao);
+    for (int i = 0; i < 2; i++) {
+      if (mesh->vbo[i])
+        rlUnloadVertexBuffer(mesh->vbo[i]);
+    }
+    if (mesh->ebo)
+      rlUnloadVertexBuffer(mesh->ebo);
+  }
+  packed_mesh_free_cpu(mesh);
+  mesh->vao = mesh->vbo[0] = mesh->vbo[1] = mesh->ebo = 0;
+}
+
+size_t packed_mesh_bytes(const PackedMesh *mesh) {
+  size_t bytes = (size_t)mesh->vertex_count * sizeof(PackedVertex);
+  if (mesh->texcoords || mesh->vbo[1])
+    bytes += (size_t)mesh->vertex_count * 2 * sizeof(unsigned short);
+  if (mesh->indices || mesh->ebo)
+    bytes += (size_t)mesh->index_count * sizeof(unsigned short);
+  return bytes;
+}
+
+// uniform locations of the last packed.vert drawn with, draws are main
+// thread only
+static unsigned int packed_shader;
+static int loc_offset, loc_scale, loc_uv_scale;
+
+void packed_mesh_draw(const PackedMesh *mesh, RenderQueue *queue, Material material, Matrix transform, float depth) {
+  Shader shader = material.shader;
+  if (shader.id != packed_shader) {
+    packed_shader = shader.id;
+    loc_offset = GetShaderLocation(shader, "quantOffset");
+    loc_scale = GetShaderLocation(shader, "quantScale");
+    loc_uv_scale = GetShaderLocation(shader, "uvScale");
+  }
+
+  int flags = mesh->wide_indices ? RENDER_INDEX_32 : mesh->ebo ? RENDER_INDEX_16 : 0;
+  // zero so the grid term alone gives the texcoords
+  if (!mesh->vbo[1])
+    flags |= RENDER_ZERO_TEXCOORDS;
+  int count = flags & (RENDER_INDEX_16 | RENDER_INDEX_32) ? mesh->index_count : mesh->vertex_count;
+  RenderCommand *command = render_queue_push(queue, shader, mesh->vao, 0, count, flags, depth);
+  command->textures[0] = material.maps[MATERIAL_MAP_DIFFUSE].texture.id;
+  command->color = material.maps[MATERIAL_MAP_DIFFUSE].color;
+  command->transform = transform;
+  render_queue_uniform(queue, loc_offset, SHADER_UNIFORM_VEC3, &mesh->offset);
+  render_queue_uniform(queue, loc_scale, SHADER_UNIFORM_VEC3, &mesh->scale);
+  render_queue_uniform(queue, loc_uv_scale, SHADER_UNIFORM_VEC2, &mesh->uv_scale);
+}
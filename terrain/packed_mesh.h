@@ -0,0 +1,62 @@
+#ifndef PACKED_MESH_H
+#define PACKED_MESH_H
+
+#include <raylib.h>
+#include <stddef.h>
+
+#include "heightfield.h"
+#include "render_queue.h"
+#include "terrain_mesh.h"
+
+// compact vertex format, 8 bytes a vertex against 32 for float positions,
+// normals and texcoords. positions are 16 bit steps from an offset (for
+// terrain x and z are the sample coordinates, so the grid stays exact, and
+// the height is quantized between the chunk's bounds), normals are octahedral
+// in 2x8 bits and texcoords are either derived from x and z or 2x16 bits in a
+// second buffer. drawn with packed.vert, which decodes it.
+
+typedef struct PackedVertex {
+  unsigned short x, y, z;
+  unsigned short normal; // octahedral, u in the high byte
+} PackedVertex;
+
+typedef struct PackedMesh {
+  int vertex_count;
+  // cpu copies, NULL once uploaded
+  PackedVertex *vertices;
+  unsigned short *texcoords;   // unorm pairs, NULL to use (x, z) * uv_scale
+  unsigned short *indices;     // own 16 bit indices, NULL for terrain meshes
+  Vector3 offset, scale;       // position = offset + (x, y, z) * scale
+  Vector2 uv_scale;
+  int index_count;
+  unsigned int vao, vbo[2]; // positions + normals, texcoords
+  unsigned int ebo;         // own indices only, shared ones belong to their TerrainIndices
+  bool wide_indices;        // 32 bit TerrainIndices
+} PackedMesh;
+
+// closest of the 2x8 bit octahedral codes to n, and back
+unsigned short packed_normal_encode(Vector3 n);
+Vector3 packed_normal_decode(unsigned short code);
+
+// a mesh on the heightfield's grid (terrain_mesh_build, rtin_build_mesh),
+// heights quantized between its lowest and highest vertex widened by headroom
+// both ways, room for edits to move the surface before it has to be packed
+// again. cpu side only so it can run on a worker thread
+PackedMesh packed_mesh_from_terrain(const TerrainMesh *mesh, const Heightfield *hf, float headroom);
+// any raylib mesh with 16 bit indices and texcoords in [0, 1] (the blocks),
+// positions quantized over its bounds
+PackedMesh packed_mesh_from_mesh(Mesh mesh);
+
+// terrain meshes draw with their TerrainIndices like terrain_mesh_upload,
+// meshes with their own indices pass NULL
+void packed_mesh_upload(PackedMesh *mesh, const TerrainIndices *indices);
+// terrain_mesh_update for a packed terrain_mesh_build mesh. false, and nothing
+// changed, when a new height is outside the quantized range
+bool packed_mesh_update(PackedMesh *mesh, const Heightfield *hf, HeightfieldRect rect, const float *normals);
+void packed_mesh_free_cpu(PackedMesh *mesh);
+void packed_mesh_unload(PackedMesh *mesh);
+size_t packed_mesh_bytes(const PackedMesh *mesh);
+// queues a draw, the material shader has to be packed.vert
+void packed_mesh_draw(const PackedMesh *mesh, RenderQueue *queue, Material material, Matrix transform, float depth);
+
+#endif
@@ -0,0 +1,61 @@
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct ParallelJob {
+  ParallelFn fn;
+  void *user;
+  int count;
+  int grain;
+  int next; // next unclaimed item, taken with atomics
+} ParallelJob;
+
+int parallel_cpu_count(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
+
+static void *parallel_worker(void *arg) {
+  ParallelJob *job = arg;
+  for (;;) {
+    int begin = __atomic_fetch_add(&job->next, job->grain, __ATOMIC_RELAXED);
+    if (begin >= job->count)
+      break;
+    int end = begin + job->grain < job->count ? begin + job->grain : job->count;
+    job->fn(job->user, begin, end);
+  }
+  return NULL;
+}
+
+void parallel_for(int count, int grain, int threads, ParallelFn fn, void *user) {
+  if (count <= 0)
+    return;
+  if (threads <= 0)
+    threads = parallel_cpu_count();
+  if (grain <= 0)
+    grain = 1;
+  int batches = (count + grain - 1) / grain;
+  if (threads > batches)
+    threads = batches;
+
+  if (threads <= 1) {
+    fn(user, 0, count);
+    return;
+  }
+
+  ParallelJob job = {fn, user, count, grain, 0};
+  pthread_t *workers = malloc((threads - 1) * sizeof(pthread_t));
+  int started = 0;
+  for (int i = 0; i < threads - 1; i++) {
+    // if we can't get a thread the others just pick up more batches
+    if (pthread_create(&workers[started], NULL, parallel_worker, &job) == 0)
+      started++;
+  }
+  parallel_worker(&job);
+
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+  free(workers);
+}
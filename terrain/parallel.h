@@ -0,0 +1,17 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// called with a half open range [begin, end) of work items
+typedef void (*ParallelFn)(void *user, int begin, int end);
+
+// number of online cpus, at least 1
+int parallel_cpu_count(void);
+
+// split [0, count) into batches of `grain` items and run them on `threads`
+// workers (<= 0 means one per cpu). the calling thread works too and the
+// call returns once everything is done. batches are handed out dynamically
+// so uneven rows still balance, results must not depend on which thread ran
+// a batch.
+void parallel_for(int count, int grain, int threads, ParallelFn fn, void *user);
+
+#endif
@@ -1,45 +1,114 @@
 #include <raylib.h>
 #include <stdlib.h>
-#include "../lib/stb_perlin.h"
+#include "noise.h"
+#include "parallel.h"
+#include "perlin.h"
 
-Image my_perlin_image(int width, int height, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves)
-{
-    Color *pixels = (Color *)RL_MALLOC(width*height*sizeof(Color));
+// rows handed to a worker at a time, small enough to balance 16+ threads on
+// a few hundred rows
+#define ROW_BATCH 8
 
+typedef struct PerlinJob {
+    Color *pixels;   // image output, or
+    float *heights;  // heightfield output scaled to max_height
+    float *slopes;   // optional, world space height derivatives
+    float max_height;
+    float slope_x;   // noise derivative to world slope, per axis
+    float slope_z;
+    const float *xs;
+    const Fbm *fbm;
+    int width;
+    int height;
+    int y_off;
+    float scale;
+    float aspectRatio;
+} PerlinJob;
+
+static void perlin_rows(void *user, int begin, int end)
+{
+    const PerlinJob *job = user;
+    int width = job->width, height = job->height;
+    // value row followed by the two derivative rows when slopes are wanted
+    float *row = (float *)RL_MALLOC((job->slopes ? 3 : 1)*width*sizeof(float));
+    float *row_dx = row + width, *row_dy = row + 2*width;
 
-    float aspectRatio = (float)width / (float)height;
-    for (int y = 0; y < height; y++)
+    for (int y = begin; y < end; y++)
     {
+        float ny = (float)(y + job->y_off)*(job->scale/(float)height);
+        if (width <= height) ny /= job->aspectRatio;
+
+        if (job->slopes) fbm_noise2_row_grad(job->fbm, job->xs, ny, row, row_dx, row_dy, width);
+        else fbm_noise2_row(job->fbm, job->xs, ny, row, width);
+
         for (int x = 0; x < width; x++)
         {
-            float nx = (float)(x + x_off)*(scale/(float)width);
-            float ny = (float)(y + y_off)*(scale/(float)height);
-
-            // Apply aspect ratio compensation to wider side
-            if (width > height) nx *= aspectRatio;
-            else ny /= aspectRatio;
-            
-            // Basic perlin noise implementation (not used)
-            //float p = (stb_perlin_noise3(nx, ny, 0.0f, 0, 0, 0);
-
-            // Calculate a better perlin noise using fbm (fractal brownian motion)
-            // Typical values to start playing with:
-            //   lacunarity = ~2.0   -- spacing between successive octaves (use exactly 2.0 for wrapping output)
-            //   gain       =  0.5   -- relative weighting applied to each successive octave
-            //   octaves    =  6     -- number of "octaves" of noise3() to sum
-            float p = stb_perlin_fbm_noise3(nx, ny, 1.0f, lacunarity, gain, octaves);
+            float p = row[x];
             // Clamp between -1.0f and 1.0f
+            bool clamped = p < -1.0f || p > 1.0f;
             if (p < -1.0f) p = -1.0f;
             if (p > 1.0f) p = 1.0f;
 
             // We need to normalize the data from [-1..1] to [0..1]
             float np = (p + 1.0f)/2.0f;
 
-            int intensity = (int)(np*255.0f);
-            pixels[y*width + x] = (Color){ intensity, intensity, intensity, 255 };
+            // flat where the clamp cut the surface off
+            if (job->slopes)
+            {
+                float *slope = &job->slopes[(y*width + x)*2];
+                slope[0] = clamped ? 0.0f : row_dx[x]*job->slope_x;
+                slope[1] = clamped ? 0.0f : row_dy[x]*job->slope_z;
+            }
+
+            if (job->heights) job->heights[y*width + x] = np*job->max_height;
+            else
+            {
+                int intensity = (int)(np*255.0f);
+                job->pixels[y*width + x] = (Color){ intensity, intensity, intensity, 255 };
+            }
         }
     }
 
+    RL_FREE(row);
+}
+
+static void perlin_generate(PerlinJob *job, int x_off, float lacunarity, float gain, int octaves, int threads)
+{
+    int width = job->width, height = job->height;
+    job->aspectRatio = (float)width / (float)height;
+
+    // Calculate a better perlin noise using fbm (fractal brownian motion)
+    // Typical values to start playing with:
+    //   lacunarity = ~2.0   -- spacing between successive octaves (use exactly 2.0 for wrapping output)
+    //   gain       =  0.5   -- relative weighting applied to each successive octave
+    //   octaves    =  6     -- number of "octaves" of noise3() to sum
+    // z is fixed at 1.0 so only a 2d slice is evaluated, a row at a time (see noise.h)
+    Fbm fbm = fbm_init(1.0f, lacunarity, gain, octaves);
+    job->fbm = &fbm;
+
+    // x coordinates are the same for every row
+    float *xs = (float *)RL_MALLOC(width*sizeof(float));
+    for (int x = 0; x < width; x++)
+    {
+        xs[x] = (float)(x + x_off)*(job->scale/(float)width);
+        // Apply aspect ratio compensation to wider side
+        if (width > height) xs[x] *= job->aspectRatio;
+    }
+    job->xs = xs;
+
+    // every pixel only depends on its own coordinates, so any split of the
+    // rows gives the same image
+    parallel_for(height, ROW_BATCH, threads, perlin_rows, job);
+
+    RL_FREE(xs);
+}
+
+Image my_perlin_image_mt(int width, int height, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves, int threads)
+{
+    Color *pixels = (Color *)RL_MALLOC(width*height*sizeof(Color));
+
+    PerlinJob job = { .pixels = pixels, .width = width, .height = height, .y_off = y_off, .scale = scale };
+    perlin_generate(&job, x_off, lacunarity, gain, octaves, threads);
+
     Image image = {
         .data = pixels,
         .width = width,
@@ -50,3 +119,33 @@ Image my_perlin_image(int width, int height, int x_off, int y_off, float scale,
 
     return image;
 }
+
+void perlin_heightfield(Heightfield *hf, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves, int threads)
+{
+    int width = hf->width, length = hf->length;
+    float aspectRatio = (float)width / (float)length;
+
+    // height = (noise + 1)/2*max_height, and one sample step moves the noise
+    // coordinates by the same factors perlin_rows uses
+    float dx = scale/(float)width, dz = scale/(float)length;
+    if (width > length) dx *= aspectRatio;
+    else dz /= aspectRatio;
+
+    PerlinJob job = {
+        .heights = hf->heights,
+        .slopes = hf->slopes,
+        .max_height = hf->max_height,
+        .slope_x = 0.5f*hf->max_height*dx/hf->spacing,
+        .slope_z = 0.5f*hf->max_height*dz/hf->spacing,
+        .width = width,
+        .height = length,
+        .y_off = y_off,
+        .scale = scale
+    };
+    perlin_generate(&job, x_off, lacunarity, gain, octaves, threads);
+}
+
+Image my_perlin_image(int width, int height, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves)
+{
+    return my_perlin_image_mt(width, height, x_off, y_off, scale, lacunarity, gain, octaves, 1);
+}
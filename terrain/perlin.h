@@ -0,0 +1,18 @@
+#ifndef PERLIN_H
+#define PERLIN_H
+
+#include <raylib.h>
+
+#include "heightfield.h"
+
+// grayscale fbm heightmap, single threaded
+Image my_perlin_image(int width, int height, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves);
+// same image split over `threads` workers (<= 0 for one per cpu), the
+// output is bit-identical to my_perlin_image for any thread count
+Image my_perlin_image_mt(int width, int height, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves, int threads);
+// same noise written straight into hf (width x length samples) as floats in
+// [0, max_height], no 8 bit quantization. if hf has slopes they are filled
+// from the analytic noise derivatives in the same pass
+void perlin_heightfield(Heightfield *hf, int x_off, int y_off, float scale, float lacunarity, float gain, int octaves, int threads);
+
+#endif
@@ -0,0 +1,110 @@
+#include "player.h"
+
+#include <raymath.h>
+#include <rcamera.h>
+
+#include "blocks.h"
+
+#define JUMP 60.0f
+#define LOOK_SPEED 0.1f // degrees per pixel
+#define TICK_DT (1.0f / PLAYER_TICK_RATE)
+
+//---Input---
+
+Player player_init(Camera3D camera, float height, float speed) {
+  return (Player){.camera = camera, .height = height, .speed = speed, .jump_force = JUMP};
+}
+
+PlayerInput player_input(const FrameInput *frame) {
+  return (PlayerInput){
+      .forward = input_down(frame, INPUT_FORWARD) - input_down(frame, INPUT_BACK),
+      .right = input_down(frame, INPUT_RIGHT) - input_down(frame, INPUT_LEFT),
+      .sprint = input_down(frame, INPUT_SPRINT),
+      .jump = input_down(frame, INPUT_JUMP),
+      .toggle_jump = input_pressed(frame, INPUT_TOGGLE_JUMP),
+      .look = frame->look,
+  };
+}
+
+void player_input_merge(PlayerInput *pending, PlayerInput frame) {
+  frame.toggle_jump = frame.toggle_jump != pending->toggle_jump; // two presses cancel out
+  frame.look = Vector2Add(pending->look, frame.look);
+  *pending = frame;
+}
+
+//---Simulation---
+
+static void move_position(Player *player, Vector3 move) {
+  player->camera.position = Vector3Add(player->camera.position, move);
+  player->camera.target = Vector3Add(player->camera.target, move);
+}
+
+void player_tick(Player *player, const PlayerInput *input, const ChunkManager *chunks, const VoxelWorld *voxels) {
+  float dt = TICK_DT;
+  float speed = input->sprint ? player->speed * 4 : player->speed;
+  Vector3 rot = {input->look.x * LOOK_SPEED, input->look.y * LOOK_SPEED, 0};
+  Vector3 dr = {input->forward * speed * dt, input->right * speed * dt, 0};
+
+  // Block Collsion
+  bool floor = blocks_collide(voxels, &player->camera, player->height, player->vel_y, dt, &dr);
+
+  UpdateCameraPro(&player->camera, dr, rot, 0);
+
+  // Handle Terrain collision
+  Vector3 player_pos = player->camera.position;
+  float mesh_y;
+  if (chunks_height(chunks, player_pos.x, player_pos.z, &mesh_y)) {
+    float epsilon = 1; // subtract epsilon for more lenient jumping
+
+    floor = floor || (player_pos.y - player->height - epsilon <= mesh_y);
+    if (player_pos.y - player->height <= mesh_y) {
+      float y_move = mesh_y + player->height - player_pos.y;
+      player->vel_y -= 100;
+      move_position(player, (Vector3){0, y_move, 0});
+    }
+  }
+
+  player->on_floor = floor;
+  if (floor) {
+    player->vel_y = 0;
+  } else {
+    player->vel_y -= GRAVITY * dt;
+  }
+
+  // Jump
+  if (input->toggle_jump) {
+    player->jump_force = player->jump_force == JUMP ? JUMP * 3 : JUMP;
+  }
+  if (floor && input->jump) {
+    player->vel_y = player->jump_force;
+  }
+
+  move_position(player, (Vector3){0, player->vel_y * dt, 0});
+}
+
+//---Clock---
+
+int player_clock_advance(PlayerClock *clock, double dt) {
+  clock->accumulator += dt;
+  int ticks = 0;
+  while (clock->accumulator >= TICK_DT && ticks < PLAYER_MAX_TICKS) {
+    clock->accumulator -= TICK_DT;
+    ticks++;
+  }
+  // a long stall, catching up would only make the next frame longer
+  if (clock->accumulator >= TICK_DT)
+    clock->accumulator = 0;
+  clock->ticks += ticks;
+  return ticks;
+}
+
+float player_clock_alpha(const PlayerClock *clock) {
+  return (float)(clock->accumulator * PLAYER_TICK_RATE);
+}
+
+Camera3D player_camera_lerp(const Player *previous, const Player *current, float alpha) {
+  Camera3D camera = current->camera;
+  camera.position = Vector3Lerp(previous->camera.position, current->camera.position, alpha);
+  camera.target = Vector3Lerp(previous->camera.target, current->camera.target, alpha);
+  return camera;
+}
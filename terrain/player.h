@@ -0,0 +1,61 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include <raylib.h>
+
+#include "chunks.h"
+#include "input.h"
+#include "voxels.h"
+
+// the player as a fixed timestep simulation. the state only changes in
+// player_tick, by a constant dt and from a PlayerInput, so the same inputs
+// over the same world always give bit identical state whatever the frame
+// rate. the camera that gets drawn is interpolated between the last two ticks
+
+#define PLAYER_TICK_RATE 120 // ticks per second
+#define GRAVITY 100.0f       // world units per second squared, entities fall the same
+#define PLAYER_MAX_TICKS 8   // per frame, past that the game slows down instead of spiralling
+
+// what the player did since the last tick
+typedef struct PlayerInput {
+  signed char forward, right; // -1, 0 or 1
+  bool sprint;
+  bool jump;        // held
+  bool toggle_jump; // pressed, switches between normal and high jumps
+  Vector2 look;     // mouse movement in pixels
+} PlayerInput;
+
+typedef struct Player {
+  Camera3D camera; // at the eyes
+  float height;
+  float speed; // world units per second walking, 4x sprinting
+  float vel_y;
+  float jump_force;
+  bool on_floor;
+} Player;
+
+// runs ticks off the frame time, the remainder waits for the next frame
+typedef struct PlayerClock {
+  double accumulator; // seconds not simulated yet
+  long ticks;         // since the start
+} PlayerClock;
+
+Player player_init(Camera3D camera, float height, float speed);
+// the player's part of a frame's input
+PlayerInput player_input(const FrameInput *frame);
+// adds what happened in a frame to input not simulated yet. keys held are
+// the latest, presses and mouse movement accumulate until a tick uses them
+void player_input_merge(PlayerInput *pending, PlayerInput frame);
+
+// one tick of 1 / PLAYER_TICK_RATE seconds. terrain that isn't loaded
+// doesn't hold the player up
+void player_tick(Player *player, const PlayerInput *input, const ChunkManager *chunks, const VoxelWorld *voxels);
+// the number of ticks dt seconds of frame time are worth, at most
+// PLAYER_MAX_TICKS. time beyond that is dropped
+int player_clock_advance(PlayerClock *clock, double dt);
+// how far between the previous tick and the latest one a frame is, 0 to 1
+float player_clock_alpha(const PlayerClock *clock);
+// the camera alpha of the way from previous to current
+Camera3D player_camera_lerp(const Player *previous, const Player *current, float alpha);
+
+#endif
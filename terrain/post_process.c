@@ -0,0 +1,163 @@
+#include "post_process.h"
+
+#include <raymath.h>
+#include <rcamera.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SUN_DIRECTION ((Vector3){0.2f, 0.2f, 0.0f}) // towards the sun
+#define SUN_DISTANCE 1000.0f
+
+typedef struct EffectInfo {
+  const char *name; // the glsl function
+  const char *path;
+  bool depth; // reads the depth texture
+} EffectInfo;
+
+static const EffectInfo effects[POST_EFFECT_COUNT] = {
+    [POST_SUN] = {"sun", "terrain/sun.glsl", false},
+    [POST_FOG] = {"fog", "terrain/fog.glsl", true},
+};
+
+typedef struct UniformInfo {
+  const char *name;
+  PostEffect effect;
+  int type; // SHADER_UNIFORM_FLOAT to VEC4
+} UniformInfo;
+
+static const UniformInfo uniforms[POST_UNIFORM_COUNT] = {
+    [POST_SUN_SCREEN] = {"sunScreen", POST_SUN, SHADER_UNIFORM_VEC3},
+    [POST_FOG_DENSITY] = {"fogDensity", POST_FOG, SHADER_UNIFORM_FLOAT},
+    [POST_FOG_COLOR] = {"fogColor", POST_FOG, SHADER_UNIFORM_VEC3},
+};
+
+static int components(PostUniform u) { return uniforms[u].type - SHADER_UNIFORM_FLOAT + 1; }
+
+//---Shader---
+
+// appends text to buf, which grows as needed
+static void append(char **buf, size_t *len, size_t *cap, const char *text) {
+  size_t n = strlen(text);
+  if (*len + n + 1 > *cap) {
+    *cap = (*len + n + 1) * 2;
+    *buf = RL_REALLOC(*buf, *cap);
+  }
+  memcpy(*buf + *len, text, n + 1);
+  *len += n;
+}
+
+char *post_process_source(unsigned int mask) {
+  bool depth = false;
+  for (int e = 0; e < POST_EFFECT_COUNT; e++)
+    depth = depth || ((mask & POST_EFFECT_BIT(e)) && effects[e].depth);
+
+  char *buf = NULL;
+  size_t len = 0, cap = 0;
+  append(&buf, &len, &cap,
+         "#version 330 core\n\n"
+         "in vec2 fragTexCoord;\n\n"
+         "out vec4 outColor;\n\n"
+         "uniform sampler2D texture0;\n");
+  if (depth)
+    append(&buf, &len, &cap, "uniform sampler2D depthTexture;\n");
+
+  for (int e = 0; e < POST_EFFECT_COUNT; e++) {
+    if (!(mask & POST_EFFECT_BIT(e)))
+      continue;
+    char *text = LoadFileText(effects[e].path);
+    if (!text) {
+      TRACELOG(LOG_WARNING, "POST: [%s] Failed to load effect", effects[e].path);
+      RL_FREE(buf);
+      return NULL;
+    }
+    append(&buf, &len, &cap, "\n");
+    append(&buf, &len, &cap, text);
+    UnloadFileText(text);
+  }
+
+  append(&buf, &len, &cap, "\nvoid main() {\n    vec3 color = texture(texture0, fragTexCoord).rgb;\n");
+  append(&buf, &len, &cap,
+         depth ? "    float depth = texture(depthTexture, fragTexCoord).r;\n" : "    float depth = 1.0;\n");
+  for (int e = 0; e < POST_EFFECT_COUNT; e++) {
+    if (!(mask & POST_EFFECT_BIT(e)))
+      continue;
+    char line[128];
+    snprintf(line, sizeof(line), "    color = %s(color, fragTexCoord, depth);\n", effects[e].name);
+    append(&buf, &len, &cap, line);
+  }
+  append(&buf, &len, &cap, "    outColor = vec4(color, 1.0);\n}\n");
+  return buf;
+}
+
+static void build(PostProcess *pp, unsigned int mask) {
+  pp->effects = mask;
+  char *source = post_process_source(mask);
+  bool ok = source != NULL;
+  // without the source raylib's default shader just copies the scene
+  pp->shader = LoadShaderFromMemory(NULL, source);
+  RL_FREE(source);
+
+  pp->loc_depth = GetShaderLocation(pp->shader, "depthTexture");
+  for (int u = 0; u < POST_UNIFORM_COUNT; u++) {
+    bool on = ok && (mask & POST_EFFECT_BIT(uniforms[u].effect));
+    pp->locs[u] = on ? GetShaderLocation(pp->shader, uniforms[u].name) : -1;
+    pp->stale[u] = true; // a new program starts from zeros
+  }
+}
+
+void post_process_init(PostProcess *pp, unsigned int effects) {
+  *pp = (PostProcess){0};
+  build(pp, effects);
+}
+
+void post_process_unload(PostProcess *pp) { UnloadShader(pp->shader); }
+
+void post_process_set_effects(PostProcess *pp, unsigned int effects) {
+  if (effects == pp->effects)
+    return;
+  UnloadShader(pp->shader);
+  build(pp, effects);
+}
+
+//---Uniforms---
+
+void post_process_set(PostProcess *pp, PostUniform uniform, const float *value) {
+  size_t size = components(uniform) * sizeof(float);
+  if (memcmp(pp->values[uniform], value, size) != 0) {
+    memcpy(pp->values[uniform], value, size);
+    pp->stale[uniform] = true;
+  }
+}
+
+void post_process_set_camera(PostProcess *pp, Camera3D camera, float aspect) {
+  // the sun's clip space position, w > 0 in front of the camera
+  Vector3 p = Vector3Scale(Vector3Normalize(SUN_DIRECTION), SUN_DISTANCE);
+  Matrix m = MatrixMultiply(GetCameraMatrix(camera), GetCameraProjectionMatrix(&camera, aspect));
+  float x = m.m0 * p.x + m.m4 * p.y + m.m8 * p.z + m.m12;
+  float y = m.m1 * p.x + m.m5 * p.y + m.m9 * p.z + m.m13;
+  float w = m.m3 * p.x + m.m7 * p.y + m.m11 * p.z + m.m15;
+  float screen[3] = {0, 0, 0};
+  if (w > 0)
+    screen[0] = x / w * 0.5f + 0.5f, screen[1] = y / w * 0.5f + 0.5f, screen[2] = 1;
+  post_process_set(pp, POST_SUN_SCREEN, screen);
+}
+
+//---Draw---
+
+void post_process_draw(PostProcess *pp, RenderTexture scene) {
+  pp->uploads = 0;
+  for (int u = 0; u < POST_UNIFORM_COUNT; u++) {
+    if (pp->locs[u] < 0 || !pp->stale[u])
+      continue;
+    SetShaderValue(pp->shader, pp->locs[u], pp->values[u], uniforms[u].type);
+    pp->stale[u] = false;
+    pp->uploads++;
+  }
+
+  Rectangle rec = {0, 0, scene.texture.width, -scene.texture.height};
+  BeginShaderMode(pp->shader);
+  if (pp->loc_depth >= 0)
+    SetShaderValueTexture(pp->shader, pp->loc_depth, scene.depth);
+  DrawTextureRec(scene.texture, rec, (Vector2){0, 0}, WHITE);
+  EndShaderMode();
+}
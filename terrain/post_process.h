@@ -0,0 +1,57 @@
+#ifndef POST_PROCESS_H
+#define POST_PROCESS_H
+
+#include <raylib.h>
+
+// the post processing effects composed into one generated fragment shader and
+// run as a single full screen pass from the scene's color and depth straight
+// to the screen. each effect is a glsl file with a
+// vec3 <name>(vec3 color, vec2 uv, float depth) function, they apply in enum
+// order each on what the one before left, so another effect is another entry
+// in the tables in post_process.c, not another pass or render target
+
+typedef enum PostEffect {
+  POST_SUN, // sun.glsl
+  POST_FOG, // fog.glsl
+  POST_EFFECT_COUNT
+} PostEffect;
+
+#define POST_EFFECT_BIT(effect) (1u << (effect))
+
+// what the effects read. locations are looked up once per build, values are
+// kept on the cpu and only uploaded when they change
+typedef enum PostUniform {
+  POST_SUN_SCREEN,  // vec3, see post_process_set_camera
+  POST_FOG_DENSITY, // float
+  POST_FOG_COLOR,   // vec3
+  POST_UNIFORM_COUNT
+} PostUniform;
+
+typedef struct PostProcess {
+  Shader shader;
+  unsigned int effects; // POST_EFFECT_BITs the shader was built with
+  int loc_depth;        // -1 if no effect reads depth
+  int locs[POST_UNIFORM_COUNT]; // -1 for effects that are off
+  float values[POST_UNIFORM_COUNT][4];
+  bool stale[POST_UNIFORM_COUNT]; // values the shader doesn't have yet
+  int uploads; // uniforms uploaded by the last post_process_draw
+} PostProcess;
+
+// effects is a mask of POST_EFFECT_BITs
+void post_process_init(PostProcess *pp, unsigned int effects);
+void post_process_unload(PostProcess *pp);
+// rebuilds the shader if the effects changed, uniform values carry over
+void post_process_set_effects(PostProcess *pp, unsigned int effects);
+// the fragment shader for the effects, RL_FREE it. NULL if an effect's file
+// can't be read
+char *post_process_source(unsigned int effects);
+
+// as many floats as the uniform has components
+void post_process_set(PostProcess *pp, PostUniform uniform, const float *value);
+// the uniforms that follow the camera, the sun's screen position for now
+void post_process_set_camera(PostProcess *pp, Camera3D camera, float aspect);
+// the scene through the effects into whatever is being drawn to, inside
+// BeginDrawing. scene needs a depth texture if an effect reads depth
+void post_process_draw(PostProcess *pp, RenderTexture scene);
+
+#endif
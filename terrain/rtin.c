@@ -0,0 +1,279 @@
+#include "rtin.h"
+
+#include <math.h>
+#include <raymath.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---Errors---
+
+bool rtin_init(Rtin *rtin, const Heightfield *hf) {
+  *rtin = (Rtin){0};
+  int n = hf->width - 1;
+  if (hf->width != hf->length || n < 2 || (n & (n - 1))) {
+    TRACELOG(LOG_WARNING, "RTIN: needs a square 2^k + 1 heightfield, got %dx%d", hf->width, hf->length);
+    return false;
+  }
+
+  int size = hf->width;
+  const float *h = hf->heights;
+  float *e = RL_CALLOC((size_t)size * size, sizeof(float));
+  rtin->size = size;
+  rtin->errors = e;
+
+  // bottom up a level at a time instead of per triangle, so no table of
+  // triangle corners (which would be gigabytes at 4k). at step s the axis
+  // aligned hypotenuses are 2s long and their midpoints have children at the
+  // centres of the s squares around them (none at s = 1, those are the grid
+  // cells), then the diagonals of the 2s squares have the four edge midpoints
+  // as children
+  for (int s = 1; s < n; s *= 2) {
+    int s2 = s * 2, half = s / 2;
+
+    for (int z = 0; z <= n; z += s) {
+      bool along_x = z % s2 == 0;
+      int step = along_x ? 1 : size;
+      for (int x = along_x ? s : 0; x <= n; x += s2) {
+        int i = z * size + x;
+        float own = fabsf((h[i - s * step] + h[i + s * step]) * 0.5f - h[i]);
+        float child = 0;
+        if (half) {
+          int x0 = x - half, x1 = x + half, z0 = z - half, z1 = z + half;
+          if (z0 >= 0 && x0 >= 0) child = fmaxf(child, e[z0 * size + x0]);
+          if (z0 >= 0 && x1 <= n) child = fmaxf(child, e[z0 * size + x1]);
+          if (z1 <= n && x0 >= 0) child = fmaxf(child, e[z1 * size + x0]);
+          if (z1 <= n && x1 <= n) child = fmaxf(child, e[z1 * size + x1]);
+        }
+        e[i] = own + child;
+      }
+    }
+
+    // the diagonals alternate like a checkerboard, the whole square's runs
+    // from (0, 0) to (n, n)
+    for (int z = s; z < n; z += s2) {
+      for (int x = s; x < n; x += s2) {
+        int i = z * size + x;
+        int diagonal = (x / s2 + z / s2) % 2 ? s * size - s : s * size + s;
+        float own = fabsf((h[i - diagonal] + h[i + diagonal]) * 0.5f - h[i]);
+        float child = fmaxf(fmaxf(e[i - s], e[i + s]), fmaxf(e[i - s * size], e[i + s * size]));
+        e[i] = own + child;
+      }
+    }
+  }
+  return true;
+}
+
+void rtin_unload(Rtin *rtin) {
+  RL_FREE(rtin->errors);
+  *rtin = (Rtin){0};
+}
+
+//---Mesh---
+
+typedef struct RtinWalk {
+  const float *errors;
+  int size;
+  float max_error;
+  unsigned int *vertex_of; // sample -> vertex + 1, 0 if unused
+  unsigned int *skirt_of;  // border position -> skirt vertex, NULL without skirts
+  unsigned int *out;       // NULL while counting
+  int triangles;
+  int border_edges;
+} RtinWalk;
+
+// position along the border going around from (0, 0) through (n, 0), -1
+// inside. corners come out the same from both of their sides
+static int border_position(int x, int z, int n) {
+  if (z == 0)
+    return x;
+  if (x == n)
+    return n + z;
+  if (z == n)
+    return 3 * n - x;
+  if (x == 0)
+    return (4 * n - z) % (4 * n);
+  return -1;
+}
+
+static void border_sample(int p, int n, int *x, int *z) {
+  *x = p <= n ? p : p <= 2 * n ? n : p <= 3 * n ? 3 * n - p : 0;
+  *z = p <= n ? 0 : p <= 2 * n ? p - n : p <= 3 * n ? n : 4 * n - p;
+}
+
+// a strip from the edge u -> w straight down to the skirt vertices, facing
+// out since the interior is always on the same side of a triangle's edges
+static void rtin_skirt(RtinWalk *w, int ux, int uz, int wx, int wz) {
+  int n = w->size - 1;
+  if (!((ux == wx && (ux == 0 || ux == n)) || (uz == wz && (uz == 0 || uz == n))))
+    return;
+  w->border_edges++;
+  if (!w->out)
+    return;
+
+  unsigned int u = w->vertex_of[uz * w->size + ux] - 1, v = w->vertex_of[wz * w->size + wx] - 1;
+  unsigned int u_low = w->skirt_of[border_position(ux, uz, n)], v_low = w->skirt_of[border_position(wx, wz, n)];
+  *w->out++ = u;
+  *w->out++ = u_low;
+  *w->out++ = v;
+  *w->out++ = v;
+  *w->out++ = u_low;
+  *w->out++ = v_low;
+}
+
+// triangle a, b, c with the hypotenuse a - b and the right angle at c, the
+// children keep the winding so every triangle faces up
+static void rtin_walk(RtinWalk *w, int ax, int az, int bx, int bz, int cx, int cz) {
+  int mx = (ax + bx) >> 1, mz = (az + bz) >> 1;
+  if (abs(ax - cx) + abs(az - cz) > 1 && w->errors[mz * w->size + mx] > w->max_error) {
+    rtin_walk(w, cx, cz, ax, az, mx, mz);
+    rtin_walk(w, bx, bz, cx, cz, mx, mz);
+    return;
+  }
+
+  int a = az * w->size + ax, b = bz * w->size + bx, c = cz * w->size + cx;
+  if (w->out) {
+    *w->out++ = w->vertex_of[a] - 1;
+    *w->out++ = w->vertex_of[b] - 1;
+    *w->out++ = w->vertex_of[c] - 1;
+  } else {
+    w->vertex_of[a] = w->vertex_of[b] = w->vertex_of[c] = 1;
+  }
+  w->triangles++;
+
+  if (w->skirt_of) {
+    rtin_skirt(w, ax, az, bx, bz);
+    rtin_skirt(w, bx, bz, cx, cz);
+    rtin_skirt(w, cx, cz, ax, az);
+  }
+}
+
+static void rtin_walk_roots(RtinWalk *w) {
+  int n = w->size - 1;
+  rtin_walk(w, 0, 0, n, n, n, 0);
+  rtin_walk(w, n, n, 0, 0, 0, n);
+}
+
+TerrainMesh rtin_build_mesh(const Rtin *rtin, const Heightfield *hf, const float *normals, float max_error,
+                            float skirt, TerrainIndices *indices) {
+  int size = rtin->size, n = size - 1;
+  RtinWalk w = {
+      .errors = rtin->errors,
+      .size = size,
+      .max_error = max_error,
+      .vertex_of = RL_CALLOC((size_t)size * size, sizeof(unsigned int)),
+      .skirt_of = skirt > 0 ? RL_CALLOC(4 * n, sizeof(unsigned int)) : NULL,
+  };
+
+  // first walk marks the samples in use, numbered in row order so the
+  // vertices keep the heightfield's locality
+  rtin_walk_roots(&w);
+  int vertex_count = 0, skirt_count = 0;
+  for (int i = 0; i < size * size; i++) {
+    if (w.vertex_of[i])
+      w.vertex_of[i] = ++vertex_count;
+  }
+  // skirt vertices go after the surface, one below every border vertex
+  for (int p = 0; w.skirt_of && p < 4 * n; p++) {
+    int x, z;
+    border_sample(p, n, &x, &z);
+    if (w.vertex_of[z * size + x])
+      w.skirt_of[p] = vertex_count + skirt_count++;
+  }
+
+  TerrainMesh mesh = {.vertex_count = vertex_count + skirt_count};
+  float *restrict vertices = mesh.vertices = RL_MALLOC(mesh.vertex_count * 3 * sizeof(float));
+  float *restrict out_normals = mesh.normals = RL_MALLOC(mesh.vertex_count * 3 * sizeof(float));
+  float *restrict texcoords = mesh.texcoords = RL_MALLOC(mesh.vertex_count * 2 * sizeof(float));
+  float s = hf->spacing, uv_step = 1.0f / (size - 1);
+  for (int z = 0; z < size; z++) {
+    for (int x = 0; x < size; x++) {
+      int i = z * size + x;
+      if (!w.vertex_of[i])
+        continue;
+      int v = w.vertex_of[i] - 1;
+      vertices[v * 3] = x * s;
+      vertices[v * 3 + 1] = hf->heights[i];
+      vertices[v * 3 + 2] = z * s;
+      texcoords[v * 2] = x * uv_step;
+      texcoords[v * 2 + 1] = z * uv_step;
+      if (normals) {
+        memcpy(&out_normals[v * 3], &normals[i * 3], 3 * sizeof(float));
+      } else {
+        Vector3 normal = heightfield_normal(hf, x, z);
+        out_normals[v * 3] = normal.x;
+        out_normals[v * 3 + 1] = normal.y;
+        out_normals[v * 3 + 2] = normal.z;
+      }
+    }
+  }
+
+  for (int p = 0; w.skirt_of && p < 4 * n; p++) {
+    int x, z;
+    border_sample(p, n, &x, &z);
+    int i = z * size + x;
+    if (!w.vertex_of[i])
+      continue;
+    unsigned int top = w.vertex_of[i] - 1, low = w.skirt_of[p];
+    memcpy(&vertices[low * 3], &vertices[top * 3], 3 * sizeof(float));
+    memcpy(&out_normals[low * 3], &out_normals[top * 3], 3 * sizeof(float));
+    memcpy(&texcoords[low * 2], &texcoords[top * 2], 2 * sizeof(float));
+    vertices[low * 3 + 1] -= skirt;
+  }
+
+  *indices = (TerrainIndices){.width = size, .length = size, .count = (w.triangles + w.border_edges * 2) * 3};
+  indices->indices = RL_MALLOC((size_t)indices->count * sizeof(unsigned int));
+  w.out = indices->indices;
+  w.triangles = w.border_edges = 0;
+  rtin_walk_roots(&w);
+
+  RL_FREE(w.vertex_of);
+  RL_FREE(w.skirt_of);
+  return mesh;
+}
+
+//---Queries---
+
+bool rtin_height(const Rtin *rtin, const Heightfield *hf, float max_error, float x, float z, float *height,
+                 Vector3 *normal) {
+  int size = rtin->size, n = size - 1;
+  float px = x / hf->spacing, pz = z / hf->spacing;
+  if (!(px >= 0 && pz >= 0 && px <= n && pz <= n))
+    return false;
+
+  int ax, az, bx, bz, cx, cz;
+  if (px >= pz) {
+    ax = 0, az = 0, bx = n, bz = n, cx = n, cz = 0;
+  } else {
+    ax = n, az = n, bx = 0, bz = 0, cx = 0, cz = n;
+  }
+
+  for (;;) {
+    int mx = (ax + bx) >> 1, mz = (az + bz) >> 1;
+    if (abs(ax - cx) + abs(az - cz) <= 1 || rtin->errors[mz * size + mx] <= max_error)
+      break;
+    // the split runs from c to m, keep the child on the point's side
+    float side_p = (mx - cx) * (pz - cz) - (mz - cz) * (px - cx);
+    float side_a = (float)((mx - cx) * (az - cz) - (mz - cz) * (ax - cx));
+    if (side_p * side_a >= 0) {
+      bx = ax, bz = az;
+      ax = cx, az = cz;
+    } else {
+      ax = bx, az = bz;
+      bx = cx, bz = cz;
+    }
+    cx = mx, cz = mz;
+  }
+
+  float ha = heightfield_at(hf, ax, az), hb = heightfield_at(hf, bx, bz), hc = heightfield_at(hf, cx, cz);
+  float la, lb, lc;
+  barycentric_coordinates((Vector2){px, pz}, (Vector2){ax, az}, (Vector2){bx, bz}, (Vector2){cx, cz}, &la, &lb, &lc);
+  *height = la * ha + lb * hb + lc * hc;
+  if (normal) {
+    float s = hf->spacing;
+    Vector3 a = {ax * s, ha, az * s}, b = {bx * s, hb, bz * s}, c = {cx * s, hc, cz * s};
+    *normal = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(c, a), Vector3Subtract(b, a)));
+    if (normal->y < 0)
+      *normal = Vector3Negate(*normal);
+  }
+  return true;
+}
@@ -0,0 +1,43 @@
+#ifndef RTIN_H
+#define RTIN_H
+
+#include <raylib.h>
+
+#include "heightfield.h"
+#include "terrain_mesh.h"
+
+// error bounded adaptive triangulation (right triangulated irregular network).
+// the square is split along its diagonal and every right triangle is split at
+// the midpoint of its hypotenuse, down to the grid cells. each midpoint stores
+// how far the surface can move if it is left out: its own distance from the
+// hypotenuse plus the worst of the midpoints below it. a mesh for any error is
+// then one walk that stops splitting where the stored error is small enough,
+// and since neighbours share the midpoint of their common edge they always
+// agree and there are no cracks.
+
+typedef struct Rtin {
+  int size;      // samples per side, 2^k + 1
+  float *errors; // per sample, row major like the heights
+} Rtin;
+
+// computes the errors, O(samples). false (and nothing allocated) unless the
+// heightfield is square with 2^k + 1 samples per side
+bool rtin_init(Rtin *rtin, const Heightfield *hf);
+void rtin_unload(Rtin *rtin);
+
+// cpu side mesh where every heightfield sample is within max_error of the
+// surface, only the samples used become vertices. the index buffer is the
+// mesh's own and goes to terrain_mesh_upload / draw like a shared one.
+// normals (per sample, xyz) are copied when given, otherwise they come from
+// the heightfield like terrain_mesh_build. skirt > 0 hangs a strip that deep
+// under the border: neighbours simplify their shared edge independently, so
+// tiles leave gaps of up to 2 * max_error that a skirt that deep covers
+TerrainMesh rtin_build_mesh(const Rtin *rtin, const Heightfield *hf, const float *normals, float max_error,
+                            float skirt, TerrainIndices *indices);
+// height and normal of the mesh built with the same max_error at local
+// (x, z), false when outside. walks the same splits down to the one
+// triangle, O(log samples). normal may be NULL
+bool rtin_height(const Rtin *rtin, const Heightfield *hf, float max_error, float x, float z, float *height,
+                 Vector3 *normal);
+
+#endif
@@ -0,0 +1,97 @@
+#include "sculpt.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---Brush---
+
+float sculpt_falloff(const SculptBrush *brush, float distance) {
+  // (1 - t^2)^2, flat in the middle and at the rim so strokes don't leave edges
+  float t = distance / brush->radius;
+  if (!(t < 1))
+    return 0;
+  float k = 1 - t * t;
+  return k * k;
+}
+
+float sculpt_sample(const SculptBrush *brush, float height, float average, float weight, float dt) {
+  float amount = brush->strength * weight * dt;
+  switch (brush->tool) {
+  case SCULPT_RAISE:
+    return height + amount;
+  case SCULPT_LOWER:
+    return height - amount;
+  case SCULPT_FLATTEN:
+    return height + (brush->height - height) * fminf(amount, 1);
+  case SCULPT_SMOOTH:
+    return height + (average - height) * fminf(amount, 1);
+  }
+  return height;
+}
+
+//---Heightfield---
+
+bool sculpt_rect(const Heightfield *hf, float radius, float x, float z, HeightfieldRect *rect) {
+  // clamped as floats first, a far away brush would overflow the ints
+  float s = hf->spacing;
+  float x0 = fmaxf(ceilf((x - radius) / s), 0), x1 = fminf(floorf((x + radius) / s), hf->width - 1);
+  float z0 = fmaxf(ceilf((z - radius) / s), 0), z1 = fminf(floorf((z + radius) / s), hf->length - 1);
+  if (!(x0 <= x1 && z0 <= z1))
+    return false;
+  *rect = (HeightfieldRect){(int)x0, (int)z0, (int)x1, (int)z1};
+  return true;
+}
+
+// missing neighbours at the border count as the sample itself
+static float neighbour_average(const Heightfield *hf, int x, int z) {
+  float h = heightfield_at(hf, x, z);
+  float left = x > 0 ? heightfield_at(hf, x - 1, z) : h, right = x < hf->width - 1 ? heightfield_at(hf, x + 1, z) : h;
+  float back = z > 0 ? heightfield_at(hf, x, z - 1) : h, front = z < hf->length - 1 ? heightfield_at(hf, x, z + 1) : h;
+  return (left + right + back + front) * 0.25f;
+}
+
+bool sculpt_heightfield(Heightfield *hf, const SculptBrush *brush, float x, float z, float dt,
+                        HeightfieldRect *dirty) {
+  HeightfieldRect r;
+  if (!sculpt_rect(hf, brush->radius, x, z, &r))
+    return false;
+
+  // into a copy first, smoothing has to see the old neighbours
+  int w = heightfield_rect_width(r);
+  float *next = RL_MALLOC((size_t)w * heightfield_rect_length(r) * sizeof(float));
+  for (int sz = r.z0; sz <= r.z1; sz++) {
+    float dz = sz * hf->spacing - z;
+    for (int sx = r.x0; sx <= r.x1; sx++) {
+      float dx = sx * hf->spacing - x;
+      float h = heightfield_at(hf, sx, sz);
+      float average = brush->tool == SCULPT_SMOOTH ? neighbour_average(hf, sx, sz) : h;
+      next[(sz - r.z0) * w + sx - r.x0] =
+          sculpt_sample(brush, h, average, sculpt_falloff(brush, sqrtf(dx * dx + dz * dz)), dt);
+    }
+  }
+  for (int sz = r.z0; sz <= r.z1; sz++)
+    memcpy(&hf->heights[sz * hf->width + r.x0], &next[(sz - r.z0) * w], w * sizeof(float));
+  RL_FREE(next);
+
+  // central differences reach one sample out
+  *dirty = (HeightfieldRect){
+      r.x0 > 0 ? r.x0 - 1 : 0,
+      r.z0 > 0 ? r.z0 - 1 : 0,
+      r.x1 < hf->width - 1 ? r.x1 + 1 : r.x1,
+      r.z1 < hf->length - 1 ? r.z1 + 1 : r.z1,
+  };
+
+  // the analytic slopes don't describe the edit anymore, differences of the
+  // new heights do
+  for (int sz = dirty->z0; hf->slopes && sz <= dirty->z1; sz++) {
+    int z0 = sz > 0 ? sz - 1 : sz, z1 = sz < hf->length - 1 ? sz + 1 : sz;
+    for (int sx = dirty->x0; sx <= dirty->x1; sx++) {
+      int x0 = sx > 0 ? sx - 1 : sx, x1 = sx < hf->width - 1 ? sx + 1 : sx;
+      float *slope = &hf->slopes[(sz * hf->width + sx) * 2];
+      slope[0] = (heightfield_at(hf, x1, sz) - heightfield_at(hf, x0, sz)) / ((x1 - x0) * hf->spacing);
+      slope[1] = (heightfield_at(hf, sx, z1) - heightfield_at(hf, sx, z0)) / ((z1 - z0) * hf->spacing);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef SCULPT_H
+#define SCULPT_H
+
+#include <raylib.h>
+
+#include "heightfield.h"
+
+// terrain editing brushes. a stroke changes the samples under the brush in
+// place and reports the rectangle it touched, so meshes and textures only
+// rebuild and re-upload that part and a stroke costs the brush's area
+// whatever the terrain's size.
+
+typedef enum SculptTool {
+  SCULPT_RAISE,
+  SCULPT_LOWER,
+  SCULPT_FLATTEN, // towards brush.height
+  SCULPT_SMOOTH,  // towards the average of the four neighbours
+} SculptTool;
+
+typedef struct SculptBrush {
+  SculptTool tool;
+  float radius;   // world units, the effect fades out smoothly towards it
+  float strength; // raise and lower in world units per second at the centre,
+                  // flatten and smooth as the fraction of the way per second
+  float height;   // flatten target, heightfield local
+} SculptBrush;
+
+// brush weight at distance from the centre, 1 there and 0 from the radius on
+float sculpt_falloff(const SculptBrush *brush, float distance);
+// a sample's new height after dt seconds, average is the mean of its four
+// neighbours (only smoothing reads it)
+float sculpt_sample(const SculptBrush *brush, float height, float average, float weight, float dt);
+
+// samples within radius of local (x, z), clipped to the heightfield. false if
+// there are none
+bool sculpt_rect(const Heightfield *hf, float radius, float x, float z, HeightfieldRect *rect);
+// one stroke of dt seconds centred on local (x, z). slopes, when present, are
+// redone from the new heights around the change. dirty gets every sample whose
+// height or normal changed (the brush's rectangle grown by one), false if the
+// brush missed the heightfield
+bool sculpt_heightfield(Heightfield *hf, const SculptBrush *brush, float x, float z, float dt,
+                        HeightfieldRect *dirty);
+
+#endif
@@ -0,0 +1,17 @@
+// post process effect, glow around the sun. sunScreen is the sun's screen
+// position (0 to 1) and 1 in z when it's in front of the camera
+
+uniform vec3 sunScreen;
+
+const vec3 sunColor = vec3(1.0, 1.0, 0.6);
+const float sunSize = 0.02;
+
+vec3 sun(vec3 color, vec2 uv, float depth) {
+    if (sunScreen.z == 0.0) return color;
+
+    // Create a radial gradient for the sun
+    float dist = length(uv - sunScreen.xy);
+    float sunGlow = 1.0 - smoothstep(sunSize, sunSize * 2.5, dist);
+
+    return color + sunGlow * sunColor;
+}
@@ -0,0 +1,174 @@
+#include "terrain_mesh.h"
+
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---Indices---
+
+TerrainIndices terrain_indices_build(int width, int length) {
+  int cells_x = width - 1, cells_z = length - 1;
+  TerrainIndices indices = {
+      .width = width,
+      .length = length,
+      .count = cells_x * cells_z * 6,
+  };
+  indices.indices = RL_MALLOC((size_t)indices.count * sizeof(unsigned int));
+
+  unsigned int *out = indices.indices;
+  for (int z = 0; z < cells_z; z++) {
+    for (int x = 0; x < cells_x; x++) {
+      // two triangles split along the (x+1, z) - (x, z+1) diagonal
+      unsigned int i00 = z * width + x, i10 = i00 + 1;
+      unsigned int i01 = i00 + width, i11 = i01 + 1;
+      *out++ = i00;
+      *out++ = i01;
+      *out++ = i10;
+      *out++ = i10;
+      *out++ = i01;
+      *out++ = i11;
+    }
+  }
+  return indices;
+}
+
+void terrain_indices_upload(TerrainIndices *indices) {
+  // loaded outside any vao, each mesh binds it into its own
+  rlDisableVertexArray();
+  indices->ebo = rlLoadVertexBufferElement(indices->indices, indices->count * sizeof(unsigned int), false);
+  rlDisableVertexBufferElement();
+  RL_FREE(indices->indices);
+  indices->indices = NULL;
+}
+
+void terrain_indices_unload(TerrainIndices *indices) {
+  if (indices->ebo)
+    rlUnloadVertexBuffer(indices->ebo);
+  RL_FREE(indices->indices);
+  indices->indices = NULL;
+  indices->ebo = 0;
+}
+
+//---Mesh---
+
+TerrainMesh terrain_mesh_build(const Heightfield *hf) {
+  int width = hf->width, length = hf->length;
+  float s = hf->spacing;
+  TerrainMesh mesh = {.vertex_count = width * length};
+  float *restrict vertices = mesh.vertices = RL_MALLOC(mesh.vertex_count * 3 * sizeof(float));
+  float *restrict normals = mesh.normals = RL_MALLOC(mesh.vertex_count * 3 * sizeof(float));
+  float *restrict texcoords = mesh.texcoords = RL_MALLOC(mesh.vertex_count * 2 * sizeof(float));
+  const float *heights = hf->heights, *slopes = hf->slopes;
+  float u_step = 1.0f / (width - 1), v_step = 1.0f / (length - 1);
+
+  for (int z = 0; z < length; z++) {
+    for (int x = 0; x < width; x++) {
+      int i = z * width + x;
+      vertices[i * 3] = x * s;
+      vertices[i * 3 + 1] = heights[i];
+      vertices[i * 3 + 2] = z * s;
+      texcoords[i * 2] = x * u_step;
+      texcoords[i * 2 + 1] = z * v_step;
+
+      // the normal of y = h(x, z) is (-dh/dx, 1, -dh/dz)
+      float dx, dz;
+      if (slopes) {
+        dx = slopes[i * 2];
+        dz = slopes[i * 2 + 1];
+      } else {
+        int x0 = x > 0 ? x - 1 : x, x1 = x < width - 1 ? x + 1 : x;
+        int z0 = z > 0 ? z - 1 : z, z1 = z < length - 1 ? z + 1 : z;
+        dx = (heights[z * width + x1] - heights[z * width + x0]) / ((x1 - x0) * s);
+        dz = (heights[z1 * width + x] - heights[z0 * width + x]) / ((z1 - z0) * s);
+      }
+      Vector3 n = Vector3Normalize((Vector3){-dx, 1, -dz});
+      normals[i * 3] = n.x;
+      normals[i * 3 + 1] = n.y;
+      normals[i * 3 + 2] = n.z;
+    }
+  }
+  return mesh;
+}
+
+void terrain_mesh_upload(TerrainMesh *mesh, const TerrainIndices *indices) {
+  mesh->vao = rlLoadVertexArray();
+  rlEnableVertexArray(mesh->vao);
+
+  // same attribute slots as UploadMesh so the stock shaders work
+  mesh->vbo[0] = rlLoadVertexBuffer(mesh->vertices, mesh->vertex_count * 3 * sizeof(float), false);
+  rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, 3, RL_FLOAT, 0, 0, 0);
+  rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION);
+
+  mesh->vbo[1] = rlLoadVertexBuffer(mesh->normals, mesh->vertex_count * 3 * sizeof(float), false);
+  rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL, 3, RL_FLOAT, 0, 0, 0);
+  rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_NORMAL);
+
+  mesh->vbo[2] = rlLoadVertexBuffer(mesh->texcoords, mesh->vertex_count * 2 * sizeof(float), false);
+  rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, 2, RL_FLOAT, 0, 0, 0);
+  rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD);
+
+  float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  rlSetVertexAttributeDefault(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, white, SHADER_ATTRIB_VEC4, 4);
+  rlDisableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR);
+
+  // element buffer binding is vao state
+  rlEnableVertexBufferElement(indices->ebo);
+  rlDisableVertexArray();
+}
+
+void terrain_mesh_update(TerrainMesh *mesh, const Heightfield *hf, HeightfieldRect rect, const float *normals) {
+  int w = heightfield_rect_width(rect), l = heightfield_rect_length(rect);
+  float *positions = RL_MALLOC((size_t)w * l * 3 * sizeof(float));
+  float *p = positions;
+  for (int z = rect.z0; z <= rect.z1; z++) {
+    for (int x = rect.x0; x <= rect.x1; x++) {
+      *p++ = x * hf->spacing;
+      *p++ = heightfield_at(hf, x, z);
+      *p++ = z * hf->spacing;
+    }
+  }
+
+  // rows are contiguous in the buffers, the whole rect is when it spans them
+  int rows = w == hf->width ? 1 : l, row_size = (w == hf->width ? l : 1) * w * 3;
+  for (int r = 0; r < rows; r++) {
+    int first = (rect.z0 + r) * hf->width + rect.x0;
+    const float *row_positions = &positions[r * row_size], *row_normals = &normals[r * row_size];
+    if (mesh->vertices) {
+      memcpy(&mesh->vertices[first * 3], row_positions, row_size * sizeof(float));
+      memcpy(&mesh->normals[first * 3], row_normals, row_size * sizeof(float));
+    }
+    if (mesh->vao) {
+      rlUpdateVertexBuffer(mesh->vbo[0], row_positions, row_size * sizeof(float), first * 3 * sizeof(float));
+      rlUpdateVertexBuffer(mesh->vbo[1], row_normals, row_size * sizeof(float), first * 3 * sizeof(float));
+    }
+  }
+  RL_FREE(positions);
+}
+
+void terrain_mesh_free_cpu(TerrainMesh *mesh) {
+  RL_FREE(mesh->vertices);
+  RL_FREE(mesh->normals);
+  RL_FREE(mesh->texcoords);
+  mesh->vertices = NULL;
+  mesh->normals = NULL;
+  mesh->texcoords = NULL;
+}
+
+void terrain_mesh_unload(TerrainMesh *mesh) {
+  if (mesh->vao) {
+    rlUnloadVertexArray(mesh->vao);
+    for (int i = 0; i < 3; i++)
+      rlUnloadVertexBuffer(mesh->vbo[i]);
+  }
+  terrain_mesh_free_cpu(mesh);
+  mesh->vao = 0;
+}
+
+void terrain_mesh_draw(const TerrainMesh *mesh, const TerrainIndices *indices, RenderQueue *queue, Material material,
+                       Matrix transform, float depth) {
+  RenderCommand *command = render_queue_push(queue, material.shader, mesh->vao, 0, indices->count, RENDER_INDEX_32, depth);
+  command->textures[0] = material.maps[MATERIAL_MAP_DIFFUSE].texture.id;
+  command->color = material.maps[MATERIAL_MAP_DIFFUSE].color;
+  command->transform = transform;
+}
@@ -0,0 +1,54 @@
+#ifndef TERRAIN_MESH_H
+#define TERRAIN_MESH_H
+
+#include <raylib.h>
+
+#include "heightfield.h"
+#include "render_queue.h"
+
+// indexed terrain mesh: one vertex per heightfield sample plus 32 bit
+// indices, about 6x less vertex data than the 6 vertices per cell layout and
+// not limited to the 65535 vertices raylib's unsigned short indices allow.
+// the index buffer only depends on the grid size so meshes of one size share
+// a single TerrainIndices.
+
+typedef struct TerrainIndices {
+  int width, length; // samples
+  int count;
+  unsigned int *indices; // cpu copy, NULL once uploaded
+  unsigned int ebo;
+} TerrainIndices;
+
+typedef struct TerrainMesh {
+  int vertex_count;
+  // cpu copies, same layout as Mesh
+  float *vertices;
+  float *normals;
+  float *texcoords;
+  unsigned int vao;
+  unsigned int vbo[3]; // positions, normals, texcoords
+} TerrainMesh;
+
+// same triangulation as heightfield_build_mesh
+TerrainIndices terrain_indices_build(int width, int length);
+void terrain_indices_upload(TerrainIndices *indices);
+void terrain_indices_unload(TerrainIndices *indices);
+
+// cpu side only so it can run on a worker thread. normals come from the
+// slopes when the heightfield has them, central differences otherwise
+TerrainMesh terrain_mesh_build(const Heightfield *hf);
+// upload and bind the shared index buffer into the vao, the cpu copies are
+// left alone (they may point into a cache mapping)
+void terrain_mesh_upload(TerrainMesh *mesh, const TerrainIndices *indices);
+// after an edit to rect of the heightfield the mesh was built from: new
+// positions, and normals for the rect (xyz per sample, row by row), go to
+// the cpu copies when they are the mesh's own and to the gpu one row at a
+// time, so the cost is the rect's size
+void terrain_mesh_update(TerrainMesh *mesh, const Heightfield *hf, HeightfieldRect rect, const float *normals);
+void terrain_mesh_free_cpu(TerrainMesh *mesh);
+void terrain_mesh_unload(TerrainMesh *mesh);
+// queues a DrawMesh with 32 bit indices
+void terrain_mesh_draw(const TerrainMesh *mesh, const TerrainIndices *indices, RenderQueue *queue, Material material,
+                       Matrix transform, float depth);
+
+#endif
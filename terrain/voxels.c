@@ -0,0 +1,280 @@
+#include "voxels.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---Lookup---
+
+static unsigned int chunk_hash(int cx, int cy, int cz) {
+  return (unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u ^ (unsigned int)cz * 83492791u;
+}
+
+static void table_insert(VoxelWorld *world, VoxelChunk *c) {
+  unsigned int mask = world->table_size - 1;
+  unsigned int i = chunk_hash(c->x, c->y, c->z) & mask;
+  while (world->table[i])
+    i = (i + 1) & mask;
+  world->table[i] = c;
+}
+
+// chunks are never removed, only emptied, so this only runs on growth
+static void table_rebuild(VoxelWorld *world) {
+  int size = world->table_size ? world->table_size : 64;
+  while (size < world->count * 2)
+    size *= 2;
+  RL_FREE(world->table);
+  world->table = RL_CALLOC(size, sizeof(VoxelChunk *));
+  world->table_size = size;
+  for (int i = 0; i < world->count; i++)
+    table_insert(world, world->chunks[i]);
+}
+
+VoxelChunk *voxels_chunk(const VoxelWorld *world, int cx, int cy, int cz) {
+  unsigned int mask = world->table_size - 1;
+  for (unsigned int i = chunk_hash(cx, cy, cz) & mask; world->table[i]; i = (i + 1) & mask) {
+    VoxelChunk *c = world->table[i];
+    if (c->x == cx && c->y == cy && c->z == cz)
+      return c;
+  }
+  return NULL;
+}
+
+//---Chunks---
+
+static int voxel_index(int x, int y, int z) {
+  return (y * VOXEL_CHUNK + z) * VOXEL_CHUNK + x;
+}
+
+// bits is a power of two so an index never straddles two words
+static int read_index(const VoxelChunk *c, int i) {
+  size_t bit = (size_t)i * c->bits;
+  return (int)(c->data[bit >> 6] >> (bit & 63) & ((1ull << c->bits) - 1));
+}
+
+static void write_index(VoxelChunk *c, int i, int index) {
+  size_t bit = (size_t)i * c->bits;
+  uint64_t mask = ((1ull << c->bits) - 1) << (bit & 63);
+  c->data[bit >> 6] = (c->data[bit >> 6] & ~mask) | ((uint64_t)index << (bit & 63) & mask);
+}
+
+static size_t data_bytes(int bits) {
+  return (size_t)VOXEL_CHUNK_VOLUME * bits / 8;
+}
+
+// entries the palette has room for. past 8 bits there can't be more entries
+// than voxels plus empty, 16 bits only keeps indices from straddling words
+static int palette_capacity(int bits) {
+  return bits < 16 ? 1 << bits : VOXEL_CHUNK_VOLUME + 1;
+}
+
+static size_t palette_bytes(int bits) {
+  return (size_t)palette_capacity(bits) * (sizeof(Voxel) + sizeof(int));
+}
+
+// the first block in an empty chunk: two entries, empty and value
+static void chunk_alloc(VoxelWorld *world, VoxelChunk *c, Voxel value) {
+  c->bits = 1;
+  c->data = RL_CALLOC(data_bytes(1), 1);
+  c->palette = RL_MALLOC(2 * sizeof(Voxel));
+  c->uses = RL_MALLOC(2 * sizeof(int));
+  c->palette[0] = VOXEL_EMPTY;
+  c->palette[1] = value;
+  c->uses[0] = VOXEL_CHUNK_VOLUME;
+  c->uses[1] = 0;
+  c->palette_size = 2;
+  world->bytes += data_bytes(1) + palette_bytes(1);
+}
+
+// the last block is gone, back to no data at all
+static void chunk_release(VoxelWorld *world, VoxelChunk *c) {
+  world->bytes -= data_bytes(c->bits) + palette_bytes(c->bits);
+  RL_FREE(c->data);
+  RL_FREE(c->palette);
+  RL_FREE(c->uses);
+  c->data = NULL;
+  c->palette = NULL;
+  c->uses = NULL;
+  c->bits = 0;
+  c->palette_size = 0;
+}
+
+// twice the bits per index, every index is copied over
+static void chunk_widen(VoxelWorld *world, VoxelChunk *c) {
+  VoxelChunk wide = *c;
+  wide.bits = c->bits * 2;
+  wide.data = RL_CALLOC(data_bytes(wide.bits), 1);
+  for (int i = 0; i < VOXEL_CHUNK_VOLUME; i++)
+    write_index(&wide, i, read_index(c, i));
+  RL_FREE(c->data);
+  c->data = wide.data;
+  c->palette = RL_REALLOC(c->palette, palette_capacity(wide.bits) * sizeof(Voxel));
+  c->uses = RL_REALLOC(c->uses, palette_capacity(wide.bits) * sizeof(int));
+  world->bytes += data_bytes(wide.bits) + palette_bytes(wide.bits) - data_bytes(c->bits) - palette_bytes(c->bits);
+  c->bits = wide.bits;
+}
+
+// palette index of value, reusing entries nothing points at before growing
+static int palette_entry(VoxelWorld *world, VoxelChunk *c, Voxel value) {
+  int unused = -1;
+  for (int k = 0; k < c->palette_size; k++) {
+    if (c->palette[k] == value)
+      return k;
+    if (k && !c->uses[k] && unused == -1)
+      unused = k;
+  }
+  if (unused != -1) {
+    c->palette[unused] = value;
+    return unused;
+  }
+  if (c->palette_size == palette_capacity(c->bits))
+    chunk_widen(world, c);
+  c->palette[c->palette_size] = value;
+  c->uses[c->palette_size] = 0;
+  return c->palette_size++;
+}
+
+static VoxelChunk *chunk_add(VoxelWorld *world, int cx, int cy, int cz) {
+  if (world->count == world->capacity) {
+    world->capacity = world->capacity ? world->capacity * 2 : 64;
+    world->chunks = RL_REALLOC(world->chunks, world->capacity * sizeof(VoxelChunk *));
+  }
+  VoxelChunk *c = RL_CALLOC(1, sizeof(VoxelChunk));
+  c->x = cx;
+  c->y = cy;
+  c->z = cz;
+  c->index = world->count;
+  world->chunks[world->count++] = c;
+  world->bytes += sizeof(VoxelChunk);
+  int k[3] = {cx, cy, cz};
+  for (int a = 0; a < 3; a++) {
+    world->min[a] = k[a] < world->min[a] || world->count == 1 ? k[a] : world->min[a];
+    world->max[a] = k[a] > world->max[a] || world->count == 1 ? k[a] : world->max[a];
+  }
+  if (world->count * 2 > world->table_size)
+    table_rebuild(world);
+  else
+    table_insert(world, c);
+  return c;
+}
+
+static void mark_dirty(VoxelWorld *world, VoxelChunk *c) {
+  if (!c || c->dirty)
+    return;
+  if (world->dirty_count == world->dirty_capacity) {
+    world->dirty_capacity = world->dirty_capacity ? world->dirty_capacity * 2 : 64;
+    world->dirty = RL_REALLOC(world->dirty, world->dirty_capacity * sizeof(VoxelChunk *));
+  }
+  c->dirty = true;
+  world->dirty[world->dirty_count++] = c;
+}
+
+//---World---
+
+void voxels_init(VoxelWorld *world, float voxel_size) {
+  memset(world, 0, sizeof(*world));
+  world->voxel_size = voxel_size;
+  table_rebuild(world);
+}
+
+void voxels_unload(VoxelWorld *world) {
+  for (int i = 0; i < world->count; i++) {
+    VoxelChunk *c = world->chunks[i];
+    RL_FREE(c->data);
+    RL_FREE(c->palette);
+    RL_FREE(c->uses);
+    RL_FREE(c);
+  }
+  RL_FREE(world->chunks);
+  RL_FREE(world->table);
+  RL_FREE(world->dirty);
+  memset(world, 0, sizeof(*world));
+}
+
+Voxel voxel_chunk_get(const VoxelChunk *chunk, int x, int y, int z) {
+  return chunk->bits ? chunk->palette[read_index(chunk, voxel_index(x, y, z))] : VOXEL_EMPTY;
+}
+
+// palette index 0 is always empty, so only the non zero fields of each word
+// are visited, lowest set bit first
+int voxel_chunk_solid(const VoxelChunk *chunk, uint16_t *indices, Voxel *values) {
+  if (!chunk->bits)
+    return 0;
+  int n = 0, bits = chunk->bits, per_word = 64 / bits, words = VOXEL_CHUNK_VOLUME / per_word;
+  uint64_t field = (1ull << bits) - 1;
+  for (int w = 0; w < words; w++) {
+    for (uint64_t word = chunk->data[w]; word;) {
+      int slot = __builtin_ctzll(word) / bits;
+      word &= ~(field << slot * bits);
+      indices[n] = (uint16_t)(w * per_word + slot);
+      values[n++] = chunk->palette[chunk->data[w] >> slot * bits & field];
+    }
+  }
+  return n;
+}
+
+// chunk coordinates by arithmetic shift, the local ones by mask, both right
+// for negative voxels
+Voxel voxels_get(const VoxelWorld *world, int x, int y, int z) {
+  const VoxelChunk *c = voxels_chunk(world, x >> VOXEL_CHUNK_BITS, y >> VOXEL_CHUNK_BITS, z >> VOXEL_CHUNK_BITS);
+  return c ? voxel_chunk_get(c, x & (VOXEL_CHUNK - 1), y & (VOXEL_CHUNK - 1), z & (VOXEL_CHUNK - 1)) : VOXEL_EMPTY;
+}
+
+bool voxels_set(VoxelWorld *world, int x, int y, int z, Voxel value) {
+  int cx = x >> VOXEL_CHUNK_BITS, cy = y >> VOXEL_CHUNK_BITS, cz = z >> VOXEL_CHUNK_BITS;
+  int lx = x & (VOXEL_CHUNK - 1), ly = y & (VOXEL_CHUNK - 1), lz = z & (VOXEL_CHUNK - 1);
+  VoxelChunk *c = voxels_chunk(world, cx, cy, cz);
+  Voxel current = c ? voxel_chunk_get(c, lx, ly, lz) : VOXEL_EMPTY;
+  if (current == value)
+    return false;
+  if (!c)
+    c = chunk_add(world, cx, cy, cz);
+  if (!c->bits)
+    chunk_alloc(world, c, value);
+
+  // the old entry is released first so a full palette can reuse it
+  int i = voxel_index(lx, ly, lz), old = read_index(c, i);
+  c->uses[old]--;
+  int entry = palette_entry(world, c, value);
+  c->uses[entry]++;
+  write_index(c, i, entry);
+  int solid = (value != VOXEL_EMPTY) - (current != VOXEL_EMPTY);
+  c->count += solid;
+  world->blocks += solid;
+
+  // faces between chunks belong to both
+  mark_dirty(world, c);
+  if (lx == 0)
+    mark_dirty(world, voxels_chunk(world, cx - 1, cy, cz));
+  if (lx == VOXEL_CHUNK - 1)
+    mark_dirty(world, voxels_chunk(world, cx + 1, cy, cz));
+  if (ly == 0)
+    mark_dirty(world, voxels_chunk(world, cx, cy - 1, cz));
+  if (ly == VOXEL_CHUNK - 1)
+    mark_dirty(world, voxels_chunk(world, cx, cy + 1, cz));
+  if (lz == 0)
+    mark_dirty(world, voxels_chunk(world, cx, cy, cz - 1));
+  if (lz == VOXEL_CHUNK - 1)
+    mark_dirty(world, voxels_chunk(world, cx, cy, cz + 1));
+
+  if (!c->count)
+    chunk_release(world, c);
+  return true;
+}
+
+void voxels_clear_dirty(VoxelWorld *world) {
+  for (int i = 0; i < world->dirty_count; i++)
+    world->dirty[i]->dirty = false;
+  world->dirty_count = 0;
+}
+
+void voxels_cell(const VoxelWorld *world, Vector3 position, int voxel[3]) {
+  voxel[0] = (int)floorf(position.x / world->voxel_size);
+  voxel[1] = (int)floorf(position.y / world->voxel_size);
+  voxel[2] = (int)floorf(position.z / world->voxel_size);
+}
+
+BoundingBox voxels_bounds(const VoxelWorld *world, int x, int y, int z) {
+  float s = world->voxel_size;
+  return (BoundingBox){{x * s, y * s, z * s}, {(x + 1) * s, (y + 1) * s, (z + 1) * s}};
+}
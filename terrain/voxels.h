@@ -0,0 +1,69 @@
+#ifndef VOXELS_H
+#define VOXELS_H
+
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// sparse voxel storage for the player placed blocks. the world is cut into
+// VOXEL_CHUNK^3 chunks that only exist where something was placed. a chunk
+// keeps a palette of the voxel values in it and one bit packed palette index
+// per voxel, as few bits as the palette needs (1, 2, 4, 8 or 16), so a chunk
+// of one block type is 512 bytes. chunks an edit touches are marked dirty for
+// whatever builds meshes from them.
+
+#define VOXEL_CHUNK_BITS 4
+#define VOXEL_CHUNK (1 << VOXEL_CHUNK_BITS) // voxels per chunk side
+#define VOXEL_CHUNK_VOLUME (VOXEL_CHUNK * VOXEL_CHUNK * VOXEL_CHUNK)
+
+// 0 is empty, otherwise the block's texture + 1
+typedef uint16_t Voxel;
+
+#define VOXEL_EMPTY 0
+
+typedef struct VoxelChunk {
+  int x, y, z; // chunk coordinates, voxel x * VOXEL_CHUNK + local
+  int index;   // in VoxelWorld.chunks, chunks are never removed
+  int count;   // solid voxels
+  int bits;    // per palette index, 0 while the chunk is all empty
+  Voxel *palette;
+  int *uses;   // voxels per palette entry, entries at 0 get reused
+  int palette_size;
+  uint64_t *data; // indices, x fastest then z then y
+  bool dirty;
+} VoxelChunk;
+
+typedef struct VoxelWorld {
+  float voxel_size; // world units per voxel side, voxel (x, y, z) starts at (x, y, z) * voxel_size
+  VoxelChunk **chunks;
+  int count, capacity;
+  VoxelChunk **table; // open addressing on the chunk coordinates
+  int table_size;
+  // chunks marked dirty since the last voxels_clear_dirty, each once
+  VoxelChunk **dirty;
+  int dirty_count, dirty_capacity;
+  int min[3], max[3]; // chunk coordinates around every chunk
+  int blocks;         // solid voxels
+  size_t bytes;
+} VoxelWorld;
+
+void voxels_init(VoxelWorld *world, float voxel_size);
+void voxels_unload(VoxelWorld *world);
+
+// NULL where nothing was ever placed
+VoxelChunk *voxels_chunk(const VoxelWorld *world, int cx, int cy, int cz);
+Voxel voxel_chunk_get(const VoxelChunk *chunk, int x, int y, int z); // local coordinates
+// the chunk's solid voxels, local index x + (z + y * VOXEL_CHUNK) * VOXEL_CHUNK
+// and value, in index order. both hold up to chunk->count, returns how many
+int voxel_chunk_solid(const VoxelChunk *chunk, uint16_t *indices, Voxel *values);
+Voxel voxels_get(const VoxelWorld *world, int x, int y, int z);
+// returns false if the voxel already was value. marks its chunk dirty, and
+// the neighbouring chunk too when the voxel is on a face of its chunk
+bool voxels_set(VoxelWorld *world, int x, int y, int z, Voxel value);
+void voxels_clear_dirty(VoxelWorld *world);
+
+// voxel coordinates of a world position and the box of a voxel
+void voxels_cell(const VoxelWorld *world, Vector3 position, int voxel[3]);
+BoundingBox voxels_bounds(const VoxelWorld *world, int x, int y, int z);
+
+#endif